@@ -0,0 +1,439 @@
+#include "batch.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+
+using namespace glm;
+
+void SphereBatch::add(const mat4 &tInv)
+{
+	for(int r = 0; r < 3; r++)
+		for(int c = 0; c < 4; c++)
+			m[r][c].push_back(tInv[c][r]); // glm matrices are indexed [column][row]
+}
+
+void SphereBatch::clear()
+{
+	for(int r = 0; r < 3; r++)
+		for(int c = 0; c < 4; c++)
+			m[r][c].clear();
+}
+
+void RayBatch::add(const vec3 &p0, const vec3 &v0)
+{
+	vec3 D = glm::normalize(v0);
+	ox.push_back(p0.x); oy.push_back(p0.y); oz.push_back(p0.z);
+	dx.push_back(D.x); dy.push_back(D.y); dz.push_back(D.z);
+}
+
+void RayBatch::clear()
+{
+	ox.clear(); oy.clear(); oz.clear();
+	dx.clear(); dy.clear(); dz.clear();
+}
+
+void BoxBatch::add(const vec3 &boxMin, const vec3 &boxMax)
+{
+	for(int axis = 0; axis < 3; axis++)
+	{
+		bounds[0][axis].push_back(boxMin[axis]);
+		bounds[1][axis].push_back(boxMax[axis]);
+	}
+}
+
+void BoxBatch::clear()
+{
+	for(int side = 0; side < 2; side++)
+		for(int axis = 0; axis < 3; axis++)
+			bounds[side][axis].clear();
+}
+
+// Intersects a ray with the unit sphere, where p and d are the ray's origin and direction already
+// transformed into the sphere's object space, returning the nearest hit in [tMin, tMax]. Same math as
+// the SIMD lanes below; this handles whatever is left over when the batch doesn't divide evenly into
+// SIMD_WIDTH.
+static float sphereLane(float px, float py, float pz, float dx, float dy, float dz, float tMin, float tMax)
+{
+	// Half-b form of the quadratic formula; a isn't 1 because d picks up the sphere's scaling. The discriminant, c and the
+	// roots are worked out the way raySphereIntersect() in stubs.cpp does, to keep the precision there.
+	float a = dx*dx + dy*dy + dz*dz, invA = 1 / a;
+	float b = dx*px + dy*py + dz*pz;
+
+	float s = b * invA;
+	float lx = px - s*dx, ly = py - s*dy, lz = pz - s*dz;
+	float discriminant = a * (1 - (lx*lx + ly*ly + lz*lz));
+	if(discriminant < 0)
+		return -1;
+	float c = px*px + py*py + pz*pz - 1;
+
+	float root = sqrt(discriminant);
+	float q = (b < 0) ? root - b : -(b + root);
+	float tA = q * invA, tB = (q != 0) ? c / q : tA;
+	float t1 = (tB < tA) ? tB : tA; // near intersection
+	if(t1 >= tMin)
+		return (t1 <= tMax) ? t1 : -1;
+	float t2 = (tA < tB) ? tB : tA; // far intersection (the ray starts inside the sphere)
+	if(t2 >= tMin && t2 <= tMax)
+		return t2;
+	return -1;
+}
+
+#if SIMD_WIDTH > 1
+static floatN sphereLanes(floatN px, floatN py, floatN pz, floatN dx, floatN dy, floatN dz, floatN tMin, floatN tMax)
+{
+	floatN zero = setN(0), one = setN(1), miss = setN(-1);
+	floatN a = addN(addN(mulN(dx, dx), mulN(dy, dy)), mulN(dz, dz)), invA = divN(one, a);
+	floatN b = addN(addN(mulN(dx, px), mulN(dy, py)), mulN(dz, pz));
+
+	floatN s = mulN(b, invA);
+	floatN lx = subN(px, mulN(s, dx)), ly = subN(py, mulN(s, dy)), lz = subN(pz, mulN(s, dz));
+	floatN discriminant = mulN(a, subN(one, addN(addN(mulN(lx, lx), mulN(ly, ly)), mulN(lz, lz))));
+	floatN c = subN(addN(addN(mulN(px, px), mulN(py, py)), mulN(pz, pz)), one);
+
+	floatN root = sqrtN(maxN(discriminant, zero)); // clamped so missing lanes don't produce NaNs
+	floatN q = selectN(lessN(b, zero), subN(root, b), subN(zero, addN(b, root)));
+	floatN tA = mulN(q, invA);
+	floatN tB = selectN(equalN(q, zero), tA, divN(c, q));
+	floatN t1 = minN(tB, tA), t2 = maxN(tA, tB);
+
+	floatN t = selectN(greaterEqualN(t1, tMin), t1, selectN(greaterEqualN(t2, tMin), t2, miss));
+	t = selectN(greaterN(t, tMax), miss, t);
+	return selectN(lessN(discriminant, zero), miss, t);
+}
+#endif
+
+void raySphereIntersectBatch(const vec3 &p0, const vec3 &v0, const SphereBatch &spheres, float *t)
+{
+	raySphereIntersectBatch(Ray(p0, glm::normalize(v0)), spheres, t);
+}
+
+void raySphereIntersectBatch(const Ray &ray, const SphereBatch &spheres, float *t)
+{
+	const vec3 &p0 = ray.origin, &D = ray.direction;
+	int n = spheres.size();
+	const std::vector<float> (&m)[3][4] = spheres.m;
+	int i = 0;
+
+#if SIMD_WIDTH > 1
+	floatN ox = setN(p0.x), oy = setN(p0.y), oz = setN(p0.z);
+	floatN Dx = setN(D.x), Dy = setN(D.y), Dz = setN(D.z);
+	floatN tMin = setN(ray.tMin), tMax = setN(ray.tMax);
+	for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+	{
+		floatN p[3], d[3];
+		for(int r = 0; r < 3; r++)
+		{
+			floatN m0 = loadN(&m[r][0][i]), m1 = loadN(&m[r][1][i]), m2 = loadN(&m[r][2][i]);
+			d[r] = addN(addN(mulN(m0, Dx), mulN(m1, Dy)), mulN(m2, Dz));
+			p[r] = addN(addN(addN(mulN(m0, ox), mulN(m1, oy)), mulN(m2, oz)), loadN(&m[r][3][i]));
+		}
+		storeN(&t[i], sphereLanes(p[0], p[1], p[2], d[0], d[1], d[2], tMin, tMax));
+	}
+#endif
+
+	for(; i < n; i++)
+	{
+		float p[3], d[3];
+		for(int r = 0; r < 3; r++)
+		{
+			d[r] = m[r][0][i]*D.x + m[r][1][i]*D.y + m[r][2][i]*D.z;
+			p[r] = m[r][0][i]*p0.x + m[r][1][i]*p0.y + m[r][2][i]*p0.z + m[r][3][i];
+		}
+		t[i] = sphereLane(p[0], p[1], p[2], d[0], d[1], d[2], ray.tMin, ray.tMax);
+	}
+}
+
+void raySphereIntersectBatch(const RayBatch &rays, const mat4 &tInv, float *t)
+{
+	int n = rays.size();
+	int i = 0;
+
+#if SIMD_WIDTH > 1
+	floatN m[3][4];
+	for(int r = 0; r < 3; r++)
+		for(int c = 0; c < 4; c++)
+			m[r][c] = setN(tInv[c][r]);
+
+	for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+	{
+		floatN ox = loadN(&rays.ox[i]), oy = loadN(&rays.oy[i]), oz = loadN(&rays.oz[i]);
+		floatN Dx = loadN(&rays.dx[i]), Dy = loadN(&rays.dy[i]), Dz = loadN(&rays.dz[i]);
+		floatN p[3], d[3];
+		for(int r = 0; r < 3; r++)
+		{
+			d[r] = addN(addN(mulN(m[r][0], Dx), mulN(m[r][1], Dy)), mulN(m[r][2], Dz));
+			p[r] = addN(addN(addN(mulN(m[r][0], ox), mulN(m[r][1], oy)), mulN(m[r][2], oz)), m[r][3]);
+		}
+		storeN(&t[i], sphereLanes(p[0], p[1], p[2], d[0], d[1], d[2], setN(0), setN(std::numeric_limits<float>::infinity())));
+	}
+#endif
+
+	for(; i < n; i++)
+	{
+		vec3 p = v4Tov3(tInv * vec4(rays.ox[i], rays.oy[i], rays.oz[i], 1));
+		vec3 d = v4Tov3(tInv * vec4(rays.dx[i], rays.dy[i], rays.dz[i], 0));
+		t[i] = sphereLane(p.x, p.y, p.z, d.x, d.y, d.z, 0, std::numeric_limits<float>::infinity());
+	}
+}
+
+// 8 floats: enough for an aligned AVX load, and a multiple of what SSE needs
+static const int TRIANGLE_BATCH_ALIGNMENT = 32;
+
+static float* alignedAlloc(size_t numFloats)
+{
+	size_t size = numFloats > 0 ? numFloats * sizeof(float) : 1;
+#ifdef _MSC_VER
+	void *p = _aligned_malloc(size, TRIANGLE_BATCH_ALIGNMENT);
+#else
+	void *p = 0;
+	if(posix_memalign(&p, TRIANGLE_BATCH_ALIGNMENT, size) != 0)
+		p = 0;
+#endif
+	if(!p)
+		throw std::bad_alloc();
+	return (float*)p;
+}
+
+static void alignedFree(float *p)
+{
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+TriangleBatch::TriangleBatch() : data(0), count(0), capacity(0)
+{
+}
+
+TriangleBatch::TriangleBatch(const TriangleBatch &other) : data(0), count(0), capacity(0)
+{
+	*this = other;
+}
+
+TriangleBatch &TriangleBatch::operator=(const TriangleBatch &other)
+{
+	if(this == &other)
+		return *this;
+
+	count = 0;
+	reserve(other.count);
+	for(int c = 0; c < NUM_COMPONENTS && other.count > 0; c++)
+		memcpy(get((Component)c), other.get((Component)c), other.count * sizeof(float));
+	count = other.count;
+	faceIds = other.faceIds;
+	return *this;
+}
+
+TriangleBatch::~TriangleBatch()
+{
+	alignedFree(data);
+}
+
+void TriangleBatch::reserve(int n)
+{
+	if(n <= capacity)
+		return;
+
+	int newCapacity = std::max(8, capacity * 2);
+	while(newCapacity < n)
+		newCapacity *= 2;
+
+	// Every array moves, since they're all laid out by capacity
+	float *newData = alignedAlloc((size_t)NUM_COMPONENTS * newCapacity);
+	for(int c = 0; c < NUM_COMPONENTS && count > 0; c++)
+		memcpy(newData + (size_t)c*newCapacity, get((Component)c), count * sizeof(float));
+	alignedFree(data);
+	data = newData;
+	capacity = newCapacity;
+}
+
+void TriangleBatch::resize(int n)
+{
+	reserve(n);
+	count = n;
+	faceIds.resize(n);
+}
+
+void TriangleBatch::set(int i, const Triangle &tri, unsigned faceId)
+{
+	const vec3 *vectors[] = {&tri.p1, &tri.e1, &tri.e2, &tri.normal};
+	for(int v = 0; v < 4; v++)
+		for(int axis = 0; axis < 3; axis++)
+			get((Component)(3*v + axis))[i] = (*vectors[v])[axis];
+	faceIds[i] = faceId;
+}
+
+void TriangleBatch::add(const Triangle &tri, unsigned faceId)
+{
+	resize(count + 1);
+	set(count - 1, tri, faceId);
+}
+
+void TriangleBatch::clear()
+{
+	count = 0;
+	faceIds.clear();
+}
+
+void TriangleBatch::swap(TriangleBatch &other)
+{
+	std::swap(data, other.data);
+	std::swap(count, other.count);
+	std::swap(capacity, other.capacity);
+	faceIds.swap(other.faceIds);
+}
+
+Triangle TriangleBatch::View::getTriangle(int i) const
+{
+	Triangle tri;
+	tri.p1 = vec3(get(P1X)[i], get(P1Y)[i], get(P1Z)[i]);
+	tri.e1 = vec3(get(E1X)[i], get(E1Y)[i], get(E1Z)[i]);
+	tri.e2 = vec3(get(E2X)[i], get(E2Y)[i], get(E2Z)[i]);
+	tri.normal = getNormal(i);
+	return tri;
+}
+
+// Triangle i of the batch, without the normal (which the intersection doesn't need)
+static Triangle gatherTriangle(const TriangleBatch::View &triangles, int i)
+{
+	Triangle tri;
+	tri.p1 = vec3(triangles.get(TriangleBatch::P1X)[i], triangles.get(TriangleBatch::P1Y)[i], triangles.get(TriangleBatch::P1Z)[i]);
+	tri.e1 = vec3(triangles.get(TriangleBatch::E1X)[i], triangles.get(TriangleBatch::E1Y)[i], triangles.get(TriangleBatch::E1Z)[i]);
+	tri.e2 = vec3(triangles.get(TriangleBatch::E2X)[i], triangles.get(TriangleBatch::E2Y)[i], triangles.get(TriangleBatch::E2Z)[i]);
+	return tri;
+}
+
+double rayTriangleIntersect(const vec3 &p, const vec3 &D, const TriangleBatch::View &triangles, int i)
+{
+	return rayTriangleIntersect(p, D, gatherTriangle(triangles, i));
+}
+
+float rayTriangleIntersect(const Ray &ray, const TriangleBatch::View &triangles, int i)
+{
+	return rayTriangleIntersect(ray, gatherTriangle(triangles, i));
+}
+
+#if SIMD_WIDTH > 1
+// Moller-Trumbore on SIMD_WIDTH triangles at once. The operations (and their order) are exactly those of the scalar version in
+// stubs.cpp, so each lane gives the same float result; lanes that would have returned early there are masked out at the end instead.
+static floatN triangleLanes(floatN px, floatN py, floatN pz, floatN Dx, floatN Dy, floatN Dz, floatN tMin, floatN tMax,
+	const TriangleBatch::View &triangles, int i)
+{
+	floatN p1x = loadAlignedN(&triangles.get(TriangleBatch::P1X)[i]);
+	floatN p1y = loadAlignedN(&triangles.get(TriangleBatch::P1Y)[i]);
+	floatN p1z = loadAlignedN(&triangles.get(TriangleBatch::P1Z)[i]);
+	floatN e1x = loadAlignedN(&triangles.get(TriangleBatch::E1X)[i]);
+	floatN e1y = loadAlignedN(&triangles.get(TriangleBatch::E1Y)[i]);
+	floatN e1z = loadAlignedN(&triangles.get(TriangleBatch::E1Z)[i]);
+	floatN e2x = loadAlignedN(&triangles.get(TriangleBatch::E2X)[i]);
+	floatN e2y = loadAlignedN(&triangles.get(TriangleBatch::E2Y)[i]);
+	floatN e2z = loadAlignedN(&triangles.get(TriangleBatch::E2Z)[i]);
+
+	// pvec = D x e2
+	floatN pvecx = subN(mulN(Dy, e2z), mulN(e2y, Dz));
+	floatN pvecy = subN(mulN(Dz, e2x), mulN(e2z, Dx));
+	floatN pvecz = subN(mulN(Dx, e2y), mulN(e2x, Dy));
+	floatN det = addN(addN(mulN(e1x, pvecx), mulN(e1y, pvecy)), mulN(e1z, pvecz));
+	floatN invDet = divN(setN(1), det);
+
+	floatN tvecx = subN(px, p1x), tvecy = subN(py, p1y), tvecz = subN(pz, p1z);
+	floatN u = mulN(addN(addN(mulN(tvecx, pvecx), mulN(tvecy, pvecy)), mulN(tvecz, pvecz)), invDet);
+
+	// qvec = tvec x e1
+	floatN qvecx = subN(mulN(tvecy, e1z), mulN(e1y, tvecz));
+	floatN qvecy = subN(mulN(tvecz, e1x), mulN(e1z, tvecx));
+	floatN qvecz = subN(mulN(tvecx, e1y), mulN(e1x, tvecy));
+	floatN v = mulN(addN(addN(mulN(Dx, qvecx), mulN(Dy, qvecy)), mulN(Dz, qvecz)), invDet);
+
+	floatN t = mulN(addN(addN(mulN(e2x, qvecx), mulN(e2y, qvecy)), mulN(e2z, qvecz)), invDet);
+
+	floatN zero = setN(0), one = setN(1);
+	floatN miss = orN(equalN(det, zero), orN(lessN(u, zero), greaterN(u, one)));
+	miss = orN(miss, orN(lessN(v, zero), greaterN(addN(u, v), one)));
+	miss = orN(miss, orN(lessN(t, tMin), greaterN(t, tMax)));
+	return selectN(miss, setN(-1), t);
+}
+#endif
+
+void rayTriangleIntersectBatch(const vec3 &p, const vec3 &D, const TriangleBatch::View &triangles, float *t)
+{
+	rayTriangleIntersectBatch(Ray(p, D), triangles, t);
+}
+
+void rayTriangleIntersectBatch(const Ray &ray, const TriangleBatch::View &triangles, float *t)
+{
+	int n = triangles.size();
+	int i = 0;
+
+#if SIMD_WIDTH > 1
+	floatN px = setN(ray.origin.x), py = setN(ray.origin.y), pz = setN(ray.origin.z);
+	floatN Dx = setN(ray.direction.x), Dy = setN(ray.direction.y), Dz = setN(ray.direction.z);
+	floatN tMin = setN(ray.tMin), tMax = setN(ray.tMax);
+	for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+		storeN(&t[i], triangleLanes(px, py, pz, Dx, Dy, Dz, tMin, tMax, triangles, i));
+#endif
+
+	for(; i < n; i++)
+		t[i] = (float)rayTriangleIntersect(ray, triangles, i);
+}
+
+void getTriangleBarycentrics(const vec3 &p, const vec3 &D, const TriangleBatch::View &triangles, int i, float &u, float &v)
+{
+	// The same Moller-Trumbore steps as rayTriangleIntersect(), stopping short of t
+	Triangle tri = triangles.getTriangle(i);
+	vec3 pvec = glm::cross(D, tri.e2);
+	float invDet = 1 / glm::dot(tri.e1, pvec);
+	vec3 tvec = p - tri.p1;
+	u = glm::dot(tvec, pvec) * invDet;
+	v = glm::dot(D, glm::cross(tvec, tri.e1)) * invDet;
+}
+
+void getTriangleBarycentrics(const Ray &ray, const TriangleBatch::View &triangles, int i, float &u, float &v)
+{
+	getTriangleBarycentrics(ray.origin, ray.direction, triangles, i, u, v);
+}
+
+void rayBoxIntersectBatch(const Ray &ray, const BoxBatch &boxes, float *t)
+{
+	int n = boxes.size();
+	int i = 0;
+	if(n == 0)
+		return;
+
+	// The ray's signs are the same for every box, so each axis's near and far planes come straight from one array or the other
+	const float *nearX = &boxes.bounds[ray.sign[0]][0][0], *farX = &boxes.bounds[1 - ray.sign[0]][0][0];
+	const float *nearY = &boxes.bounds[ray.sign[1]][1][0], *farY = &boxes.bounds[1 - ray.sign[1]][1][0];
+	const float *nearZ = &boxes.bounds[ray.sign[2]][2][0], *farZ = &boxes.bounds[1 - ray.sign[2]][2][0];
+
+#if SIMD_WIDTH > 1
+	// maxN(a, b) and minN(a, b) give b when a is a NaN, like glm::max() and glm::min(), so this is the same test as rayBoxIntersect()
+	floatN px = setN(ray.origin.x), py = setN(ray.origin.y), pz = setN(ray.origin.z);
+	floatN invDx = setN(ray.invDirection.x), invDy = setN(ray.invDirection.y), invDz = setN(ray.invDirection.z);
+	floatN tMin = setN(ray.tMin), tMax = setN(ray.tMax), miss = setN(-1);
+	floatN negInf = setN(-std::numeric_limits<float>::infinity()), inf = setN(std::numeric_limits<float>::infinity());
+	for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+	{
+		floatN enter = maxN(mulN(subN(loadN(nearX + i), px), invDx),
+			maxN(mulN(subN(loadN(nearY + i), py), invDy), maxN(mulN(subN(loadN(nearZ + i), pz), invDz), negInf)));
+		floatN exit = minN(mulN(subN(loadN(farX + i), px), invDx),
+			minN(mulN(subN(loadN(farY + i), py), invDy), minN(mulN(subN(loadN(farZ + i), pz), invDz), inf)));
+		enter = maxN(enter, tMin);
+		storeN(&t[i], selectN(greaterEqualN(minN(exit, tMax), enter), enter, miss));
+	}
+#endif
+
+	for(; i < n; i++)
+	{
+		vec3 bounds[2] = {vec3(boxes.bounds[0][0][i], boxes.bounds[0][1][i], boxes.bounds[0][2][i]),
+			vec3(boxes.bounds[1][0][i], boxes.bounds[1][1][i], boxes.bounds[1][2][i])};
+		float tEnter, tExit;
+		t[i] = rayBoxIntersect(ray, bounds, tEnter, tExit) ? glm::max(tEnter, ray.tMin) : -1;
+	}
+}
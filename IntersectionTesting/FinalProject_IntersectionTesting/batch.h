@@ -0,0 +1,144 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "stubs.h"
+
+#include <vector>
+
+// ** Batch intersection functions - these test many ray/object pairs per call, using SIMD lanes    **
+// ** (see simd.h) over structure-of-arrays inputs. They return exactly what the single-pair       **
+// ** functions in stubs.h would for each pair (smallest positive t, or -1), but in float precision. **
+// ** As there, the ones that take a Ray look for hits in its [tMin, tMax] instead.                 **
+
+// A set of spheres, stored as their T-inverse matrices in structure-of-arrays form: m[r][c][i] is
+// row r, column c of sphere i's T-inverse. Only the top three rows are kept, since the bottom row of
+// an affine matrix is always (0, 0, 0, 1).
+struct SphereBatch
+{
+	std::vector<float> m[3][4];
+
+	void add(const mat4 &tInv);
+	void clear();
+	int size() const {return (int)m[0][0].size();}
+};
+
+// A set of rays in structure-of-arrays form. Directions are normalized as they're added, just like
+// the single-ray functions do with v0.
+struct RayBatch
+{
+	std::vector<float> ox, oy, oz;
+	std::vector<float> dx, dy, dz;
+
+	void add(const vec3 &p0, const vec3 &v0);
+	void clear();
+	int size() const {return (int)ox.size();}
+};
+
+// A set of axis-aligned boxes in structure-of-arrays form: bounds[0][axis][i] is box i's min corner along
+// axis and bounds[1][axis][i] its max corner, so a ray's near and far planes along an axis are just
+// bounds[sign][axis] and bounds[1 - sign][axis] for every box at once.
+struct BoxBatch
+{
+	std::vector<float> bounds[2][3];
+
+	void add(const vec3 &boxMin, const vec3 &boxMax);
+	void clear();
+	int size() const {return (int)bounds[0][0].size();}
+};
+
+// A set of prepared triangles (see Triangle in stubs.h) in structure-of-arrays form: get(P1X)[i] is the
+// x coordinate of triangle i's p1, and so on. All twelve arrays live in one allocation, and each one
+// starts on a 32-byte boundary so the batch kernels can use aligned loads at any SIMD width. Each
+// triangle also carries the id of the face it came from, for whoever built the batch to map hits back.
+class TriangleBatch
+{
+public:
+	enum Component {P1X, P1Y, P1Z, E1X, E1Y, E1Z, E2X, E2Y, E2Z, NX, NY, NZ, NUM_COMPONENTS};
+
+	// Read-only access to a batch's arrays, or to arrays laid out the same way somewhere else (e.g. in a
+	// memory-mapped file), which is what the intersection functions below work on. Cheap to copy; a
+	// TriangleBatch converts to one automatically.
+	class View
+	{
+	public:
+		View() : data(0), count(0), capacity(0), faceIds(0) {}
+		View(const float *data, int count, int capacity, const unsigned *faceIds)
+			: data(data), count(count), capacity(capacity), faceIds(faceIds) {}
+		View(const TriangleBatch &batch)
+			: data(batch.data), count(batch.count), capacity(batch.capacity), faceIds(batch.faceIds.empty() ? 0 : &batch.faceIds[0]) {}
+
+		int size() const {return count;}
+		const float *get(Component c) const {return data + (size_t)c*capacity;}
+		Triangle getTriangle(int i) const;
+		vec3 getNormal(int i) const {return vec3(get(NX)[i], get(NY)[i], get(NZ)[i]);}
+		unsigned getFaceId(int i) const {return faceIds[i];}
+
+	private:
+		const float *data;
+		int count, capacity;
+		const unsigned *faceIds;
+	};
+
+	TriangleBatch();
+	TriangleBatch(const TriangleBatch &other);
+	TriangleBatch &operator=(const TriangleBatch &other);
+	~TriangleBatch();
+
+	// Makes room for at least n triangles without reallocating
+	void reserve(int n);
+	// Changes the number of triangles; any new ones are undefined until set() (existing ones are kept)
+	void resize(int n);
+	void set(int i, const Triangle &tri, unsigned faceId);
+	void add(const Triangle &tri, unsigned faceId);
+	void clear();
+	void swap(TriangleBatch &other);
+	int size() const {return count;}
+
+	// The number of floats each array has room for: get(c + 1) is always get(c) + getCapacity()
+	int getCapacity() const {return capacity;}
+
+	const float *get(Component c) const {return data + (size_t)c*capacity;}
+	Triangle getTriangle(int i) const {return View(*this).getTriangle(i);}
+	vec3 getNormal(int i) const {return View(*this).getNormal(i);}
+	unsigned getFaceId(int i) const {return faceIds[i];}
+
+private:
+	float *data; // NUM_COMPONENTS arrays of capacity floats each
+	int count, capacity; // capacity is always a multiple of 8, which keeps every array 32-byte aligned
+	std::vector<unsigned> faceIds;
+
+	float *get(Component c) {return data + (size_t)c*capacity;}
+};
+
+// Intersects one ray with every sphere in the batch; t[i] receives the result for sphere i.
+// t must have room for spheres.size() values.
+void raySphereIntersectBatch(const vec3 &p0, const vec3 &v0, const SphereBatch &spheres, float *t);
+void raySphereIntersectBatch(const Ray &ray, const SphereBatch &spheres, float *t);
+
+// Intersects every ray in the batch with one sphere; t[i] receives the result for ray i.
+// t must have room for rays.size() values.
+void raySphereIntersectBatch(const RayBatch &rays, const mat4 &tInv, float *t);
+
+// Intersects a ray with triangle i of the batch; same as rayTriangleIntersect() on getTriangle(i),
+// without building the Triangle. p and D are in the triangles' space, as for the prepared-triangle
+// version in stubs.h.
+double rayTriangleIntersect(const vec3 &p, const vec3 &D, const TriangleBatch::View &triangles, int i);
+float rayTriangleIntersect(const Ray &ray, const TriangleBatch::View &triangles, int i);
+
+// Intersects one ray with every triangle in the batch; t[i] receives the result for triangle i.
+// t must have room for triangles.size() values.
+void rayTriangleIntersectBatch(const vec3 &p, const vec3 &D, const TriangleBatch::View &triangles, float *t);
+void rayTriangleIntersectBatch(const Ray &ray, const TriangleBatch::View &triangles, float *t);
+
+// The barycentric coordinates (the weights of p2 and p3) of the point where a ray hits triangle i, for
+// a ray already known to hit it - e.g. to interpolate per-corner normals at a hit.
+void getTriangleBarycentrics(const vec3 &p, const vec3 &D, const TriangleBatch::View &triangles, int i, float &u, float &v);
+void getTriangleBarycentrics(const Ray &ray, const TriangleBatch::View &triangles, int i, float &u, float &v);
+
+// Slab tests one ray against every box in the batch, SIMD_WIDTH boxes at a time (four in an SSE2 build,
+// e.g. the children of a 4-wide BVH node); t[i] receives where the ray gets into box i, no nearer than
+// its tMin, or -1 if it misses. Hits are exactly the ones rayBoxIntersect() finds, NaNs and all.
+// t must have room for boxes.size() values.
+void rayBoxIntersectBatch(const Ray &ray, const BoxBatch &boxes, float *t);
+
+#endif
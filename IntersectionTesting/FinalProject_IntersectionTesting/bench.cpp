@@ -0,0 +1,409 @@
+// Benchmarks for the intersection kernels in stubs.h and batch.h. The tests in tests.cpp say whether
+// the kernels are right; this says how fast they are, so a faster kernel can be measured against the
+// one it replaces on the same rays.
+//
+// Every kernel is run against every transform with several reproducible ray sets (the random numbers
+// come straight from a fixed-seed mt19937, whose output the standard pins down, so every platform
+// generates the same rays):
+//	hit			every ray hits, well inside the silhouette
+//	miss		every ray misses, well outside it
+//	grazing		rays aimed within a hair of the silhouette (or of the triangle's edges, or the cube's)
+//	mixed		half hits and half misses, in random order
+//	sorted		the mixed rays again, but all the hits first
+// Comparing mixed and sorted shows how much a kernel pays for branches it can't predict.
+//
+// Usage: intersection_bench [rays per set] [minimum milliseconds per measurement]
+
+#include "stubs.h"
+#include "batch.h"
+#include "simd.h"
+#include "glm/glm.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+
+using namespace glm;
+
+const double SQRT_HALF = 0.70710678; // square root of one half
+
+// The same transforms tests.cpp uses
+const mat4 IDENTITY_MATRIX = mat4();
+const mat4 DOUBLE_MATRIX(vec4(2.0f, 0.0f, 0.0f, 0.0f),
+                         vec4(0.0f, 2.0f, 0.0f, 0.0f),
+                         vec4(0.0f, 0.0f, 2.0f, 0.0f),
+                         vec4(0.0f, 0.0f, 0.0f, 1.0f));
+const mat4 TALLANDSKINNY_MATRIX(vec4(0.5f, 0.0f, 0.0f, 0.0f),
+								vec4(0.0f, 2.0f, 0.0f, 0.0f),
+								vec4(0.0f, 0.0f, 0.5f, 0.0f),
+								vec4(0.0f, 0.0f, 0.0f, 1.0f));
+const mat4 BACK5ANDTURN_MATRIX(vec4(SQRT_HALF, 0.0f, -SQRT_HALF, 0.0f),
+                                  vec4(0.0f, 1.0f, 0.0f, 0.0f),
+                                  vec4(SQRT_HALF, 0.0f, SQRT_HALF, 0.0f),
+                                  vec4(0.0f, 0.0f, -5.0f, 1.0f));
+
+const vec3 POINT_N1N10(-1.0f, -1.0f, 0.0f);
+const vec3 POINT_1N10(1.0f, -1.0f, 0.0f);
+const vec3 POINT_010(0.0f, 1.0f, 0.0f);
+
+const unsigned int SEED = 361;
+const float RAY_DISTANCE = 10; // how far (in object space) from its target each ray starts
+const float GRAZE = 1e-3f; // how far from the silhouette grazing rays are aimed
+const int SPHERES_PER_BATCH = 16; // for the one ray, many spheres kernel
+const int TRIANGLES_PER_BATCH = 16; // for the one ray, many triangles kernel
+
+enum ShapeType {SPHERE, TRIANGLE, CUBE};
+enum RayCategory {HIT, MISS, GRAZING};
+
+// Everything a kernel might want to know about the object it's intersecting, prepared up front the
+// way a raytracer would (once per object, not once per ray)
+struct BenchObject {
+	ShapeType shape;
+	mat4 tInv;
+	Triangle tri;
+	SphereBatch spheres; // SPHERES_PER_BATCH copies of the sphere
+	TriangleBatch triangles; // TRIANGLES_PER_BATCH copies of tri
+};
+
+// A set of rays, in world space and (transformed by the object's tInv, as the world-space kernels
+// do it) in object space. The Rays are made up front, like a raytracer would when it generates them,
+// so their precomputation isn't counted against the kernels.
+struct BenchRays {
+	std::string name;
+	std::vector<vec3> origins, directions;
+	std::vector<Ray> rays, objectRays;
+	RayBatch batch;
+};
+
+// A kernel intersects every ray in the set with the object, writing one t per ray
+typedef void (*KernelFunc)(const BenchRays &rays, const BenchObject &object, float *t);
+
+struct Kernel {
+	const char *name;
+	ShapeType shape;
+	KernelFunc func;
+	int testsPerRay;
+};
+
+struct Transform {
+	const char *name;
+	mat4 matrix;
+};
+
+// ** Kernels **
+
+void SphereKernel(const BenchRays &rays, const BenchObject &object, float *t) {
+	for(size_t i = 0; i < rays.rays.size(); i++)
+		t[i] = (float)raySphereIntersect(rays.rays[i], object.tInv);
+}
+
+void SphereBatchRaysKernel(const BenchRays &rays, const BenchObject &object, float *t) {
+	raySphereIntersectBatch(rays.batch, object.tInv, t);
+}
+
+void SphereBatchSpheresKernel(const BenchRays &rays, const BenchObject &object, float *t) {
+	float batchT[SPHERES_PER_BATCH];
+	for(size_t i = 0; i < rays.rays.size(); i++) {
+		raySphereIntersectBatch(rays.rays[i], object.spheres, batchT);
+		t[i] = batchT[0];
+	}
+}
+
+void TriangleKernel(const BenchRays &rays, const BenchObject &object, float *t) {
+	for(size_t i = 0; i < rays.rays.size(); i++)
+		t[i] = (float)rayTriangleIntersect(rays.rays[i], POINT_N1N10, POINT_1N10, POINT_010, object.tInv);
+}
+
+void PreparedTriangleKernel(const BenchRays &rays, const BenchObject &object, float *t) {
+	for(size_t i = 0; i < rays.objectRays.size(); i++)
+		t[i] = (float)rayTriangleIntersect(rays.objectRays[i], object.tri);
+}
+
+void TriangleBatchKernel(const BenchRays &rays, const BenchObject &object, float *t) {
+	float batchT[TRIANGLES_PER_BATCH];
+	for(size_t i = 0; i < rays.objectRays.size(); i++) {
+		rayTriangleIntersectBatch(rays.objectRays[i], object.triangles, batchT);
+		t[i] = batchT[0];
+	}
+}
+
+void CubeKernel(const BenchRays &rays, const BenchObject &object, float *t) {
+	for(size_t i = 0; i < rays.rays.size(); i++)
+		t[i] = (float)rayCubeIntersect(rays.rays[i], object.tInv);
+}
+
+void ObjectSpaceCubeKernel(const BenchRays &rays, const BenchObject &, float *t) {
+	for(size_t i = 0; i < rays.objectRays.size(); i++)
+		t[i] = (float)rayCubeIntersect(rays.objectRays[i]);
+}
+
+const Kernel KERNELS[] = {
+	{"sphere", SPHERE, SphereKernel, 1},
+	{"sphere batch (rays)", SPHERE, SphereBatchRaysKernel, 1},
+	{"sphere batch (spheres)", SPHERE, SphereBatchSpheresKernel, SPHERES_PER_BATCH},
+	{"triangle", TRIANGLE, TriangleKernel, 1},
+	{"triangle (prepared)", TRIANGLE, PreparedTriangleKernel, 1},
+	{"triangle batch", TRIANGLE, TriangleBatchKernel, TRIANGLES_PER_BATCH},
+	{"cube", CUBE, CubeKernel, 1},
+	{"cube (object space)", CUBE, ObjectSpaceCubeKernel, 1},
+};
+
+const Transform TRANSFORMS[] = {
+	{"IDENTITY", IDENTITY_MATRIX},
+	{"DOUBLE", DOUBLE_MATRIX},
+	{"TALLANDSKINNY", TALLANDSKINNY_MATRIX},
+	{"BACK5ANDTURN", BACK5ANDTURN_MATRIX},
+};
+
+// ** Ray generation **
+
+class BenchRandom {
+public:
+	BenchRandom(unsigned int seed) : engine(seed) {}
+
+	// Uniform in [lo, hi), built from the engine's raw output rather than a std distribution (whose
+	// algorithms vary between standard libraries) so the rays are the same everywhere
+	float uniform(float lo, float hi) {
+		return lo + (hi - lo) * ((engine() >> 8) * (1.0f / 16777216.0f));
+	}
+
+	vec3 unitVector() {
+		for(;;) {
+			vec3 v(uniform(-1, 1), uniform(-1, 1), uniform(-1, 1));
+			float len2 = glm::dot(v, v);
+			if(len2 > 1e-4f && len2 <= 1)
+				return v / std::sqrt(len2);
+		}
+	}
+
+	// A unit vector perpendicular to the unit vector d
+	vec3 perpendicular(const vec3 &d) {
+		for(;;) {
+			vec3 w = unitVector();
+			vec3 u = w - glm::dot(w, d) * d;
+			float len2 = glm::dot(u, u);
+			if(len2 > 1e-4f)
+				return u / std::sqrt(len2);
+		}
+	}
+
+	bool coinFlip() {return (engine() & 1) != 0;}
+
+private:
+	std::mt19937 engine;
+};
+
+// Picks an object-space ray of the given category for the shape: a direction, and a point on the ray
+// (the target) that decides whether it hits
+void MakeObjectRay(ShapeType shape, RayCategory category, BenchRandom &random, vec3 &target, vec3 &direction) {
+	direction = random.unitVector();
+
+	if(shape == TRIANGLE) {
+		// The triangle lies in the z = 0 plane; keep rays from running (nearly) parallel to it
+		while(std::abs(direction.z) < 0.2f)
+			direction = random.unitVector();
+
+		// Choose barycentric coordinates (u, v) for the target in the triangle's plane
+		float u, v;
+		if(category == HIT) {
+			do {
+				u = random.uniform(0.02f, 0.98f);
+				v = random.uniform(0.02f, 0.98f);
+			} while(u + v > 0.98f);
+		}
+		else if(category == MISS) {
+			do {
+				u = random.uniform(-1, 2);
+				v = random.uniform(-1, 2);
+			} while(u > -0.02f && v > -0.02f && u + v < 1.02f);
+		}
+		else {
+			// Somewhere along one of the three edges, nudged a hair to one side of it or the other
+			float along = random.uniform(0, 1);
+			float across = random.uniform(-GRAZE, GRAZE);
+			switch(int(random.uniform(0, 3))) {
+				case 0: u = along; v = across; break;
+				case 1: u = across; v = along; break;
+				default: u = along - across; v = 1 - along; break;
+			}
+		}
+		target = POINT_N1N10 + u * (POINT_1N10 - POINT_N1N10) + v * (POINT_010 - POINT_N1N10);
+		return;
+	}
+
+	if(category == GRAZING && shape == CUBE) {
+		// Somewhere along one of the cube's edges: one coordinate anywhere, the other two at the faces
+		// (give or take a hair)
+		int axis = int(random.uniform(0, 3));
+		for(int i = 0; i < 3; i++) {
+			if(i == axis)
+				target[i] = random.uniform(-0.5f, 0.5f);
+			else
+				target[i] = (random.coinFlip() ? 0.5f : -0.5f) + random.uniform(-GRAZE, GRAZE);
+		}
+		return;
+	}
+
+	// Otherwise aim at a point in the plane through the center perpendicular to the ray, at a distance
+	// from the center that decides the outcome. For the sphere (radius 1) that's exact; for the cube,
+	// anything closer than 0.5 is inside it, and anything farther than sqrt(3)/2 is outside even its corners.
+	float r;
+	if(shape == SPHERE)
+		r = (category == HIT) ? random.uniform(0, 0.95f) : (category == MISS) ? random.uniform(1.05f, 2) : random.uniform(1 - GRAZE, 1 + GRAZE);
+	else
+		r = (category == HIT) ? random.uniform(0, 0.45f) : random.uniform(0.9f, 2);
+	target = r * random.perpendicular(direction);
+}
+
+// Builds a set of numRays rays from the given categories (chosen at random if there's more than one),
+// transformed into world space by T
+BenchRays MakeRays(const std::string &name, ShapeType shape, const mat4 &T, const std::vector<RayCategory> &categories, int numRays, BenchRandom &random) {
+	BenchRays rays;
+	rays.name = name;
+	for(int i = 0; i < numRays; i++) {
+		RayCategory category = categories[categories.size() == 1 ? 0 : int(random.uniform(0, (float)categories.size()))];
+		vec3 target, direction;
+		MakeObjectRay(shape, category, random, target, direction);
+		vec3 origin = target - RAY_DISTANCE * direction;
+
+		rays.origins.push_back(v4Tov3(T * vec4(origin, 1)));
+		rays.directions.push_back(glm::normalize(mat3(T) * direction));
+	}
+	return rays;
+}
+
+// Fills in the Rays (world and object space) and the batch, once the world-space rays are final
+void PrepareRays(BenchRays &rays, const mat4 &tInv) {
+	rays.rays.clear();
+	rays.objectRays.clear();
+	rays.batch.clear();
+	for(size_t i = 0; i < rays.origins.size(); i++) {
+		Ray ray(rays.origins[i], rays.directions[i], 0, std::numeric_limits<float>::infinity(), (int)i);
+		rays.rays.push_back(ray);
+		rays.objectRays.push_back(ray.transformed(tInv));
+		rays.batch.add(rays.origins[i], rays.directions[i]);
+	}
+}
+
+// The mixed rays reordered with every hit first (keeping the order within the hits and the misses)
+BenchRays SortRays(const BenchRays &mixed, const std::string &name, ShapeType shape, const mat4 &tInv) {
+	BenchRays hits, misses;
+	for(size_t i = 0; i < mixed.origins.size(); i++) {
+		double t;
+		if(shape == SPHERE)
+			t = raySphereIntersect(mixed.origins[i], mixed.directions[i], tInv);
+		else if(shape == TRIANGLE)
+			t = rayTriangleIntersect(mixed.origins[i], mixed.directions[i], POINT_N1N10, POINT_1N10, POINT_010, tInv);
+		else
+			t = rayCubeIntersect(mixed.origins[i], mixed.directions[i], tInv);
+
+		BenchRays &dest = (t >= 0) ? hits : misses;
+		dest.origins.push_back(mixed.origins[i]);
+		dest.directions.push_back(mixed.directions[i]);
+	}
+	hits.name = name;
+	hits.origins.insert(hits.origins.end(), misses.origins.begin(), misses.origins.end());
+	hits.directions.insert(hits.directions.end(), misses.directions.begin(), misses.directions.end());
+	return hits;
+}
+
+// ** Measurement **
+
+typedef std::chrono::high_resolution_clock Clock;
+
+float g_sink = 0; // results are summed into this, and it's printed at the end, so no kernel call can be optimized away
+
+// Runs the kernel over the rays until at least minSeconds have passed, and reports the rate
+void Measure(const Kernel &kernel, const char *transformName, const BenchRays &rays, const BenchObject &object, double minSeconds) {
+	int numRays = (int)rays.origins.size();
+	std::vector<float> t(numRays);
+
+	kernel.func(rays, object, &t[0]); // warm up (and count the hits)
+	int numHits = 0;
+	for(int i = 0; i < numRays; i++)
+		if(t[i] >= 0)
+			numHits++;
+
+	long long passes = 0;
+	double seconds = 0;
+	Clock::time_point start = Clock::now();
+	do {
+		kernel.func(rays, object, &t[0]);
+		g_sink += t[passes % numRays];
+		passes++;
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	} while(seconds < minSeconds);
+
+	double raysTraced = double(passes) * numRays;
+	std::cout << std::setfill(' ') << std::left
+		<< std::setw(24) << kernel.name
+		<< std::setw(15) << transformName
+		<< std::setw(9) << rays.name
+		<< std::right << std::fixed
+		<< std::setw(10) << std::setprecision(2) << raysTraced / seconds / 1e6
+		<< std::setw(10) << std::setprecision(2) << seconds * 1e9 / (raysTraced * kernel.testsPerRay)
+		<< std::setw(8) << std::setprecision(1) << 100.0 * numHits / numRays << "%"
+		<< std::endl;
+}
+
+int main(int argc, char** argv) {
+	int numRays = (argc > 1) ? atoi(argv[1]) : 100000;
+	double minSeconds = ((argc > 2) ? atof(argv[2]) : 100) / 1000;
+	if(numRays <= 0) {
+		std::cerr << "Usage: " << argv[0] << " [rays per set] [minimum milliseconds per measurement]" << std::endl;
+		return 1;
+	}
+
+	std::cout << numRays << " rays per set, SIMD width " << SIMD_WIDTH << std::endl;
+	std::cout << std::left << std::setw(24) << "kernel" << std::setw(15) << "transform" << std::setw(9) << "rays"
+		<< std::right << std::setw(10) << "Mrays/s" << std::setw(10) << "ns/test" << std::setw(9) << "hits" << std::endl;
+
+	const int numKernels = sizeof(KERNELS) / sizeof(KERNELS[0]);
+	const int numTransforms = sizeof(TRANSFORMS) / sizeof(TRANSFORMS[0]);
+	const ShapeType shapes[] = {SPHERE, TRIANGLE, CUBE};
+
+	for(int s = 0; s < 3; s++) {
+		for(int m = 0; m < numTransforms; m++) {
+			const mat4 &T = TRANSFORMS[m].matrix;
+
+			BenchObject object;
+			object.shape = shapes[s];
+			object.tInv = glm::inverse(T);
+			object.tri = buildTriangle(POINT_N1N10, POINT_1N10, POINT_010);
+			for(int i = 0; i < SPHERES_PER_BATCH; i++)
+				object.spheres.add(object.tInv);
+			for(int i = 0; i < TRIANGLES_PER_BATCH; i++)
+				object.triangles.add(object.tri, 0);
+
+			// Each (shape, transform) pair gets its own seed, so its rays don't depend on what else is run
+			BenchRandom random(SEED + 16 * s + m);
+			std::vector<BenchRays> sets;
+			sets.push_back(MakeRays("hit", shapes[s], T, std::vector<RayCategory>(1, HIT), numRays, random));
+			sets.push_back(MakeRays("miss", shapes[s], T, std::vector<RayCategory>(1, MISS), numRays, random));
+			sets.push_back(MakeRays("grazing", shapes[s], T, std::vector<RayCategory>(1, GRAZING), numRays, random));
+			std::vector<RayCategory> hitOrMiss;
+			hitOrMiss.push_back(HIT);
+			hitOrMiss.push_back(MISS);
+			sets.push_back(MakeRays("mixed", shapes[s], T, hitOrMiss, numRays, random));
+			sets.push_back(SortRays(sets.back(), "sorted", shapes[s], object.tInv));
+			for(size_t i = 0; i < sets.size(); i++)
+				PrepareRays(sets[i], object.tInv);
+
+			for(int k = 0; k < numKernels; k++) {
+				if(KERNELS[k].shape != shapes[s])
+					continue;
+				for(size_t i = 0; i < sets.size(); i++)
+					Measure(KERNELS[k], TRANSFORMS[m].name, sets[i], object, minSeconds);
+			}
+		}
+	}
+
+	std::cout << "(checksum " << g_sink << ")" << std::endl;
+	return 0;
+}
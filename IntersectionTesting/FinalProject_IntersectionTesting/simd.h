@@ -0,0 +1,70 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Thin wrappers over the widest float SIMD instruction set the compiler is targeting, so the batch
+// kernels can be written once and compiled as 8 lanes (AVX/AVX2), 4 lanes (SSE2), or not at all.
+// SIMD_WIDTH is the number of float lanes in a floatN; it's 1 when there is no SIMD support, in
+// which case the batch kernels run entirely on their scalar fallback path.
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SIMD_WIDTH 4
+#else
+	#define SIMD_WIDTH 1
+#endif
+
+#if SIMD_WIDTH == 8
+
+typedef __m256 floatN;
+
+inline floatN loadN(const float *p) {return _mm256_loadu_ps(p);}
+inline floatN loadAlignedN(const float *p) {return _mm256_load_ps(p);} // p must be 32-byte aligned
+inline void storeN(float *p, floatN a) {_mm256_storeu_ps(p, a);}
+inline floatN setN(float a) {return _mm256_set1_ps(a);}
+inline floatN addN(floatN a, floatN b) {return _mm256_add_ps(a, b);}
+inline floatN subN(floatN a, floatN b) {return _mm256_sub_ps(a, b);}
+inline floatN mulN(floatN a, floatN b) {return _mm256_mul_ps(a, b);}
+inline floatN divN(floatN a, floatN b) {return _mm256_div_ps(a, b);}
+inline floatN sqrtN(floatN a) {return _mm256_sqrt_ps(a);}
+inline floatN minN(floatN a, floatN b) {return _mm256_min_ps(a, b);}
+inline floatN maxN(floatN a, floatN b) {return _mm256_max_ps(a, b);}
+inline floatN lessN(floatN a, floatN b) {return _mm256_cmp_ps(a, b, _CMP_LT_OQ);}
+inline floatN greaterEqualN(floatN a, floatN b) {return _mm256_cmp_ps(a, b, _CMP_GE_OQ);}
+inline floatN greaterN(floatN a, floatN b) {return _mm256_cmp_ps(a, b, _CMP_GT_OQ);}
+inline floatN equalN(floatN a, floatN b) {return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);}
+inline floatN orN(floatN a, floatN b) {return _mm256_or_ps(a, b);}
+// One bit per lane (lane 0 in bit 0) of a comparison result
+inline int maskN(floatN mask) {return _mm256_movemask_ps(mask);}
+// Per lane: mask ? a : b (mask lanes must be all ones or all zeros, as produced by the comparisons above)
+inline floatN selectN(floatN mask, floatN a, floatN b) {return _mm256_blendv_ps(b, a, mask);}
+
+#elif SIMD_WIDTH == 4
+
+typedef __m128 floatN;
+
+inline floatN loadN(const float *p) {return _mm_loadu_ps(p);}
+inline floatN loadAlignedN(const float *p) {return _mm_load_ps(p);} // p must be 16-byte aligned
+inline void storeN(float *p, floatN a) {_mm_storeu_ps(p, a);}
+inline floatN setN(float a) {return _mm_set1_ps(a);}
+inline floatN addN(floatN a, floatN b) {return _mm_add_ps(a, b);}
+inline floatN subN(floatN a, floatN b) {return _mm_sub_ps(a, b);}
+inline floatN mulN(floatN a, floatN b) {return _mm_mul_ps(a, b);}
+inline floatN divN(floatN a, floatN b) {return _mm_div_ps(a, b);}
+inline floatN sqrtN(floatN a) {return _mm_sqrt_ps(a);}
+inline floatN minN(floatN a, floatN b) {return _mm_min_ps(a, b);}
+inline floatN maxN(floatN a, floatN b) {return _mm_max_ps(a, b);}
+inline floatN lessN(floatN a, floatN b) {return _mm_cmplt_ps(a, b);}
+inline floatN greaterEqualN(floatN a, floatN b) {return _mm_cmpge_ps(a, b);}
+inline floatN greaterN(floatN a, floatN b) {return _mm_cmpgt_ps(a, b);}
+inline floatN equalN(floatN a, floatN b) {return _mm_cmpeq_ps(a, b);}
+inline floatN orN(floatN a, floatN b) {return _mm_or_ps(a, b);}
+inline int maskN(floatN mask) {return _mm_movemask_ps(mask);}
+// SSE2 has no blend instruction, so do it with bitwise ops
+inline floatN selectN(floatN mask, floatN a, floatN b) {return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));}
+
+#endif
+
+#endif
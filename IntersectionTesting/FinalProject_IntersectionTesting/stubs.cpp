@@ -1,5 +1,8 @@
 #include "stubs.h"
 
+#include <cfloat>
+#include <cmath>
+
 using namespace glm;
 
 double Test_RaySphereIntersect(const vec3& P0, const vec3& V0, const mat4& T) {
@@ -22,100 +25,108 @@ double Test_RayCubeIntersect(const vec3& P0, const vec3& V0, const mat4& T) {
 
 double raySphereIntersect(const vec3 &p0, const vec3 &v0, const mat4 &tInv)
 {
-	vec4 D(glm::normalize(v0), 0); // note: D = || P - E || = || v0 || (recall that v0 = P - E)
-    mat4 tStarInv = tInv; // tInv with three elements zeroed out - a special form that we need to transform D
-    tStarInv[3][0] = tStarInv[3][1] = tStarInv[3][2] = 0;
-    D = tStarInv * D;
+	return raySphereIntersect(Ray(p0, glm::normalize(v0)), tInv);
+}
 
-	// Transform p0 with tInv (we don't want the three elements zeroed out for this)
-	vec4 p(p0, 1);
-	p = tInv * p;
+float raySphereIntersect(const Ray &ray, const mat4 &tInv)
+{
+	// Bring the ray into object space: directions ignore tInv's translation, positions don't
+	return raySphereIntersect(ray.transformed(tInv));
+}
+
+float raySphereIntersect(const Ray &ray)
+{
+	const vec3 &p = ray.origin, &D = ray.direction;
 	// Since we're in model space, the sphere is simply a unit sphere centered at the origin.
 	// Substituting our ray equation, R = p + tD, into the sphere's equation, we get a quadratic equation with:
-	// a = 1; b = 2D . (p - (0,0,0)); c = || p - (0,0,0) ||^2 - 1
-
-	// Solve for t:
-	vec3 dTimes2 = v4Tov3(D);
-	dTimes2 *= 2;
-	double a = 1.0;
-	double b = glm::dot(dTimes2, v4Tov3(p));
-	double pLen = glm::length(v4Tov3(p));
-	double c = pLen*pLen - 1;
-	
-	double discriminant = b*b - 4*a*c;
-	if(discriminant == 0) // one real solution
-	{
-		double t = (-b)/(2*a);
-		return t;
-	}
-	else if(discriminant > 0) // two real solutions
-	{
-		double t1 = (-b + sqrt(discriminant))/(2*a);
-		double t2 = (-b - sqrt(discriminant))/(2*a);
-		// If either value of t is positive, we want the smaller; otherwise, there's no intersection, and we should return -1
-		if(t1 <= t2 && t1 >= 0)
-			return t1;
-		else if(t1 > t2 && t2 >= 0)
-			return t2;
-		else
-			return -1;
-	}
-	else // no solutions, i.e. no intersection
+	// a = D . D; b = 2D . (p - (0,0,0)); c = || p - (0,0,0) ||^2 - 1
+	// (a is only 1 if the sphere isn't scaled, since D has been through tInv.) We use the half-b form (b/2 everywhere) so we
+	// can drop the 2s and 4s - but the textbook formula throws away most of a float's precision in places that matter, so:
+	float a = glm::dot(D, D), invA = 1 / a;
+	float b = glm::dot(D, p);
+
+	// The discriminant b^2 - ac is a(1 - |l|^2), where l = p - (b/a)D is the point on the ray's line nearest the center. From far
+	// away, b^2 and ac are big and nearly equal, and subtracting them leaves mostly rounding error; l is small and accurate.
+	vec3 l = p - (b * invA) * D;
+	float discriminant = a * (1 - glm::dot(l, l));
+	if(discriminant < 0) // no solutions, i.e. no intersection
 		return -1;
+	float c = glm::dot(p, p) - 1;
+
+	// Of the two roots, (-b - root)/a and (-b + root)/a, one adds numbers of the same sign and the other cancels. Work out the
+	// first one, q/a, and get the other from the product of the roots, c/a, instead.
+	float root = sqrt(discriminant);
+	float q = (b < 0) ? root - b : -(b + root);
+	float tA = q * invA, tB = (q != 0) ? c / q : tA; // q is only 0 for a ray grazing the sphere at t = 0
+	float t1 = glm::min(tA, tB); // the nearer of the two solutions
+	if(t1 >= ray.tMin)
+		return (t1 <= ray.tMax) ? t1 : -1;
+	float t2 = glm::max(tA, tB); // if only this one is in range, the ray starts inside the sphere
+	if(t2 >= ray.tMin && t2 <= ray.tMax)
+		return t2;
+	return -1;
 }
 
 double rayTriangleIntersect(const vec3 &p0, const vec3 &v0, const vec3 &p1, const vec3 &p2, const vec3 &p3, const mat4 &tInv)
 {
-	vec4 D(glm::normalize(v0), 0); // note: D = || P - E || = || v0 || (recall that v0 = P - E)
-	mat4 tStarInv = tInv; // tInv with three elements zeroed out - a special form that we need to transform D
-	tStarInv[3][0] = tStarInv[3][1] = tStarInv[3][2] = 0;
-	D = tStarInv * D;
-
-	vec4 pos(p0,1);
-	pos = tInv * pos;
-
-	vec4 point1(p1,1);
-	vec4 point2(p2,1);
-	vec4 point3(p3,1);
+	return rayTriangleIntersect(Ray(p0, glm::normalize(v0)), p1, p2, p3, tInv);
+}
 
+float rayTriangleIntersect(const Ray &ray, const vec3 &p1, const vec3 &p2, const vec3 &p3, const mat4 &tInv)
+{
+	// Bring the ray into object space: directions ignore tInv's translation, positions don't
+	return rayTriangleIntersect(ray.transformed(tInv), buildTriangle(p1, p2, p3));
+}
 
-	//RAY-PLANE INTERSECTION 
-	//will find intersection point on plane, R
-	vec4 R; //intersection point
-	vec3 normal; //normal for triangle
-	float t; //t in the ray equation
+Triangle buildTriangle(const vec3 &p1, const vec3 &p2, const vec3 &p3)
+{
+	Triangle tri;
+	tri.p1 = p1;
+	tri.e1 = p2 - p1;
+	tri.e2 = p3 - p1;
+	tri.normal = glm::normalize(glm::cross(tri.e1, tri.e2));
+	return tri;
+}
 
-	//find normal of triangle
-	normal = glm::cross((v4Tov3(point1) - v4Tov3(point2)), (v4Tov3(point3) - v4Tov3(point2)));
-	glm::normalize(normal);
+// Moller-Trumbore: solve p + tD = p1 + u*e1 + v*e2 for (t, u, v) with Cramer's rule, rejecting as soon as one of the barycentric
+// coordinates lands outside the triangle. Returns false on a miss; otherwise t is wherever along the line the hit is.
+static bool triangleHit(const vec3 &p, const vec3 &D, const Triangle &tri, float &t)
+{
+	vec3 pvec = glm::cross(D, tri.e2);
+	float det = glm::dot(tri.e1, pvec);
+	if(det == 0) // ray is parallel to the triangle's plane
+		return false;
+	// (We don't reject det < 0 - that's a ray hitting the back face, and triangles are two-sided.)
+	float invDet = 1 / det;
+
+	vec3 tvec = p - tri.p1;
+	float u = glm::dot(tvec, pvec) * invDet;
+	if(u < 0 || u > 1)
+		return false;
+
+	vec3 qvec = glm::cross(tvec, tri.e1);
+	float v = glm::dot(D, qvec) * invDet;
+	if(v < 0 || u + v > 1)
+		return false;
+
+	t = glm::dot(tri.e2, qvec) * invDet;
+	return true;
+}
 
-	//find t
-	//make sure the denominator isn't zero:
-	float denom = glm::dot(normal, v4Tov3(D));
-	if(denom == 0)
+double rayTriangleIntersect(const vec3 &p, const vec3 &D, const Triangle &tri)
+{
+	float t;
+	if(!triangleHit(p, D, tri, t) || t < 0)
 		return -1;
+	return t;
+}
 
-	float numerator = glm::dot(normal, v4Tov3(point1 - pos));
-
-	t = numerator/denom;
-	if(t<0) return -1;
-
-	//now put t in ray equation to find intersection point R:
-	D *= t;
-	R = pos + D;
-
-	//NOW TEST TO SEE IF POINT IS INSIDE TRIANGLE
-	float s = area(v4Tov3(point1), v4Tov3(point2), v4Tov3(point3)); 
-	float s1 = area(v4Tov3(R), v4Tov3(point2), v4Tov3(point3)) / s; 
-	if(s1 > 1 || s1 < 0) return -1; //we know it's outside the circle
-	float s2 = area(v4Tov3(R), v4Tov3(point3), v4Tov3(point1)) / s; 
-	if(s2 > 1 || s2 < 0) return -1; //we know it's outside the circle
-	float s3 = area(v4Tov3(R), v4Tov3(point1), v4Tov3(point2)) / s; 
-	if(s3 > 1 || s3 < 0) return -1; //we know it's outside the circle
-
-	if(epsilonEquals(1, s1+s2+s3)) return t;
-
-	return -1;
+float rayTriangleIntersect(const Ray &ray, const Triangle &tri)
+{
+	float t;
+	if(!triangleHit(ray.origin, ray.direction, tri, t) || t < ray.tMin || t > ray.tMax)
+		return -1;
+	return t;
 }
 
 bool epsilonEquals(float n, float m) 
@@ -136,70 +147,63 @@ float area(vec3 p1, vec3 p2, vec3 p3)
 
 double rayCubeIntersect(const vec3 &p0, const vec3 &v0, const mat4 &tInv)
 {
-	vec4 D(glm::normalize(v0), 0); // note: D = || P - E || = || v0 || (recall that v0 = P - E)
-    mat4 tStarInv = tInv; // tInv with three elements zeroed out - a special form that we need to transform D
-    tStarInv[3][0] = tStarInv[3][1] = tStarInv[3][2] = 0;
-    D = tStarInv * D;
-
-	//Transform p0 with tInv 
-	vec4 p(p0, 1);
-	p = tInv * p;
-
-	//bounds are {-0.5, -0.5, -0.5} -> {0.5, 0.5, 0.5} since this is all in local space
-	float T1x = (-0.5 - p.x) / D.x;
-	float T2x = ( 0.5 - p.x) / D.x;
-	float T1y = (-0.5 - p.y) / D.y;
-	float T2y = ( 0.5 - p.y) / D.y;
-	float T1z = (-0.5 - p.z) / D.z;
-	float T2z = ( 0.5 - p.z) / D.z;
-
-	float tmin, tmax, tymin, tymax, tzmin, tzmax;
-	
-	/*	The next three defined floats are to avoid the case where the direction components would be -0.0
-		This is only a small part of the time, but sometimes that can happen through various operations,
-		and if it does happen, it screws up calculations. Defining this division float and then multiplying
-		it in is not only faster on the CPU, but it gets rid of that zero problem.
+	return rayCubeIntersect(Ray(p0, glm::normalize(v0)), tInv);
+}
+
+float rayCubeIntersect(const Ray &ray, const mat4 &tInv)
+{
+	// Bring the ray into object space: directions ignore tInv's translation, positions don't
+	return rayCubeIntersect(ray.transformed(tInv));
+}
+
+double rayCubeIntersect(const vec3 &p, const vec3 &D)
+{
+	return rayCubeIntersect(Ray(p, D));
+}
+
+//bounds are {-0.5, -0.5, -0.5} -> {0.5, 0.5, 0.5} since this is all in local space
+static const vec3 UNIT_CUBE[2] = {vec3(-0.5f), vec3(0.5f)};
+
+float rayCubeIntersect(const Ray &ray)
+{
+	/*	rayBoxIntersect() takes care of the cases that used to need special handling here: a direction component of -0.0 (which
+		can come out of various operations) has a reciprocal of -infinity, so the ray's sign flags count it as negative and the
+		slab's planes come out the right way around, and a ray parallel to a face gives NaNs that the slab test passes over.
 	*/
-	float divideByDirectionX = 1 / D.x;
-	float divideByDirectionY = 1 / D.y;
-	float divideByDirectionZ = 1 / D.z;
-	
-	if (divideByDirectionX >= 0) {
-		tmin = (-0.5 - p.x) * divideByDirectionX;
-		tmax = ( 0.5 - p.x) * divideByDirectionX;
-	} else {
-		tmin = ( 0.5 - p.x) * divideByDirectionX;
-		tmax = (-0.5 - p.x) * divideByDirectionX;
-	}
-	
-	if (divideByDirectionY >= 0) {
-		tymin = (-0.5 - p.y) * divideByDirectionY;
-		tymax = ( 0.5 - p.y) * divideByDirectionY;
-	} else {
-		tymin = ( 0.5 - p.y) * divideByDirectionY;
-		tymax = (-0.5 - p.y) * divideByDirectionY;
-	}
-	
-	if ( (tmin > tymax) || (tymin > tmax) ) return -1.0;
-
-	if (tymin > tmin) tmin = tymin;
-	if (tymax < tmax) tmax = tymax;
-	
-	if (divideByDirectionZ >= 0) {
-		tzmin = (-0.5 - p.z) * divideByDirectionZ;
-		tzmax = ( 0.5 - p.z) * divideByDirectionZ;
-	} else {
-		tzmin = ( 0.5 - p.z) * divideByDirectionZ;
-		tzmax = (-0.5 - p.z) * divideByDirectionZ;
-	}
-
-	if ( (tmin > tzmax) || (tzmin > tmax) ) return -1.0;
-	if (tzmin > tmin) tmin = tzmin;
-	if (tzmax < tmax) tmax = tzmax;
-
-	//-10000000 -> 10000000 is maybe not what i want... it's supposed to be t0 -> t1 where that's a valid intersection interval
-	if ((tmin < 100000000) && (tmax > -100000000)) { 
-		return tmin;
-	}
-	return -1;
-}
\ No newline at end of file
+	float tEnter, tExit;
+	if (!rayBoxIntersect(ray, UNIT_CUBE, tEnter, tExit)) return -1;
+
+	// The nearest bit of surface in the interval: where the ray gets into the cube, or if it's already inside by tMin, where it leaves
+	float t = (tEnter >= ray.tMin) ? tEnter : tExit;
+	return (t <= ray.tMax) ? t : -1;
+}
+
+// Comfortably more than the worst rounding the float kernels (and the ray transformation in front of them) were measured to have,
+// relative to the size of the coordinates, over a million random hits within the limits described in stubs.h: about 120 ulps,
+// almost all of it from the triangle test on narrow triangles. Spheres and cubes stay within a handful.
+static const float HIT_ERROR_ULPS = 512;
+
+vec3 hitPointError(const vec3 &p, const vec3 &D, float t)
+{
+	return (HIT_ERROR_ULPS * FLT_EPSILON) * (glm::abs(p) + glm::abs(t * D));
+}
+
+// The next float past f in the given direction (at least), however big or small f is
+static float nudge(float f, float direction)
+{
+	float step = glm::max(std::abs(f) * FLT_EPSILON, FLT_MIN);
+	return (direction > 0) ? f + step : f - step;
+}
+
+vec3 offsetRayOrigin(const vec3 &hit, const vec3 &error, const vec3 &normal)
+{
+	// The farthest the error box reaches along the normal, and the hit point moved that far
+	vec3 offset = glm::dot(glm::abs(normal), error) * normal;
+	vec3 origin = hit + offset;
+
+	// Adding the offset rounds as well, possibly back toward the surface, so push each coordinate on a little further
+	for(int axis = 0; axis < 3; axis++)
+		if(offset[axis] != 0)
+			origin[axis] = nudge(origin[axis], offset[axis]);
+	return origin;
+}
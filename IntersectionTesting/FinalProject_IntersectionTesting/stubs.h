@@ -1,7 +1,10 @@
 #ifndef STUBS_H
 #define STUBS_H
 
-#include "glm\glm.hpp"
+#include "glm/glm.hpp"
+#include "../../Ray Generation/Ray Generation/Ray.h"
+
+#include <limits>
 
 using namespace glm;
 
@@ -41,6 +44,77 @@ double raySphereIntersect(const vec3 &p0, const vec3 &v0, const mat4 &tInv);
 double rayTriangleIntersect(const vec3 &p0, const vec3 &v0, const vec3 &p1, const vec3 &p2, const vec3 &p3, const mat4 &tInv);
 double rayCubeIntersect(const vec3 &p0, const vec3 &v0, const mat4 &tInv);
 
+// ** The same, and the object-space functions below, for a Ray. These use the ray's direction as it is (so t is in units of    **
+// ** it, and a ray that's already unit length isn't normalized again) and its precomputed reciprocal, and only report hits   **
+// ** in the ray's [tMin, tMax] - the nearest one there, or -1 - where the others report the nearest hit at t >= 0.            **
+// ** They're float all the way through, like the batch functions; the ones above wrap them. hitPointError() below bounds     **
+// ** how far off the surface the hits they find can be.                                                                      **
+float raySphereIntersect(const Ray &ray, const mat4 &tInv);
+float rayTriangleIntersect(const Ray &ray, const vec3 &p1, const vec3 &p2, const vec3 &p3, const mat4 &tInv);
+float rayCubeIntersect(const Ray &ray, const mat4 &tInv);
+
+// Intersects a ray with the unit sphere, with the ray already in the sphere's object space (the world-space version wraps this one)
+float raySphereIntersect(const Ray &ray);
+
+// A triangle prepared for Moller-Trumbore intersection: one corner, the two edges leaving it, and the
+// face normal. Build these once per mesh (in object space) rather than passing three points to
+// rayTriangleIntersect() for every test, since that rebuilds all of this each time.
+struct Triangle
+{
+	vec3 p1;
+	vec3 e1, e2; // p2 - p1 and p3 - p1
+	vec3 normal; // normalized e1 x e2
+};
+
+Triangle buildTriangle(const vec3 &p1, const vec3 &p2, const vec3 &p3);
+
+// Intersects a ray with a prepared triangle. Unlike the functions above, p and D must already be in
+// the triangle's object space - transform the ray once per mesh, not once per triangle. D doesn't
+// need to be unit length; the returned t is in units of D.
+double rayTriangleIntersect(const vec3 &p, const vec3 &D, const Triangle &tri);
+float rayTriangleIntersect(const Ray &ray, const Triangle &tri);
+
+// Intersects a ray with the unit cube, with the ray in the cube's object space just like the function
+// above (the world-space version wraps this one).
+double rayCubeIntersect(const vec3 &p, const vec3 &D);
+float rayCubeIntersect(const Ray &ray);
+
+// Slab test of a ray against the axis-aligned box from bounds[0] to bounds[1] (its min and max corners) -
+// the one the unit cube above and the raytracer's BVH boxes both use. Returns true if the ray is in the
+// box somewhere in its [tMin, tMax], and gives where its line gets into and out of the box in tEnter and
+// tExit (which can be outside the interval, e.g. tEnter < tMin for a ray that starts inside).
+// The ray's sign flags pick each slab's near and far plane, so there's no branching and no sorting of the
+// two distances. The box is closed: a ray parallel to a slab (its reciprocal is infinite) that lies
+// exactly in one of the slab's planes gets 0 * infinity = NaN for that plane, and glm::max() and
+// glm::min() pass over a NaN in their first argument - just as the SSE instructions do - so that plane
+// doesn't limit anything. A parallel ray outside the slab gets an infinity of the wrong sign, and misses.
+inline bool rayBoxIntersect(const Ray &ray, const vec3 bounds[2], float &tEnter, float &tExit)
+{
+	const vec3 &p = ray.origin, &invD = ray.invDirection;
+	float nearX = (bounds[ray.sign[0]].x - p.x) * invD.x, farX = (bounds[1 - ray.sign[0]].x - p.x) * invD.x;
+	float nearY = (bounds[ray.sign[1]].y - p.y) * invD.y, farY = (bounds[1 - ray.sign[1]].y - p.y) * invD.y;
+	float nearZ = (bounds[ray.sign[2]].z - p.z) * invD.z, farZ = (bounds[1 - ray.sign[2]].z - p.z) * invD.z;
+
+	const float INF = std::numeric_limits<float>::infinity();
+	tEnter = glm::max(nearX, glm::max(nearY, glm::max(nearZ, -INF)));
+	tExit = glm::min(farX, glm::min(farY, glm::min(farZ, INF)));
+	return glm::max(tEnter, ray.tMin) <= glm::min(tExit, ray.tMax);
+}
+
+// A bound on how far, along each axis, the point p + t * D can be from the surface one of the float kernels above found at t
+// for a ray from p in direction D (in world space, with the ray transformed into the object's space as they do): the rounding
+// in all of that comes to a small multiple of the float epsilon times the size of the numbers involved. tests.cpp checks it
+// against double-precision versions of the kernels, on their test cases and on randomly placed objects. It holds as long as the
+// object's transformation doesn't stretch it ten times as much along one axis as another, and no triangle has an angle much
+// under 6 degrees - beyond that the error grows with how lopsided things are.
+vec3 hitPointError(const vec3 &p, const vec3 &D, float t);
+
+// Where a ray leaving a surface should start, given a hit point on it, the bound on that point's error above, and the surface's
+// normal on the side the ray leaves from: the point moved along the normal until the whole error box is behind it, so whatever
+// the rounding did, the new ray starts off the surface on the right side and can't hit it again on its way out - unlike a fixed
+// epsilon, which is too small far from the origin and needlessly big close to it. The ray can then start at t = 0.
+vec3 offsetRayOrigin(const vec3 &hit, const vec3 &error, const vec3 &normal);
+
 inline vec3 v4Tov3(const vec4 &t) {return vec3(t.x,t.y,t.z);}
 bool epsilonEquals(float n, float m);
 
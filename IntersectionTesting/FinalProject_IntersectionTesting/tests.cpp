@@ -1,17 +1,26 @@
 #include "tests.h"
 #include "stubs.h"
+#include "batch.h"
 #include "glm/glm.hpp"
 
+#include <cfloat>
 #include <iostream>
 #include <iomanip>
 #include <string>
 #include <cmath>
+#include <limits>
+#include <random>
 
 using namespace glm;
 
 void RunRaySphereTests();
+void RunRaySphereBatchTests();
 void RunRayPolyTests();
+void RunRayTriangleBatchTests();
 void RunRayCubeTests();
+void RunRayTests();
+void RunRayBoxTests();
+void RunFloatKernelTests();
 void RunYourTests();
 void RunGradingTests();
 
@@ -32,12 +41,22 @@ void RunTest<double>(std::string name, double const& testValue, double const& ex
 	ReportTest(name, (std::abs(testValue-expectedValue) / std::abs(expectedValue)) < 1e-3);
 }
 
+// The Ray kernels return floats; hold them to the same tolerance
+void RunTest(std::string name, float testValue, double expectedValue) {
+	RunTest<double>(name, testValue, expectedValue);
+}
+
 void RunTests() {
 	std::cout.sync_with_stdio(true);
 
 	RunRaySphereTests();
+	RunRaySphereBatchTests();
 	RunRayPolyTests();
+	RunRayTriangleBatchTests();
 	RunRayCubeTests();
+	RunRayTests();
+	RunRayBoxTests();
+	RunFloatKernelTests();
 	RunYourTests();
 	RunGradingTests();
 
@@ -125,6 +144,55 @@ void RunRaySphereTests() {
 		(5.0 * SQRT_TWO) - 1);
 }
 
+// The batch functions should agree with the single-pair ones for every pair, so run the sphere tests
+// above (plus the scaled matrices, and enough copies to spill over a full SIMD register) both ways.
+void RunRaySphereBatchTests() {
+	const mat4 matrices[] = {BACK5_MATRIX, BACK5ANDTURN_MATRIX, IDENTITY_MATRIX, DOUBLE_MATRIX, TALLANDSKINNY_MATRIX};
+	const int numMatrices = sizeof(matrices) / sizeof(matrices[0]);
+	const vec3 origins[] = {ZERO_VECTOR, HALFX_VECTOR, ZNEGTEN_VECTOR, ZNEGTEN_VECTOR, NEGFIVEOFIVE_VECTOR, ZPOSTEN_VECTOR};
+	const vec3 directions[] = {NEGZ_VECTOR, NEGZ_VECTOR, NEGZ_VECTOR, POSZ_VECTOR, POSXNEGZ_NORM_VECTOR, NEGZ_VECTOR};
+	const int numRays = sizeof(origins) / sizeof(origins[0]);
+
+	SphereBatch spheres;
+	for(int copy = 0; copy < 3; copy++)
+		for(int i = 0; i < numMatrices; i++)
+			spheres.add(glm::inverse(matrices[i]));
+
+	bool oneRayManySpheres = true;
+	std::vector<float> t(spheres.size());
+	for(int r = 0; r < numRays; r++) {
+		raySphereIntersectBatch(origins[r], directions[r], spheres, &t[0]);
+		for(int i = 0; i < spheres.size(); i++) {
+			double expected = Test_RaySphereIntersect(origins[r], directions[r], matrices[i % numMatrices]);
+			if(std::abs(t[i] - expected) / std::abs(expected) >= 1e-3)
+				oneRayManySpheres = false;
+		}
+	}
+	ReportTest("One ray, many spheres", oneRayManySpheres);
+
+	RayBatch rays;
+	for(int copy = 0; copy < 3; copy++)
+		for(int r = 0; r < numRays; r++)
+			rays.add(origins[r], directions[r]);
+
+	bool manyRaysOneSphere = true;
+	t.resize(rays.size());
+	for(int i = 0; i < numMatrices; i++) {
+		raySphereIntersectBatch(rays, glm::inverse(matrices[i]), &t[0]);
+		for(int r = 0; r < rays.size(); r++) {
+			double expected = Test_RaySphereIntersect(origins[r % numRays], directions[r % numRays], matrices[i]);
+			if(std::abs(t[r] - expected) / std::abs(expected) >= 1e-3)
+				manyRaysOneSphere = false;
+		}
+	}
+	ReportTest("Many rays, one sphere", manyRaysOneSphere);
+
+	RunTest(
+		"Inside out",
+		Test_RaySphereIntersect(ZERO_VECTOR, NEGZ_VECTOR, DOUBLE_MATRIX),
+		2.0);
+}
+
 void RunRayPolyTests() {
 	RunTest(
 		"Hi, Tri",
@@ -155,6 +223,62 @@ void RunRayPolyTests() {
 		"And turns",
 		Test_RayPolyIntersect(HALFX_VECTOR, NEGZ_VECTOR, POINT_N2N10, POINT_2N10, POINT_010, BACK5ANDTURN_MATRIX),
 		5.5); // expected value set by Kory
+
+	RunTest(
+		"Squished tri",
+		Test_RayPolyIntersect(ZPOSTEN_VECTOR, NEGZ_VECTOR, POINT_N1N10, POINT_1N10, POINT_010, TALLANDSKINNY_MATRIX),
+		10.0);
+}
+
+void RunRayTriangleBatchTests() {
+	const mat4 matrices[] = {IDENTITY_MATRIX, BACK5_MATRIX, BACK5ANDTURN_MATRIX, DOUBLE_MATRIX, TALLANDSKINNY_MATRIX};
+	const int numMatrices = sizeof(matrices) / sizeof(matrices[0]);
+	const vec3 origins[] = {POSZ_VECTOR, POSXPOSZ_VECTOR, ZERO_VECTOR, HALFX_VECTOR, ZPOSTEN_VECTOR, XPOSTEN_VECTOR};
+	const vec3 directions[] = {NEGZ_VECTOR, NEGZ_VECTOR, NEGZ_VECTOR, NEGZ_VECTOR, NEGZ_VECTOR, NEGX_VECTOR};
+	const int numRays = sizeof(origins) / sizeof(origins[0]);
+
+	// Both windings of each triangle, placed by each matrix - enough that the SIMD lanes and the leftovers both get some
+	std::vector<Triangle> triangles;
+	TriangleBatch batch;
+	for(int i = 0; i < numMatrices; i++) {
+		vec3 p1 = v4Tov3(matrices[i] * vec4(POINT_N2N10, 1));
+		vec3 p2 = v4Tov3(matrices[i] * vec4(POINT_1N10, 1));
+		vec3 p3 = v4Tov3(matrices[i] * vec4(POINT_010, 1));
+		triangles.push_back(buildTriangle(p1, p2, p3));
+		triangles.push_back(buildTriangle(p3, p2, p1));
+	}
+	for(size_t i = 0; i < triangles.size(); i++)
+		batch.add(triangles[i], (unsigned)(100 + i));
+
+	bool stored = true;
+	for(int i = 0; i < batch.size(); i++) {
+		Triangle tri = batch.getTriangle(i);
+		if(tri.p1 != triangles[i].p1 || tri.e1 != triangles[i].e1 || tri.e2 != triangles[i].e2 || tri.normal != triangles[i].normal)
+			stored = false;
+		if(batch.getFaceId(i) != 100 + (unsigned)i)
+			stored = false;
+	}
+	ReportTest("Triangles in, triangles out", stored);
+
+	// The batch does the same float math as the prepared-triangle function, so the results should match exactly
+	bool sameAsOneAtATime = true;
+	int numHits = 0;
+	std::vector<float> t(batch.size());
+	for(int r = 0; r < numRays; r++) {
+		rayTriangleIntersectBatch(origins[r], directions[r], batch, &t[0]);
+		for(int i = 0; i < batch.size(); i++) {
+			float expected = (float)rayTriangleIntersect(origins[r], directions[r], triangles[i]);
+			if(t[i] != expected || (float)rayTriangleIntersect(origins[r], directions[r], batch, i) != expected)
+				sameAsOneAtATime = false;
+			if(expected >= 0)
+				numHits++;
+		}
+	}
+	ReportTest("One ray, many triangles", sameAsOneAtATime && numHits > 0);
+
+	TriangleBatch copy = batch;
+	copy.add(triangles[0], 7);
+	ReportTest("Copied triangles", copy.size() == batch.size() + 1 && copy.getFaceId(0) == batch.getFaceId(0));
 }
 
 void RunRayCubeTests() {
@@ -193,6 +317,381 @@ void RunRayCubeTests() {
 		6.3639607); 
 }
 
+void RunRayTests() {
+	Ray ray(ZERO_VECTOR, vec3(2.0f, -0.0f, -4.0f));
+	ReportTest("Rays know their reciprocals",
+		ray.invDirection == vec3(0.5f, -std::numeric_limits<float>::infinity(), -0.25f) &&
+		ray.sign[0] == 0 && ray.sign[1] == 1 && ray.sign[2] == 1);
+
+	Ray moved = Ray(HALFX_VECTOR, POSXNEGZ_NORM_VECTOR, 1.0f, 2.0f, 42).transformed(BACK5ANDTURN_MATRIX);
+	ReportTest("Moving rays",
+		moved.origin == v4Tov3(BACK5ANDTURN_MATRIX * vec4(HALFX_VECTOR, 1)) &&
+		moved.direction == mat3(BACK5ANDTURN_MATRIX) * POSXNEGZ_NORM_VECTOR &&
+		moved.tMin == 1.0f && moved.tMax == 2.0f && moved.id == 42);
+
+	// Every kernel only reports hits inside the ray's interval - the nearest one there, which may be a far side
+	mat4 back5Inv = glm::inverse(BACK5_MATRIX);
+	RunTest("Sphere, too far", raySphereIntersect(Ray(ZERO_VECTOR, NEGZ_VECTOR, 0, 3.5f), back5Inv), -1.0);
+	RunTest("Sphere, from the middle", raySphereIntersect(Ray(ZERO_VECTOR, NEGZ_VECTOR, 4.5f), back5Inv), 6.0);
+	RunTest("Triangle, too far", rayTriangleIntersect(Ray(POSZ_VECTOR, NEGZ_VECTOR, 0, 0.5f), POINT_N1N10, POINT_1N10, POINT_010, IDENTITY_MATRIX), -1.0);
+	RunTest("Triangle, passed by", rayTriangleIntersect(Ray(POSZ_VECTOR, NEGZ_VECTOR, 1.5f), POINT_N1N10, POINT_1N10, POINT_010, IDENTITY_MATRIX), -1.0);
+	RunTest("Cube, too far", rayCubeIntersect(Ray(ZERO_VECTOR, NEGZ_VECTOR, 0, 4.0f), back5Inv), -1.0);
+	RunTest("Cube, from the middle", rayCubeIntersect(Ray(ZERO_VECTOR, NEGZ_VECTOR, 5.0f), back5Inv), 5.5);
+
+	// The same for the batches, with enough objects that the SIMD lanes and the leftovers both get some
+	SphereBatch spheres;
+	TriangleBatch triangles;
+	for(int i = 0; i < 7; i++) {
+		spheres.add(back5Inv);
+		triangles.add(buildTriangle(POINT_N1N10, POINT_1N10, POINT_010), (unsigned)i);
+	}
+	bool sphereBatchLimited = true, triangleBatchLimited = true;
+	float t[7];
+	raySphereIntersectBatch(Ray(ZERO_VECTOR, NEGZ_VECTOR, 4.5f, 10.0f), spheres, t);
+	for(int i = 0; i < 7; i++)
+		sphereBatchLimited = sphereBatchLimited && std::abs(t[i] - 6.0f) < 1e-5f;
+	raySphereIntersectBatch(Ray(ZERO_VECTOR, NEGZ_VECTOR, 0, 3.5f), spheres, t);
+	for(int i = 0; i < 7; i++)
+		sphereBatchLimited = sphereBatchLimited && t[i] == -1;
+	rayTriangleIntersectBatch(Ray(POSZ_VECTOR, NEGZ_VECTOR, 0, 0.5f), triangles, t);
+	for(int i = 0; i < 7; i++)
+		triangleBatchLimited = triangleBatchLimited && t[i] == -1;
+	rayTriangleIntersectBatch(Ray(POSZ_VECTOR, NEGZ_VECTOR, 0.5f, 1.5f), triangles, t);
+	for(int i = 0; i < 7; i++)
+		triangleBatchLimited = triangleBatchLimited && t[i] == 1;
+	ReportTest("Sphere batch, limited", sphereBatchLimited);
+	ReportTest("Triangle batch, limited", triangleBatchLimited);
+}
+
+void RunRayBoxTests() {
+	const vec3 unitCube[2] = {vec3(-0.5f), vec3(0.5f)};
+	const vec3 NEGZ_NEGZERO_VECTOR(-0.0f, 0.0f, -1.0f);
+	float tEnter, tExit;
+
+	// A ray parallel to a slab that lies in one of its planes gets 0 * infinity = NaN there, and the box is closed, so that's a hit -
+	// with either sign of zero for the parallel component
+	RunTest("Sliding down a face", rayCubeIntersect(Ray(HALFX_VECTOR + ZPOSTEN_VECTOR, NEGZ_VECTOR)), 9.5);
+	RunTest("Sliding down the other face", rayCubeIntersect(Ray(-HALFX_VECTOR + ZPOSTEN_VECTOR, NEGZ_NEGZERO_VECTOR)), 9.5);
+	RunTest("Sliding down an edge", rayCubeIntersect(Ray(vec3(0.5f, -0.5f, 10.0f), NEGZ_NEGZERO_VECTOR)), 9.5);
+	RunTest("Just off a face", rayCubeIntersect(Ray(vec3(0.5001f, 0.0f, 10.0f), NEGZ_VECTOR)), -1.0);
+	RunTest("Just off the other face", rayCubeIntersect(Ray(vec3(-0.5001f, 0.0f, 10.0f), NEGZ_NEGZERO_VECTOR)), -1.0);
+	RunTest("Negative zeros", rayCubeIntersect(Ray(ZPOSTEN_VECTOR, vec3(-0.0f, -0.0f, -1.0f))), 9.5);
+
+	const vec3 flat[2] = {vec3(0.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 1.0f)};
+	ReportTest("Through a flat box", rayBoxIntersect(Ray(vec3(-1.0f, 0.0f, 0.5f), vec3(1.0f, 0.0f, 0.0f)), flat, tEnter, tExit) &&
+		tEnter == 1 && tExit == 2);
+	ReportTest("Over a flat box", !rayBoxIntersect(Ray(vec3(-1.0f, 0.001f, 0.5f), vec3(1.0f, 0.0f, 0.0f)), flat, tEnter, tExit));
+	ReportTest("Box out of reach", !rayBoxIntersect(Ray(ZPOSTEN_VECTOR, NEGZ_VECTOR, 0, 9.0f), unitCube, tEnter, tExit));
+	ReportTest("Box behind", !rayBoxIntersect(Ray(ZNEGTEN_VECTOR, NEGZ_VECTOR), unitCube, tEnter, tExit));
+
+	// The batch gives exactly what the scalar test does, for boxes of every shape (flat ones included) and rays along their
+	// planes, with enough boxes that the SIMD lanes and the leftovers both get some
+	BoxBatch boxes;
+	std::vector<vec3> corners;
+	for(int i = 0; i < 11; i++) {
+		vec3 boxMin = vec3(-0.5f) + 0.25f * vec3((float)(i % 3), (float)(i % 2), (float)(i % 5) - 2.0f);
+		vec3 boxMax = boxMin + vec3(1.0f);
+		if(i % 4 < 3)
+			boxMax[i % 4] = boxMin[i % 4]; // flat along one axis
+		boxes.add(boxMin, boxMax);
+		corners.push_back(boxMin);
+		corners.push_back(boxMax);
+	}
+	const vec3 origins[] = {ZPOSTEN_VECTOR, HALFX_VECTOR + ZPOSTEN_VECTOR, vec3(-0.5f, -0.5f, 10.0f), NEGFIVEOFIVE_VECTOR, ZERO_VECTOR,
+		vec3(-0.25f, 0.0f, 10.0f), vec3(0.0f, 0.25f, -10.0f)};
+	const vec3 directions[] = {NEGZ_VECTOR, NEGZ_NEGZERO_VECTOR, vec3(-0.0f, -0.0f, -1.0f), POSXNEGZ_NORM_VECTOR, POSZ_VECTOR,
+		NEGZ_VECTOR, POSZ_VECTOR};
+	const int numRays = sizeof(origins) / sizeof(origins[0]);
+	bool batchMatches = true;
+	std::vector<float> t(boxes.size());
+	for(int r = 0; r < numRays; r++) {
+		for(int limits = 0; limits < 2; limits++) {
+			Ray ray = limits ? Ray(origins[r], directions[r], 9.6f, 10.0f) : Ray(origins[r], directions[r]);
+			rayBoxIntersectBatch(ray, boxes, &t[0]);
+			for(int i = 0; i < boxes.size(); i++) {
+				float expected = rayBoxIntersect(ray, &corners[2*i], tEnter, tExit) ? glm::max(tEnter, ray.tMin) : -1;
+				batchMatches = batchMatches && t[i] == expected;
+			}
+		}
+	}
+	ReportTest("Box batch", batchMatches);
+}
+
+// The float kernels against double-precision references, run on the same float inputs. The references take tInv's float values
+// as exact, so they define the object the float kernels are trying to hit.
+
+enum Shape {SPHERE, TRIANGLE, CUBE, NUM_SHAPES};
+
+// A shape to intersect: tInv brings world space into its object space, and corners are a triangle's, in object space
+struct DiffCase {
+	Shape shape;
+	mat4 tInv;
+	vec3 corners[3];
+};
+
+static float floatIntersect(const DiffCase &c, const Ray &ray) {
+	switch(c.shape) {
+	case SPHERE: return raySphereIntersect(ray, c.tInv);
+	case TRIANGLE: return rayTriangleIntersect(ray, c.corners[0], c.corners[1], c.corners[2], c.tInv);
+	default: return rayCubeIntersect(ray, c.tInv);
+	}
+}
+
+static dvec3 toObject(const DiffCase &c, const dvec3 &p) {
+	return dvec3(dmat4(c.tInv) * dvec4(p, 1));
+}
+
+// Which side of the surface a world-space point is on: positive outside (or in front of the triangle), negative inside
+static double referenceSide(const DiffCase &c, const dvec3 &world) {
+	dvec3 q = toObject(c, world);
+	switch(c.shape) {
+	case SPHERE: return glm::dot(q, q) - 1;
+	case TRIANGLE: {
+		dvec3 c1(c.corners[0]), c2(c.corners[1]), c3(c.corners[2]);
+		return glm::dot(q - c1, glm::cross(c2 - c1, c3 - c1));
+	}
+	default: return glm::max(std::abs(q.x), glm::max(std::abs(q.y), std::abs(q.z))) - 0.5;
+	}
+}
+
+static double referenceIntersect(const DiffCase &c, const dvec3 &origin, const dvec3 &direction, double tMin, double tMax) {
+	dvec3 p = toObject(c, origin), D = dmat3(dmat4(c.tInv)) * direction;
+	double t1, t2; // the line's way in and out of the shape (the same t for a triangle)
+	if(c.shape == SPHERE) {
+		double a = glm::dot(D, D), b = glm::dot(D, p), cc = glm::dot(p, p) - 1;
+		double discriminant = b*b - a*cc;
+		if(discriminant < 0)
+			return -1;
+		t1 = (-b - sqrt(discriminant)) / a;
+		t2 = (-b + sqrt(discriminant)) / a;
+	}
+	else if(c.shape == TRIANGLE) {
+		dvec3 c1(c.corners[0]), e1 = dvec3(c.corners[1]) - c1, e2 = dvec3(c.corners[2]) - c1;
+		dvec3 pvec = glm::cross(D, e2), tvec = p - c1, qvec = glm::cross(tvec, e1);
+		double det = glm::dot(e1, pvec);
+		if(det == 0)
+			return -1;
+		double u = glm::dot(tvec, pvec) / det, v = glm::dot(D, qvec) / det;
+		if(u < 0 || v < 0 || u + v > 1)
+			return -1;
+		t1 = t2 = glm::dot(e2, qvec) / det;
+	}
+	else {
+		t1 = -std::numeric_limits<double>::infinity();
+		t2 = std::numeric_limits<double>::infinity();
+		for(int axis = 0; axis < 3; axis++) {
+			if(D[axis] == 0) {
+				if(std::abs(p[axis]) > 0.5)
+					return -1;
+				continue;
+			}
+			double near = (-0.5 - p[axis]) / D[axis], far = (0.5 - p[axis]) / D[axis];
+			t1 = glm::max(t1, glm::min(near, far));
+			t2 = glm::min(t2, glm::max(near, far));
+		}
+		if(t1 > t2)
+			return -1;
+	}
+	if(t1 >= tMin)
+		return (t1 <= tMax) ? t1 : -1;
+	return (t2 >= tMin && t2 <= tMax) ? t2 : -1;
+}
+
+static double referenceIntersect(const DiffCase &c, const Ray &ray) {
+	return referenceIntersect(c, dvec3(ray.origin), dvec3(ray.direction), ray.tMin, ray.tMax);
+}
+
+// Whether a case is too close to call: moving the ray's origin a little, by a couple of hundred floats' worth of rounding or
+// less (down to well under one, so the ray can't jump right over a small object), changes whether the reference hits - e.g. the
+// ray grazes the sphere or passes next to an edge - or the ray runs so nearly parallel to a triangle that where it meets the
+// plane comes down to the last few bits of its direction. Float and double are allowed to disagree about those.
+static bool nearBoundary(const DiffCase &c, const Ray &ray, double t) {
+	if(c.shape == TRIANGLE) {
+		dvec3 D = dmat3(dmat4(c.tInv)) * dvec3(ray.direction);
+		dvec3 normal = glm::cross(dvec3(c.corners[1] - c.corners[0]), dvec3(c.corners[2] - c.corners[0]));
+		if(std::abs(glm::dot(D, normal)) < 1e-4 * glm::length(D) * glm::length(normal))
+			return true;
+	}
+	double size = glm::length(dvec3(ray.origin)) + ((t > 0) ? t * glm::length(dvec3(ray.direction)) : 0);
+	for(double nudge = 2e-5 * size; nudge > 1e-8 * size; nudge /= 10)
+		for(int axis = 0; axis < 3; axis++)
+			for(int sign = -1; sign <= 1; sign += 2) {
+				dvec3 moved(ray.origin);
+				moved[axis] += sign * nudge;
+				if((referenceIntersect(c, moved, dvec3(ray.direction), ray.tMin, ray.tMax) < 0) != (t < 0))
+					return true;
+			}
+	return false;
+}
+
+// The world-space normal a renderer would shade a float hit with, facing back along the ray
+static vec3 floatNormal(const DiffCase &c, const vec3 &hit, const vec3 &D) {
+	vec3 q = v4Tov3(c.tInv * vec4(hit, 1)), n;
+	if(c.shape == SPHERE)
+		n = q;
+	else if(c.shape == TRIANGLE)
+		n = glm::cross(c.corners[1] - c.corners[0], c.corners[2] - c.corners[0]);
+	else {
+		int axis = (std::abs(q.x) > std::abs(q.y)) ? 0 : 1;
+		axis = (std::abs(q.z) > std::abs(q[axis])) ? 2 : axis;
+		n = vec3(0.0f);
+		n[axis] = (q[axis] > 0) ? 1.0f : -1.0f;
+	}
+	n = glm::normalize(glm::transpose(mat3(c.tInv)) * n);
+	return (glm::dot(n, D) > 0) ? -n : n;
+}
+
+struct DiffResults {
+	int numCases, numHits, numNearBoundary, numOffset;
+	bool agree, withinBounds, leaveCleanly;
+	double worstError;
+	DiffResults() : numCases(0), numHits(0), numNearBoundary(0), numOffset(0), agree(true), withinBounds(true), leaveCleanly(true),
+		worstError(0) {}
+};
+
+static void diffCase(const DiffCase &c, const Ray &ray, DiffResults &results) {
+	float t = floatIntersect(c, ray);
+	double expected = referenceIntersect(c, ray);
+	results.numCases++;
+	if(nearBoundary(c, ray, expected)) {
+		results.numNearBoundary++;
+		return;
+	}
+	if((t < 0) != (expected < 0)) {
+		results.agree = false;
+		return;
+	}
+	if(t < 0)
+		return;
+	results.numHits++;
+
+	// Where float and double put the hit, relative to the size of the coordinates involved
+	dvec3 scale = glm::abs(dvec3(ray.origin)) + glm::abs(expected * dvec3(ray.direction));
+	double relativeError = std::abs(t - expected) * glm::length(dvec3(ray.direction)) / glm::length(scale);
+	results.worstError = glm::max(results.worstError, relativeError);
+
+	// Secondary rays start off the surface on the side they're meant to: the one the ray came from along the normal, and the
+	// other side against it (as a ray refracted through the surface would)
+	vec3 hit = ray.origin + t * ray.direction, normal = floatNormal(c, hit, ray.direction);
+	vec3 error = hitPointError(ray.origin, ray.direction, t);
+	double thickness = 0; // (roughly - the object's world-space size along its thinnest axis)
+	for(int row = 0; row < 3; row++)
+		thickness = glm::max(thickness, glm::length(dvec3(c.tInv[0][row], c.tInv[1][row], c.tInv[2][row])));
+	thickness = 1 / thickness;
+	if(glm::length(error) * 100 > thickness) // objects that are only a few error bounds across are lost in the rounding
+		return;
+	double originSide = referenceSide(c, dvec3(ray.origin));
+	if(originSide == 0)
+		return;
+	results.numOffset++;
+	vec3 out = offsetRayOrigin(hit, error, normal), in = offsetRayOrigin(hit, error, -normal);
+	if(referenceSide(c, dvec3(out)) * originSide <= 0)
+		results.withinBounds = false;
+	if(c.shape != CUBE && referenceSide(c, dvec3(in)) * originSide >= 0) // (going in along one face's normal at an edge of the
+		results.withinBounds = false;                                     // cube stays on the other face)
+
+	// And rays heading away from it - straight out, or reflected - don't hit it again, from outside the shape where that's all
+	// they could hit
+	if(c.shape == TRIANGLE || originSide > 0) {
+		if(floatIntersect(c, Ray(out, normal)) >= 0 || floatIntersect(c, Ray(out, glm::reflect(ray.direction, normal))) >= 0)
+			results.leaveCleanly = false;
+	}
+}
+
+static float randomFloat(std::mt19937 &random, float low, float high) {
+	return std::uniform_real_distribution<float>(low, high)(random);
+}
+
+static vec3 randomVector(std::mt19937 &random, float low, float high) {
+	return vec3(randomFloat(random, low, high), randomFloat(random, low, high), randomFloat(random, low, high));
+}
+
+// A rotation about any axis; a scale of anywhere from a twentieth to twenty, but no more than ten times as much along one axis
+// as another; and a translation of anywhere from a tenth of a unit to a thousand units
+static mat4 randomTransform(std::mt19937 &random) {
+	vec3 axis = glm::normalize(randomVector(random, -1, 1));
+	float angle = randomFloat(random, 0, 6.2831853f);
+	mat3 k(0, axis.z, -axis.y, -axis.z, 0, axis.x, axis.y, -axis.x, 0); // k * v = axis x v
+	mat3 rotation = mat3(1.0f) + sin(angle) * k + (1 - cos(angle)) * k * k;
+	float size = exp(randomFloat(random, -3, 3));
+	vec3 scale = size * vec3(exp(randomFloat(random, -1.15f, 1.15f)), exp(randomFloat(random, -1.15f, 1.15f)),
+		exp(randomFloat(random, -1.15f, 1.15f)));
+	mat3 m = rotation * mat3(scale.x, 0, 0, 0, scale.y, 0, 0, 0, scale.z);
+	vec3 translation = glm::normalize(randomVector(random, -1, 1)) * pow(10.0f, randomFloat(random, -1, 3));
+	return mat4(vec4(m[0], 0), vec4(m[1], 0), vec4(m[2], 0), vec4(translation, 1));
+}
+
+// No angle under about 6 degrees (a sine under 0.1)
+static bool wellShaped(const vec3 corners[3]) {
+	for(int i = 0; i < 3; i++) {
+		vec3 a = corners[(i + 1) % 3] - corners[i], b = corners[(i + 2) % 3] - corners[i];
+		if(glm::length(glm::cross(a, b)) < 0.1f * glm::length(a) * glm::length(b))
+			return false;
+	}
+	return true;
+}
+
+void RunFloatKernelTests() {
+	const char *names[NUM_SHAPES] = {"sphere", "triangle", "cube"};
+	DiffResults results[NUM_SHAPES];
+
+	// The cases from the tests above: every ray against every shape under every matrix, both windings of each triangle
+	const mat4 matrices[] = {IDENTITY_MATRIX, DOUBLE_MATRIX, TALLANDSKINNY_MATRIX, BACK5_MATRIX, BACK5ANDTURN_MATRIX};
+	const vec3 origins[] = {ZERO_VECTOR, HALFX_VECTOR, THIRDX_VECTOR, NEGX_VECTOR, POSZ_VECTOR, POSXPOSZ_VECTOR, ZNEGTEN_VECTOR,
+		ZPOSTEN_VECTOR, XPOSTEN_VECTOR, NEGFIVEOFIVE_VECTOR};
+	const vec3 directions[] = {NEGZ_VECTOR, POSZ_VECTOR, NEGX_VECTOR, POSXNEGZ_NORM_VECTOR};
+	const vec3 triangles[][3] = {{POINT_N1N10, POINT_1N10, POINT_010}, {POINT_010, POINT_1N10, POINT_N1N10},
+		{POINT_N2N10, POINT_2N10, POINT_010}, {POINT_010, POINT_2N10, POINT_N2N10}};
+	for(int m = 0; m < 5; m++) {
+		for(int shape = 0; shape < NUM_SHAPES; shape++) {
+			for(int tri = 0; tri < (shape == TRIANGLE ? 4 : 1); tri++) {
+				DiffCase c = {(Shape)shape, glm::inverse(matrices[m]), {triangles[tri][0], triangles[tri][1], triangles[tri][2]}};
+				for(int o = 0; o < 10; o++)
+					for(int d = 0; d < 4; d++)
+						diffCase(c, Ray(origins[o], directions[d]), results[shape]);
+			}
+		}
+	}
+
+	// And randomly placed ones, with rays from all around aimed at or near them - and from inside the closed ones - some of
+	// them only over part of the way there
+	std::mt19937 random(25);
+	for(int i = 0; i < 30000; i++) {
+		Shape shape = (Shape)(i % NUM_SHAPES);
+		mat4 t = randomTransform(random);
+		DiffCase c = {shape, glm::inverse(t), {vec3(0.0f), vec3(0.0f), vec3(0.0f)}};
+		if(shape == TRIANGLE) {
+			do {
+				for(int j = 0; j < 3; j++)
+					c.corners[j] = randomVector(random, -1, 1);
+			} while(!wellShaped(c.corners));
+		}
+		for(int r = 0; r < 10; r++) {
+			vec3 from = (shape != TRIANGLE && r % 5 == 0) ? randomVector(random, -0.4f, 0.4f) :
+				glm::normalize(randomVector(random, -1, 1)) * randomFloat(random, 2, 50);
+			vec3 to = randomVector(random, -0.7f, 0.7f);
+			if(shape == TRIANGLE) {
+				float u = randomFloat(random, -0.1f, 1.1f), v = randomFloat(random, -0.1f, 1.1f - u);
+				to = c.corners[0] + u * (c.corners[1] - c.corners[0]) + v * (c.corners[2] - c.corners[0]);
+			}
+			vec3 origin = v4Tov3(t * vec4(from, 1)), target = v4Tov3(t * vec4(to, 1));
+			float tMax = (r % 4 == 3) ? glm::length(target - origin) * randomFloat(random, 0.5f, 1.5f) :
+				std::numeric_limits<float>::infinity();
+			diffCase(c, Ray(origin, glm::normalize(target - origin), 0, tMax), results[shape]);
+		}
+	}
+
+	// Hits agree to the same 1e-3 as the tests above (relative to the size of the coordinates: t itself is wobblier along a ray
+	// that only just grazes something, though the hit stays on the surface), on plenty of them, with few too close to call
+	for(int shape = 0; shape < NUM_SHAPES; shape++) {
+		const DiffResults &r = results[shape];
+		ReportTest(std::string("Float ") + names[shape] + "s match double",
+			r.agree && r.worstError < 1e-3 && r.numHits > r.numCases / 4 && r.numNearBoundary < r.numCases / 5);
+		ReportTest(std::string("Float ") + names[shape] + " hits within bounds",
+			r.withinBounds && r.leaveCleanly && r.numOffset > r.numHits / 3);
+	}
+}
+
 void RunYourTests() {
 	// It can be very useful to put tests of your own here. The unit tests above do NOT test everything!
 }
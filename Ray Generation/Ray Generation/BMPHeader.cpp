@@ -0,0 +1,47 @@
+#include "BMPHeader.h"
+
+// BMP headers are little-endian on disk, whatever the machine is
+static ebmpBYTE* putWORD(ebmpBYTE *out, ebmpWORD value) {
+	out[0] = value & 0xFF;
+	out[1] = (value >> 8) & 0xFF;
+	return out + 2;
+}
+
+static ebmpBYTE* putDWORD(ebmpBYTE *out, ebmpDWORD value) {
+	out = putWORD(out, value & 0xFFFF);
+	return putWORD(out, (value >> 16) & 0xFFFF);
+}
+
+void MakeBMP24Header(int width, int height, ebmpBYTE header[BMP_HEADER_SIZE]) {
+	ebmpDWORD pixelBytes = (ebmpDWORD)BMP24RowSize(width) * height;
+
+	BMFH bmfh;
+	bmfh.bfSize = BMP_HEADER_SIZE + pixelBytes;
+	bmfh.bfOffBits = BMP_HEADER_SIZE;
+
+	BMIH bmih;
+	bmih.biSize = 40;
+	bmih.biWidth = width;
+	bmih.biHeight = height;
+	bmih.biBitCount = 24;
+	bmih.biSizeImage = pixelBytes;
+
+	ebmpBYTE *out = header;
+	out = putWORD(out, bmfh.bfType);
+	out = putDWORD(out, bmfh.bfSize);
+	out = putWORD(out, bmfh.bfReserved1);
+	out = putWORD(out, bmfh.bfReserved2);
+	out = putDWORD(out, bmfh.bfOffBits);
+
+	out = putDWORD(out, bmih.biSize);
+	out = putDWORD(out, bmih.biWidth);
+	out = putDWORD(out, bmih.biHeight);
+	out = putWORD(out, bmih.biPlanes);
+	out = putWORD(out, bmih.biBitCount);
+	out = putDWORD(out, bmih.biCompression);
+	out = putDWORD(out, bmih.biSizeImage);
+	out = putDWORD(out, bmih.biXPelsPerMeter);
+	out = putDWORD(out, bmih.biYPelsPerMeter);
+	out = putDWORD(out, bmih.biClrUsed);
+	out = putDWORD(out, bmih.biClrImportant);
+}
@@ -0,0 +1,18 @@
+#ifndef __BMPHEADER_H
+#define __BMPHEADER_H
+
+#include "EasyBMP.h"
+
+// Size of the file header (BMFH) plus the info header (BMIH) as they're laid out on disk
+const int BMP_HEADER_SIZE = 14 + 40;
+
+// Bytes per row of a 24-bit BMP: three per pixel, padded out to a multiple of four
+inline int BMP24RowSize(int width) {
+	return (3 * width + 3) & ~3;
+}
+
+// Fills in header with everything that comes before the pixels in a 24-bit width x height BMP, the same as
+// BMP::WriteToFile writes it. The pixels follow straight after, as height rows of BMP24RowSize(width) bytes, bottom row first.
+void MakeBMP24Header(int width, int height, ebmpBYTE header[BMP_HEADER_SIZE]);
+
+#endif
@@ -0,0 +1,151 @@
+#include "BMPStreamWriter.h"
+#include "BMPHeader.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+BMPStreamWriter::BMPStreamWriter(const char *fileName, int width, int height, int bandHeight)
+	: width(width), height(height), bandHeight(bandHeight), rowSize(BMP24RowSize(width)), failed(false) {
+	bands.resize((height + bandHeight - 1) / bandHeight);
+
+#ifdef _WIN32
+	file = CreateFileA(fileName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+	file = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (!isOpen()) {
+		failed = true;
+		return;
+	}
+
+	ebmpBYTE header[BMP_HEADER_SIZE];
+	MakeBMP24Header(width, height, header);
+	if (!writeAt(0, header, BMP_HEADER_SIZE)) {
+		failed = true;
+	}
+}
+
+BMPStreamWriter::~BMPStreamWriter() {
+	close();
+}
+
+bool BMPStreamWriter::isOpen() const {
+#ifdef _WIN32
+	return file != INVALID_HANDLE_VALUE;
+#else
+	return file >= 0;
+#endif
+}
+
+bool BMPStreamWriter::writeAt(long long offset, const ebmpBYTE *buffer, size_t size) {
+	while (size > 0) {
+#ifdef _WIN32
+		OVERLAPPED overlapped = {0};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD written;
+		if (!WriteFile(file, buffer, (DWORD)min(size, (size_t)1 << 30), &written, &overlapped) || written == 0) {
+			return false;
+		}
+#else
+		ssize_t written = pwrite(file, buffer, size, offset);
+		if (written <= 0) {
+			return false;
+		}
+#endif
+		buffer += written;
+		offset += written;
+		size -= written;
+	}
+	return true;
+}
+
+void BMPStreamWriter::writeRows(int y, int numRows, const RGBpixel *rows) {
+	if (!isOpen()) {
+		return;
+	}
+
+	// Rows go in the file bottom first, so the bottom row of these is the one that goes first. Padding stays zero.
+	vector<ebmpBYTE> buffer((size_t)rowSize * numRows, 0);
+	for (int i = 0; i < numRows; i++) {
+		memcpy(&buffer[(size_t)(numRows - 1 - i) * rowSize], rows + (size_t)i * width, width * sizeof(RGBpixel));
+	}
+
+	long long offset = BMP_HEADER_SIZE + (long long)(height - y - numRows) * rowSize;
+	if (!writeAt(offset, &buffer[0], buffer.size())) {
+		lock_guard<mutex> guard(lock);
+		failed = true;
+	}
+}
+
+void BMPStreamWriter::writeTile(const Tile &tile, const RGBpixel *pixels) {
+	// A tile that crosses into another band goes in a band's worth of rows at a time
+	for (int y0 = tile.y0; y0 < tile.y1; ) {
+		int bandIndex = y0 / bandHeight;
+		int bandY = bandIndex * bandHeight;
+		int bandRows = min(bandHeight, height - bandY);
+		int y1 = min(tile.y1, bandY + bandRows);
+
+		Band *band;
+		{
+			lock_guard<mutex> guard(lock);
+			if (!bands[bandIndex]) {
+				bands[bandIndex].reset(new Band);
+				bands[bandIndex]->pixels.resize((size_t)width * bandRows);
+				bands[bandIndex]->pixelsDone = 0;
+			}
+			band = bands[bandIndex].get();
+		}
+
+		// Different tiles cover different pixels, so they can be copied in without holding the lock
+		for (int y = y0; y < y1; y++) {
+			memcpy(&band->pixels[(size_t)(y - bandY) * width + tile.x0], pixels, tile.width() * sizeof(RGBpixel));
+			pixels += tile.width();
+		}
+
+		unique_ptr<Band> finished;
+		{
+			lock_guard<mutex> guard(lock);
+			band->pixelsDone += tile.width() * (y1 - y0);
+			if (band->pixelsDone == width * bandRows) {
+				finished = move(bands[bandIndex]);
+			}
+		}
+
+		if (finished) {
+			writeRows(bandY, bandRows, &finished->pixels[0]);
+		}
+		y0 = y1;
+	}
+}
+
+bool BMPStreamWriter::close() {
+	if (!isOpen()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < bands.size(); i++) {
+		if (bands[i]) {
+			failed = true; // never finished
+			bands[i].reset();
+		}
+	}
+
+#ifdef _WIN32
+	if (!CloseHandle(file)) failed = true;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (::close(file) != 0) failed = true;
+	file = -1;
+#endif
+	return !failed;
+}
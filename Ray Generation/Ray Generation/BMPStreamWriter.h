@@ -0,0 +1,63 @@
+#ifndef __BMPSTREAMWRITER_H
+#define __BMPSTREAMWRITER_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "Framebuffer.h"
+#include "TileRenderer.h"
+
+// Writes a 24-bit BMP a piece at a time, for images too big to keep in memory all at once.
+// The headers go out when the file is opened; after that, rows can be written in any order, from any number of threads at
+// once - each write goes straight to where those rows belong in the file (with pwrite, or WriteFile at an offset on Windows),
+// so there's no shared file position to fight over.
+// Tiles can be written too: they're collected into bands of bandHeight rows (a tile that straddles two bands is split between
+// them, but making bandHeight the tile size means none do), and each band is written and freed as soon as all of its pixels
+// are in. So the memory used is just the bands that are partly done, rather than the whole image.
+class BMPStreamWriter {
+public:
+	BMPStreamWriter(const char *fileName, int width, int height, int bandHeight = TileRenderer::DEFAULT_TILE_SIZE);
+	~BMPStreamWriter();
+
+	// False if the file couldn't be created
+	bool isOpen() const;
+
+	// Writes rows y ... y + numRows - 1 (counting from the top). rows holds numRows rows of width pixels each, top to bottom.
+	void writeRows(int y, int numRows, const RGBpixel *rows);
+
+	// Adds a finished tile (pixels is row-major, tile.width() pixels per row), writing out any band that completes. The tile has
+	// to be inside the image.
+	void writeTile(const Tile &tile, const RGBpixel *pixels);
+
+	// Closes the file. Returns false if anything failed to write, or if any band was left partly filled in.
+	bool close();
+
+private:
+	int width, height;
+	int bandHeight;
+	int rowSize; // in the file, in bytes (including padding)
+	bool failed;
+
+#ifdef _WIN32
+	void *file; // HANDLE
+#else
+	int file;
+#endif
+
+	// A band's pixels (top to bottom, width per row), while it's being filled in
+	struct Band {
+		std::vector<RGBpixel> pixels;
+		int pixelsDone;
+	};
+	std::vector<std::unique_ptr<Band>> bands; // null if not started yet (or already written)
+	std::mutex lock; // guards bands and failed
+
+	bool writeAt(long long offset, const ebmpBYTE *buffer, size_t size);
+
+	// Not copyable
+	BMPStreamWriter(const BMPStreamWriter&);
+	BMPStreamWriter& operator=(const BMPStreamWriter&);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "Framebuffer.h"
+#include "BMPHeader.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+static_assert(sizeof(RGBpixel) == 3, "RGBpixel needs to be packed to match the BMP layout");
+
+// Cache line alignment for the start of the buffer. (Only the start - rows keep the BMP layout's 4-byte padding, so neighboring
+// rows, and tiles next to each other, can share a cache line where they meet.)
+static const int FRAMEBUFFER_ALIGNMENT = 64;
+
+static void* alignedAlloc(size_t size) {
+#ifdef _MSC_VER
+	void *p = _aligned_malloc(size, FRAMEBUFFER_ALIGNMENT);
+#else
+	void *p = 0;
+	if (posix_memalign(&p, FRAMEBUFFER_ALIGNMENT, size) != 0) p = 0;
+#endif
+	if (!p) throw bad_alloc();
+	return p;
+}
+
+static void alignedFree(void *p) {
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+Framebuffer::Framebuffer(int width, int height) : width(width), height(height), rowSize(BMP24RowSize(width)) {
+	size_t size = (size_t)rowSize * height;
+	data = (ebmpBYTE*)alignedAlloc(size > 0 ? size : 1);
+	// Zero everything, padding included, so that's what ends up in the file
+	memset(data, 0, size);
+}
+
+Framebuffer::~Framebuffer() {
+	alignedFree(data);
+}
+
+bool Framebuffer::WriteToFile(const char *fileName) const {
+	FILE *fp = fopen(fileName, "wb");
+	if (!fp) {
+		return false;
+	}
+
+	ebmpBYTE header[BMP_HEADER_SIZE];
+	MakeBMP24Header(width, height, header);
+
+	size_t size = (size_t)rowSize * height;
+	bool success = fwrite(header, 1, BMP_HEADER_SIZE, fp) == BMP_HEADER_SIZE && fwrite(data, 1, size, fp) == size;
+	return (fclose(fp) == 0) && success;
+}
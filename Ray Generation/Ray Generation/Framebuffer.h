@@ -0,0 +1,45 @@
+#ifndef __FRAMEBUFFER_H
+#define __FRAMEBUFFER_H
+
+#include "EasyBMP.h"
+
+// One pixel of a 24-bit BMP, in the order the bytes go in the file (the same order as RGBApixel, minus the alpha)
+struct RGBpixel {
+	ebmpBYTE Blue;
+	ebmpBYTE Green;
+	ebmpBYTE Red;
+};
+
+// An image to render into, stored exactly the way a 24-bit BMP stores its pixels: one aligned allocation holding every row,
+// each row padded out to a multiple of four bytes, bottom row first. (x, y) still counts from the top left like BMP does.
+// Unlike BMP (which allocates each column separately and bounds checks every access), rows are contiguous, so walking
+// along a row walks through memory, and writing the file is just the header followed by the whole buffer as-is.
+class Framebuffer {
+public:
+	Framebuffer(int width, int height);
+	~Framebuffer();
+
+	int getWidth() const {return width;}
+	int getHeight() const {return height;}
+
+	// No bounds checking - (x, y) has to be in the image
+	RGBpixel& operator()(int x, int y) {return row(y)[x];}
+	const RGBpixel& operator()(int x, int y) const {return row(y)[x];}
+
+	RGBpixel* row(int y) {return (RGBpixel*)(data + (size_t)(height - 1 - y) * rowSize);}
+	const RGBpixel* row(int y) const {return (const RGBpixel*)(data + (size_t)(height - 1 - y) * rowSize);}
+
+	// Writes the image out as a 24-bit BMP (with a single write of the pixels). Returns false if that fails.
+	bool WriteToFile(const char *fileName) const;
+
+private:
+	int width, height;
+	int rowSize; // in bytes, including padding
+	ebmpBYTE *data;
+
+	// Not copyable
+	Framebuffer(const Framebuffer&);
+	Framebuffer& operator=(const Framebuffer&);
+};
+
+#endif
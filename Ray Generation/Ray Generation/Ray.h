@@ -1,13 +1,71 @@
 #ifndef __RAY_H
 #define __RAY_H
 
+#include <limits>
 
+#include "../glm/glm.hpp"
+
+// A ray, origin + t * direction for t in [tMin, tMax], carrying what the intersection tests need to know about it worked out once
+// when it's made instead of in every test: the reciprocal of its direction (for slab tests) and which way it points along each
+// axis. The direction is used as given, so t is only a distance if it's unit length - and a ray brought into an object's space
+// with transformed() keeps the same t for the same point. id is for whoever makes the ray (e.g. the pixel it's for).
+// The members come in four 16-byte rows - origin and tMin, direction and tMax, invDirection and id, then sign - so a row can be
+// loaded straight into a SIMD register, and the whole ray fits in a 64-byte cache line.
 class Ray {
 public:
-	Ray(){}
+	glm::vec3 origin;
+	float tMin;
+	glm::vec3 direction;
+	float tMax;
+	glm::vec3 invDirection; // 1 / direction, componentwise (infinite along an axis the ray is parallel to)
+	int id;
+	int sign[3]; // 1 along the axes where the direction is negative (-0.0 included, since its reciprocal is -infinity), 0 elsewhere
+	int padding;
 
-private:
+	Ray() : origin(0.0f), tMin(0), direction(0.0f, 0.0f, 1.0f), tMax(std::numeric_limits<float>::infinity()), id(0), padding(0) {
+		setDirection(direction);
+	}
+
+	Ray(const glm::vec3 &origin, const glm::vec3 &direction, float tMin = 0, float tMax = std::numeric_limits<float>::infinity(),
+		int id = 0) : origin(origin), tMin(tMin), tMax(tMax), id(id), padding(0) {
+		setDirection(direction);
+	}
+
+	// The same with the reciprocal direction already worked out (e.g. kept with the directions of a ray packet), saving the divides
+	Ray(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 &invDirection, float tMin, float tMax, int id = 0)
+		: origin(origin), tMin(tMin), direction(direction), tMax(tMax), id(id), padding(0) {
+		setInverse(invDirection);
+	}
+
+	// Points the ray in a new direction, updating what's precomputed from it
+	void setDirection(const glm::vec3 &direction) {
+		Ray::direction = direction;
+		setInverse(1.0f / direction);
+	}
 
+	glm::vec3 at(double t) const {return origin + (float)t * direction;}
+
+	// The same ray in the space an affine transformation takes it into (e.g. a cached inverse world transformation, to bring a ray
+	// into an object's space), with the same interval and id. The mat4x3 version is for affine matrices with their bottom row
+	// (always 0 0 0 1) left off.
+	Ray transformed(const glm::mat4 &m) const {
+		return Ray(glm::vec3(m * glm::vec4(origin, 1)), glm::mat3(m) * direction, tMin, tMax, id);
+	}
+	Ray transformed(const glm::mat4x3 &m) const {
+		return Ray(m * glm::vec4(origin, 1), m * glm::vec4(direction, 0), tMin, tMax, id);
+	}
+
+private:
+	// The signs come from the value passed in rather than from the invDirection just stored: reading that back lets the compiler
+	// load two components at once, which has to wait for both separate stores to finish - a stall on every ray made.
+	void setInverse(const glm::vec3 &inverse) {
+		invDirection = inverse;
+		sign[0] = (inverse.x < 0) ? 1 : 0;
+		sign[1] = (inverse.y < 0) ? 1 : 0;
+		sign[2] = (inverse.z < 0) ? 1 : 0;
+	}
 };
 
-#endif
\ No newline at end of file
+static_assert(sizeof(Ray) == 64, "Ray should be four 16-byte rows");
+
+#endif
@@ -0,0 +1,99 @@
+#include "TileRenderer.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+TileRenderer::TileRenderer(int width, int height, int tileSize, int numThreads) : numThreads(numThreads), tileSize(tileSize) {
+	for (int y = 0; y < height; y += tileSize) {
+		for (int x = 0; x < width; x += tileSize) {
+			Tile tile = {x, y, min(x + tileSize, width), min(y + tileSize, height)};
+			tiles.push_back(tile);
+		}
+	}
+
+	if (this->numThreads <= 0) {
+		this->numThreads = max(1u, thread::hardware_concurrency());
+	}
+	// No point in having threads with nothing to do
+	this->numThreads = max(1, min(this->numThreads, (int)tiles.size()));
+}
+
+// One thread's tiles. The owner takes tiles from the front (so it works through its run of the image in order), and
+// thieves take them from the back (as far from where the owner is working as possible).
+struct TileQueue {
+	mutex lock;
+	deque<int> tiles;
+
+	bool popFront(int &tile) {
+		lock_guard<mutex> guard(lock);
+		if (tiles.empty()) return false;
+		tile = tiles.front();
+		tiles.pop_front();
+		return true;
+	}
+
+	bool popBack(int &tile) {
+		lock_guard<mutex> guard(lock);
+		if (tiles.empty()) return false;
+		tile = tiles.back();
+		tiles.pop_back();
+		return true;
+	}
+};
+
+void TileRenderer::run(const function<void(const Tile&, vector<RGBpixel>&)> &renderTile) {
+	if (numThreads == 1) {
+		vector<RGBpixel> scratch(tileSize * tileSize);
+		for (size_t i = 0; i < tiles.size(); i++) {
+			renderTile(tiles[i], scratch);
+		}
+		return;
+	}
+
+	// Deal the tiles out in contiguous runs. All the work exists up front and nothing adds more, so once a thread has
+	// emptied its own queue and finds every other queue empty too, it's done.
+	unique_ptr<TileQueue[]> queues(new TileQueue[numThreads]);
+	for (int i = 0; i < numThreads; i++) {
+		int first = (int)((long long)tiles.size() * i / numThreads);
+		int last = (int)((long long)tiles.size() * (i + 1) / numThreads);
+		for (int tile = first; tile < last; tile++) {
+			queues[i].tiles.push_back(tile);
+		}
+	}
+
+	auto work = [&](int self) {
+		vector<RGBpixel> scratch(tileSize * tileSize);
+		int tile;
+		for (;;) {
+			if (queues[self].popFront(tile)) {
+				renderTile(tiles[tile], scratch);
+				continue;
+			}
+
+			// Out of our own tiles - go looking for someone else's, starting with our neighbor
+			bool stole = false;
+			for (int i = 1; i < numThreads && !stole; i++) {
+				stole = queues[(self + i) % numThreads].popBack(tile);
+			}
+			if (!stole) {
+				return;
+			}
+			renderTile(tiles[tile], scratch);
+		}
+	};
+
+	// The calling thread does its share too
+	vector<thread> threads;
+	for (int i = 1; i < numThreads; i++) {
+		threads.push_back(thread(work, i));
+	}
+	work(0);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef __TILERENDERER_H
+#define __TILERENDERER_H
+
+#include <vector>
+#include <functional>
+
+#include "Framebuffer.h"
+
+// A rectangle of pixels, [x0, x1) x [y0, y1)
+struct Tile {
+	int x0, y0;
+	int x1, y1;
+
+	int width() const {return x1 - x0;}
+	int height() const {return y1 - y0;}
+};
+
+// Splits an image into fixed-size tiles and renders them on a pool of threads (one per hardware thread by default).
+// Each thread starts out with its own contiguous run of tiles, and once it's done with those it steals tiles from the other
+// threads' runs, so one slow region of the image doesn't leave the rest of the threads idle.
+// Every pixel is computed independently by the same function no matter which thread gets it, so the result is exactly the
+// same as rendering serially (which is what you get with one thread - everything runs on the calling thread, in tile order).
+class TileRenderer {
+public:
+	static const int DEFAULT_TILE_SIZE = 32;
+
+	// numThreads = 0 means one per hardware thread
+	TileRenderer(int width, int height, int tileSize = DEFAULT_TILE_SIZE, int numThreads = 0);
+
+	int getNumTiles() const {return tiles.size();}
+	int getNumThreads() const {return numThreads;}
+
+	// Renders the whole image. shade(x, y) is called once for every pixel and returns its color; each tile is shaded into a
+	// scratch buffer belonging to the thread working on it, which is then handed to store(tile, pixels) (pixels is
+	// row-major, tile.width() pixels per row). Both get called from the worker threads, and need to be safe to call
+	// concurrently for different pixels/tiles.
+	template<typename ShadeFunc, typename StoreFunc>
+	void render(ShadeFunc shade, StoreFunc store);
+
+	// The same, but shadeTile(tile, pixels) is called once per tile to fill in all of its pixels at once (row-major, as for store),
+	// for shading that works on groups of pixels together.
+	template<typename ShadeTileFunc, typename StoreFunc>
+	void renderTiles(ShadeTileFunc shadeTile, StoreFunc store);
+
+private:
+	int numThreads;
+	int tileSize;
+	std::vector<Tile> tiles; // in row-major order across the image
+
+	// Runs renderTile(tile, scratch) for every tile, spread across the threads. scratch is the calling thread's own buffer,
+	// with room for a full tile.
+	void run(const std::function<void(const Tile&, std::vector<RGBpixel>&)> &renderTile);
+};
+
+template<typename ShadeFunc, typename StoreFunc>
+void TileRenderer::render(ShadeFunc shade, StoreFunc store) {
+	renderTiles([&](const Tile &tile, RGBpixel *pixels) {
+		for (int y = tile.y0; y < tile.y1; y++) {
+			for (int x = tile.x0; x < tile.x1; x++) {
+				*pixels++ = shade(x, y);
+			}
+		}
+	}, store);
+}
+
+template<typename ShadeTileFunc, typename StoreFunc>
+void TileRenderer::renderTiles(ShadeTileFunc shadeTile, StoreFunc store) {
+	run([&](const Tile &tile, std::vector<RGBpixel> &scratch) {
+		shadeTile(tile, &scratch[0]);
+		store(tile, (const RGBpixel*)&scratch[0]);
+	});
+}
+
+#endif
@@ -6,7 +6,14 @@
  * University of Pennsylvania, Fall 2011
  **/
 
-#include "EasyBMP.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Framebuffer.h"
+#include "TileRenderer.h"
+#include "BMPStreamWriter.h"
 #include "../glm/gtc/matrix_transform.hpp"
 
 using namespace std;
@@ -28,10 +35,6 @@ int main(int argc, char** argv) {
 	H4 *= 1.333f;
 	vec3 H = vec3(H4.x, H4.y, H4.z);
 
-	BMP output;
-	output.SetSize(width, height);
-	output.SetBitDepth(24);
-
 	/*Pseudocode for what we need to do for this milestone
 
 	//Ray equation: R = E + t(P-E)
@@ -58,22 +61,59 @@ int main(int argc, char** argv) {
 	
 	*/
 
+	// The H and V offsets only depend on the column and row respectively, so work them out once for each rather than per pixel
+	vector<vec3> columnH(width), rowV(height);
 	for (int x = 0; x < width; x++) {
-		for (int y = 0; y < height; y++) {
-			vec3 rayPositionH = H;
-			vec3 rayPositionV = V;
-			rayPositionH *= (2 * (double)x) / (width - 1) - 1;
-			rayPositionV *= (2 * (double)y) / (height - 1) - 1;
-			vec3 P = M + rayPositionH + rayPositionV;
-			
-			//D = (P-E)/|P-E|
-			vec3 D = normalize(P - eye);
-			output(x,y)->Red = glm::abs(D.x*255);
-			output(x,y)->Green = glm::abs(D.y*255);
-			output(x,y)->Blue = glm::abs(D.z*255);
+		vec3 rayPositionH = H;
+		rayPositionH *= (2 * (double)x) / (width - 1) - 1;
+		columnH[x] = rayPositionH;
+	}
+	for (int y = 0; y < height; y++) {
+		vec3 rayPositionV = V;
+		rayPositionV *= (2 * (double)y) / (height - 1) - 1;
+		rowV[y] = rayPositionV;
+	}
+
+	// Optional arguments: the number of threads to render with (1 renders serially; the default is one per hardware thread),
+	// and "stream" to write the image out a band at a time as it's finished, rather than keeping all of it in memory
+	int numThreads = (argc > 1) ? atoi(argv[1]) : 0;
+	bool stream = (argc > 2) && strcmp(argv[2], "stream") == 0;
+	TileRenderer renderer(width, height, TileRenderer::DEFAULT_TILE_SIZE, numThreads);
+
+	auto shade = [&](int x, int y) -> RGBpixel {
+		vec3 P = M + columnH[x] + rowV[y];
+
+		//D = (P-E)/|P-E|
+		vec3 D = normalize(P - eye);
+		RGBpixel pixel;
+		pixel.Red = glm::abs(D.x*255);
+		pixel.Green = glm::abs(D.y*255);
+		pixel.Blue = glm::abs(D.z*255);
+		return pixel;
+	};
+
+	if (stream) {
+		BMPStreamWriter writer("output.bmp", width, height, TileRenderer::DEFAULT_TILE_SIZE);
+		renderer.render(shade, [&](const Tile &tile, const RGBpixel *pixels) {
+			writer.writeTile(tile, pixels);
+		});
+		if (!writer.close()) {
+			cerr << "Couldn't write output.bmp" << endl;
+			return 1;
+		}
+	} else {
+		Framebuffer output(width, height);
+		renderer.render(shade, [&](const Tile &tile, const RGBpixel *pixels) {
+			for (int y = tile.y0; y < tile.y1; y++) {
+				memcpy(&output(tile.x0, y), pixels, tile.width() * sizeof(RGBpixel));
+				pixels += tile.width();
+			}
+		});
+		if (!output.WriteToFile("output.bmp")) {
+			cerr << "Couldn't write output.bmp" << endl;
+			return 1;
 		}
 	}
 
-	output.WriteToFile("output.bmp");
 	return 0;
 }
\ No newline at end of file
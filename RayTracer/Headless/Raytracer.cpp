@@ -0,0 +1,198 @@
+#include "Raytracer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "../../Ray Generation/Ray Generation/TileRenderer.h"
+
+// Shading constants from lambert.frag
+static const float AMBIENT = 0.1f;
+static const float BLINN_EXPONENT = 35.0f;
+
+static RGBpixel toPixel(const vec3 &color)
+{
+	vec3 scaled = color * 255.0f;
+	RGBpixel pixel;
+	pixel.Red = (ebmpBYTE)(scaled.r + 0.5f);
+	pixel.Green = (ebmpBYTE)(scaled.g + 0.5f);
+	pixel.Blue = (ebmpBYTE)(scaled.b + 0.5f);
+	return pixel;
+}
+
+Raytracer::Raytracer(SceneGraph &scene) : scene(&scene), compiledScene(0)
+{
+	initialize();
+}
+
+Raytracer::Raytracer(CompiledScene &scene) : scene(0), compiledScene(&scene)
+{
+	initialize();
+}
+
+void Raytracer::initialize()
+{
+	// MyGLWidget's starting view: 20 units out along z looking at the origin, a 90 degree field of view, and the light hovering
+	// over the center of the floor
+	setCamera(vec3(0, 0, 20.001f), vec3(0, 0, 0), vec3(0, 1, 0), 90.0f);
+	setLight(vec3(0, 10, 0));
+	setPacketSize(16);
+}
+
+void Raytracer::setCamera(const vec3 &eye, const vec3 &center, const vec3 &up, float fovy)
+{
+	Raytracer::eye = eye;
+	Raytracer::center = center;
+	Raytracer::up = up;
+	Raytracer::fovy = fovy;
+}
+
+void Raytracer::setLight(const vec3 &lightPos)
+{
+	Raytracer::lightPos = lightPos;
+}
+
+vec3 Raytracer::trace(const Ray &ray)
+{
+	double t;
+	vec3 normal, faceNormal, color;
+	if(!intersect(ray, t, normal, faceNormal, color))
+		return vec3(0.0f); // the GL view's clear color
+	return shade(ray.origin, ray.direction, ray.id, t, normal, faceNormal, color);
+}
+
+vec3 Raytracer::shade(const vec3 &p0, const vec3 &D, int id, double t, vec3 normal, vec3 faceNormal, const vec3 &color)
+{
+	vec3 hit = p0 + (float)t * D;
+
+	// Shade whichever side of the surface we're looking at
+	if(glm::dot(normal, D) > 0)
+		normal = -normal;
+	if(glm::dot(faceNormal, D) > 0)
+		faceNormal = -faceNormal;
+
+	vec3 shaded = color * AMBIENT;
+
+	vec3 toLight = lightPos - hit;
+	float lightDistance = glm::length(toLight);
+	toLight /= lightDistance;
+
+	// The shadow ray starts just far enough off the surface to clear any rounding error in hit, so it can't hit the surface it
+	// starts on - however far from the origin that is. That only holds going off the surface itself, along the face normal: a
+	// smoothed normal can point back into it.
+	float diffuseTerm = glm::dot(toLight, normal);
+	vec3 shadowOrigin = offsetRayOrigin(hit, hitPointError(p0, D, (float)t), faceNormal);
+	if(diffuseTerm > 0 && !occluded(Ray(shadowOrigin, toLight, 0, lightDistance, id)))
+	{
+		vec3 blinn = glm::normalize(toLight - D); // halfway between the directions to the light and to the eye
+		float specularTerm = glm::pow(std::max(glm::dot(blinn, normal), 0.0f), BLINN_EXPONENT);
+
+		shaded += diffuseTerm * color + vec3(specularTerm); // specular color = white
+	}
+
+	return glm::clamp(shaded, 0.0f, 1.0f);
+}
+
+void Raytracer::render(Framebuffer &output, int numThreads)
+{
+	int width = output.getWidth(), height = output.getHeight();
+
+	// Camera basis, and the vectors from the center of the screen to its right (H) and top (V) edges, a unit distance in front of the eye
+	vec3 forward = glm::normalize(center - eye);
+	vec3 right = glm::normalize(glm::cross(forward, up));
+	vec3 V = glm::cross(right, forward) * glm::tan(glm::radians(fovy / 2));
+	vec3 H = right * glm::length(V) * ((float)width / height);
+	vec3 M = eye + forward;
+
+	// Through the center of pixel (x, y); (0,0) is the top left
+	auto direction = [&](int x, int y) -> vec3 {
+		float sx = 2 * (x + 0.5f) / width - 1;
+		float sy = 1 - 2 * (y + 0.5f) / height;
+		return glm::normalize(M + sx * H + sy * V - eye);
+	};
+	auto store = [&](const Tile &tile, const RGBpixel *pixels) {
+		for(int y = tile.y0; y < tile.y1; y++)
+		{
+			memcpy(&output(tile.x0, y), pixels, tile.width() * sizeof(RGBpixel));
+			pixels += tile.width();
+		}
+	};
+
+	TileRenderer renderer(width, height, TileRenderer::DEFAULT_TILE_SIZE, numThreads);
+	if(packetSize <= 1)
+	{
+		renderer.render([&](int x, int y) -> RGBpixel {
+			return toPixel(trace(Ray(eye, direction(x, y), 0, std::numeric_limits<float>::infinity(), y * width + x)));
+		}, store);
+		return;
+	}
+
+	renderer.renderTiles([&](const Tile &tile, RGBpixel *pixels) {
+		RayPacket packet;
+		vec3 normals[RayPacket::MAX_SIZE], faceNormals[RayPacket::MAX_SIZE], colors[RayPacket::MAX_SIZE];
+		for(int y0 = tile.y0; y0 < tile.y1; y0 += packetSize)
+		{
+			for(int x0 = tile.x0; x0 < tile.x1; x0 += packetSize)
+			{
+				int x1 = std::min(x0 + packetSize, tile.x1), y1 = std::min(y0 + packetSize, tile.y1);
+				packet.reset(eye);
+				for(int y = y0; y < y1; y++)
+					for(int x = x0; x < x1; x++)
+						packet.add(direction(x, y));
+
+				intersect(packet, normals, faceNormals, colors);
+				for(int y = y0, i = 0; y < y1; y++)
+				{
+					for(int x = x0; x < x1; x++, i++)
+					{
+						vec3 color(0.0f); // the GL view's clear color, as in trace()
+						if(packet.hit[i] >= 0)
+							color = shade(eye, packet.getDirection(i), y * width + x, packet.t[i], normals[i], faceNormals[i], colors[i]);
+						pixels[(y - tile.y0) * tile.width() + (x - tile.x0)] = toPixel(color);
+					}
+				}
+			}
+		}
+	}, store);
+}
+
+bool Raytracer::intersect(const Ray &ray, double &t, vec3 &normal, vec3 &faceNormal, vec3 &color)
+{
+	if(compiledScene)
+	{
+		int instance = compiledScene->intersect(ray, t, normal, faceNormal);
+		if(instance < 0)
+			return false;
+		color = compiledScene->getColor(instance);
+		return true;
+	}
+
+	SceneGraph::Node *node = scene->intersect(ray, t, normal, faceNormal);
+	if(!node)
+		return false;
+	color = node->getGeometry()->getColor();
+	return true;
+}
+
+void Raytracer::intersect(RayPacket &packet, vec3 *normals, vec3 *faceNormals, vec3 *colors)
+{
+	if(compiledScene)
+	{
+		compiledScene->intersect(packet, normals, faceNormals);
+		for(int i = 0; i < packet.size; i++)
+			if(packet.hit[i] >= 0)
+				colors[i] = compiledScene->getColor(packet.hit[i]);
+		return;
+	}
+
+	SceneGraph::Node *nodes[RayPacket::MAX_SIZE];
+	scene->intersect(packet, nodes, normals, faceNormals);
+	for(int i = 0; i < packet.size; i++)
+		if(nodes[i])
+			colors[i] = nodes[i]->getGeometry()->getColor();
+}
+
+bool Raytracer::occluded(const Ray &ray)
+{
+	return compiledScene ? compiledScene->occluded(ray) : scene->occluded(ray);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../glm/glm.hpp"
+
+#include "../Program1/SceneGraph.h"
+#include "../Program1/CompiledScene.h"
+#include "../../Ray Generation/Ray Generation/Framebuffer.h"
+
+using glm::vec3;
+
+// Renders a scene graph by raytracing it: one primary ray through the center of each pixel, and a shadow ray toward the light
+// from whatever that hits. Surfaces are shaded the same way lambert.frag shades them when the scene is drawn with OpenGL (ambient,
+// plus Lambert diffuse and Blinn-Phong specular from a single point light), and the camera and light default to where MyGLWidget
+// starts them out, so a render looks like the scene does when first loaded in the GUI.
+// The scene is either a scene graph, whose BVH needs to have been built (SceneGraph::buildBVH()) before rendering, or a compiled scene
+// (see CompiledScene), which comes with its BVHs. Either way rendering only reads the scene, so it's spread across threads with
+// TileRenderer.
+// Primary rays are traced in packets - one per square block of pixels in each tile, which all leave the eye in much the same direction
+// (see BVH::closestHits()) - and shadow rays one at a time.
+class Raytracer
+{
+public:
+	Raytracer(SceneGraph &scene);
+	Raytracer(CompiledScene &scene);
+
+	// fovy is the vertical field of view, in degrees
+	void setCamera(const vec3 &eye, const vec3 &center, const vec3 &up, float fovy);
+	void setLight(const vec3 &lightPos);
+	// The primary rays through each size x size block of pixels are traced together, up to 16 x 16; 1 traces every ray on its own
+	void setPacketSize(int size) {packetSize = glm::clamp(size, 1, 16);}
+
+	// Renders the whole image (the size of output) into output, with numThreads threads (0 means one per hardware thread)
+	void render(Framebuffer &output, int numThreads = 0);
+
+	// Color (each component in [0, 1]) seen along the (world-space) ray, which needs a unit length direction
+	vec3 trace(const Ray &ray);
+
+private:
+	SceneGraph *scene; // whichever of these we were given; the other is null
+	CompiledScene *compiledScene;
+
+	vec3 eye, center, up;
+	float fovy;
+	vec3 lightPos;
+	int packetSize;
+
+	// Sets up the default camera and light
+	void initialize();
+
+	// The color of a hit at distance t along the ray from p0 in direction D, on a surface with the given normal (for shading), face
+	// normal (for leaving it) and color. id is the ray's, for the shadow ray to carry. (Just the parts of the ray shading uses, so
+	// the packet path doesn't have to put a whole Ray together in memory for each pixel only for this to read it straight back.)
+	vec3 shade(const vec3 &p0, const vec3 &D, int id, double t, vec3 normal, vec3 faceNormal, const vec3 &color);
+
+	// The closest hit along the ray in whichever scene we have: false on a miss, and otherwise the distance to the hit, the normal
+	// and face normal there (see SceneGraph::intersect()), and the color of what was hit
+	bool intersect(const Ray &ray, double &t, vec3 &normal, vec3 &faceNormal, vec3 &color);
+	// The same for each ray of packet: the distance in packet.t, and for the ones that hit something (packet.hit[i] >= 0) the
+	// normals and color in normals[i], faceNormals[i] and colors[i]
+	void intersect(RayPacket &packet, vec3 *normals, vec3 *faceNormals, vec3 *colors);
+	bool occluded(const Ray &ray);
+};
@@ -0,0 +1,99 @@
+// Command-line raytracer: loads a scene description (the same files the OpenGL program reads), raytraces it, and writes the
+// result to a 24-bit BMP - no window, GL context, or GPU required. Reports how long each stage took. The scene file can also be a
+// compiled scene (see scene_compiler), which is mapped and rendered as it is.
+//
+// Usage: raytracer [scene file] [output file] [width height] [threads] [packet size]
+//	Defaults to testScene.txt, output.bmp, 800 x 600, one thread per hardware thread, and primary rays traced in 16 x 16 packets
+//	(a packet size of 1 traces each ray on its own).
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <exception>
+
+#include "../Program1/SceneGraph.h"
+#include "../Program1/SceneLoader.h"
+#include "../Program1/CompiledScene.h"
+#include "Raytracer.h"
+#include "../../Ray Generation/Ray Generation/Framebuffer.h"
+
+using namespace std;
+
+// Seconds since start
+static double secondsSince(chrono::high_resolution_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+}
+
+// Renders into output, and says how long it took
+static void render(Raytracer &raytracer, Framebuffer &output, int numThreads, int packetSize)
+{
+	raytracer.setPacketSize(packetSize);
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	raytracer.render(output, numThreads);
+	double renderTime = secondsSince(start);
+	cout << "Rendered " << output.getWidth() << " x " << output.getHeight() << " in " << renderTime * 1000 << " ms ("
+		<< (double)output.getWidth() * output.getHeight() / renderTime / 1e6 << " Mpixels/s)" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	const char *sceneFile = (argc > 1) ? argv[1] : "testScene.txt";
+	const char *outputFile = (argc > 2) ? argv[2] : "output.bmp";
+	int width = (argc > 4) ? atoi(argv[3]) : 800;
+	int height = (argc > 4) ? atoi(argv[4]) : 600;
+	int numThreads = (argc > 5) ? atoi(argv[5]) : 0;
+	int packetSize = (argc > 6) ? atoi(argv[6]) : 16;
+
+	if(width <= 0 || height <= 0)
+	{
+		cerr << "Usage: " << argv[0] << " [scene file] [output file] [width height] [threads] [packet size]" << endl;
+		return 1;
+	}
+
+	try
+	{
+		Framebuffer output(width, height);
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+		if(CompiledScene::isCompiledScene(sceneFile))
+		{
+			CompiledScene scene;
+			scene.load(sceneFile);
+			cout << "Mapped " << sceneFile << " (" << scene.getNumInstances() << " items, " << scene.getNumTriangles() << " triangles) in "
+				<< secondsSince(start) * 1000 << " ms" << endl;
+
+			Raytracer raytracer(scene);
+			render(raytracer, output, numThreads, packetSize);
+		}
+		else
+		{
+			SceneGraph scene;
+			SceneLoader loader;
+			loader.initialize(AttribLocations());
+
+			loader.load(scene, sceneFile);
+			cout << "Loaded " << sceneFile << " (" << loader.getObjects().size() << " items) in " << secondsSince(start) * 1000 << " ms" << endl;
+
+			start = chrono::high_resolution_clock::now();
+			scene.buildBVH();
+			cout << "Built BVH in " << secondsSince(start) * 1000 << " ms" << endl;
+
+			Raytracer raytracer(scene);
+			render(raytracer, output, numThreads, packetSize);
+		}
+
+		if(!output.WriteToFile(outputFile))
+		{
+			cerr << "Couldn't write " << outputFile << endl;
+			return 1;
+		}
+		cout << "Wrote " << outputFile << endl;
+	}
+	catch(exception &e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
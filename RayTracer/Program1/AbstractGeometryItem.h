@@ -9,17 +9,57 @@
 
 #pragma once
 
+#include <vector>
 #include "../glm/glm.hpp"
+#include "BVH.h"
+
+class TriangleBatch;
 
 // Abstract base class for all geometry items.
 // Only the "draw" operation is defined at this level, as a function that takes a transformation (world) matrix and should be
 // called from paintGL().
 // GeometryItem is derived from this, and implements an item defined by a set of vertices and a drawing mode.
-// Table, Chair, and Floor are directly derived from this, and are implemented as compositions of Boxes (itself derived
+// Table and Chair are derived from this through BoxAssembly, and are implemented as compositions of Boxes (itself derived
 // from GeometryItem).
 class AbstractGeometryItem
 {
 public:
 	virtual void draw(glm::mat4 transform) = 0;
 	virtual float getUnitHeight() = 0;
+
+	// Raytracing support. Both of these work in the item's object space (the space that draw()'s transform takes it out of).
+	// intersect() returns the smallest t in the ray's [tMin, tMax] at which it hits the item, or -1 if it misses. The ray is
+	// generally a world-space ray brought into object space (Ray::transformed()), so its direction isn't unit length, and t is in
+	// units of it.
+	virtual double intersect(const Ray &ray) = 0;
+	// The same, but also gives the (object-space, not necessarily unit length) normal of the surface where the ray hits.
+	virtual double intersect(const Ray &ray, glm::vec3 &normal) = 0;
+	// The same again, with the normal of the surface actually hit in faceNormal as well - which is the one to move the start of a
+	// secondary ray off the surface along. It's only different from normal where that's smoothed (a mesh's is blended from the
+	// vertex normals of the triangle hit, and can even point into the surface near a silhouette), so by default it's the same.
+	virtual double intersect(const Ray &ray, glm::vec3 &normal, glm::vec3 &faceNormal)
+	{
+		double t = intersect(ray, normal);
+		faceNormal = normal;
+		return t;
+	}
+	// The same for every ray in a packet (see RayPacket), already in object space: records each hit closer than the ray's t with
+	// packet.recordHit() (what it records as hit is up to the item). Items with a BVH of their own trace the packet through it
+	// together; by default the rays are just tested one at a time.
+	virtual void intersect(RayPacket &packet)
+	{
+		for(int i = 0; i < packet.size; i++)
+		{
+			double t = intersect(packet.getRay(i));
+			if(t >= 0)
+				packet.recordHit(i, t, 0);
+		}
+	}
+	// getBounds() gives an axis-aligned box that contains the whole item.
+	virtual void getBounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) = 0;
+	// getColor() gives the color the item is drawn in, for shading.
+	virtual glm::vec3 getColor() = 0;
+	// getTriangles() flattens the whole item into triangles (replacing whatever was in triangles), with the normal to shade with at
+	// each corner of each one in cornerNormals (three per triangle, in order) - e.g. for storing it in a CompiledScene.
+	virtual void getTriangles(TriangleBatch &triangles, std::vector<glm::vec3> &cornerNormals) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "BVH.h"
+
+#include <algorithm>
+
+#include "../../IntersectionTesting/FinalProject_IntersectionTesting/simd.h"
+
+// Number of bins the SAH split search evaluates per node
+static const int NUM_BINS = 16;
+// Nodes with this many primitives or fewer become leaves if the SAH doesn't find a split that's worth it; larger nodes always split
+static const int MAX_LEAF_SIZE = 4;
+// Cost of visiting a node, relative to intersecting a primitive
+static const float TRAVERSAL_COST = 1.0f;
+
+// A box as seen from a packet's origin, which is all the slab tests need of either
+struct PacketBox
+{
+	vec3 corners[2]; // the box's min and max corners minus the origin
+	bool onPlane; // whether the origin is in the plane of any of the box's faces that some ray of the packet is parallel to
+#if SIMD_WIDTH > 1
+	floatN loX, loY, loZ, hiX, hiY, hiZ;
+#endif
+
+	PacketBox(const AABB &box, const RayPacket &packet)
+	{
+		corners[0] = box.pMin - packet.origin;
+		corners[1] = box.pMax - packet.origin;
+		onPlane = false;
+		for(int axis = 0; axis < 3; axis++)
+			if(packet.parallelAxes & (1 << axis))
+				onPlane = onPlane || corners[0][axis] == 0 || corners[1][axis] == 0;
+#if SIMD_WIDTH > 1
+		loX = setN(corners[0].x); loY = setN(corners[0].y); loZ = setN(corners[0].z);
+		hiX = setN(corners[1].x); hiY = setN(corners[1].y); hiZ = setN(corners[1].z);
+#endif
+	}
+};
+
+// Whether ray i of packet hits box: the same operations in the same order as rayBoxIntersect() (which AABB::intersect() is), with
+// the box already moved to the origin and the ray's t rounded up as tMax
+static bool rayHitsBox(const RayPacket &packet, const PacketBox &box, int i)
+{
+	float invDx = packet.invDx[i], invDy = packet.invDy[i], invDz = packet.invDz[i];
+	int signX = invDx < 0, signY = invDy < 0, signZ = invDz < 0;
+	float nearX = box.corners[signX].x * invDx, farX = box.corners[1 - signX].x * invDx;
+	float nearY = box.corners[signY].y * invDy, farY = box.corners[1 - signY].y * invDy;
+	float nearZ = box.corners[signZ].z * invDz, farZ = box.corners[1 - signZ].z * invDz;
+
+	const float INF = std::numeric_limits<float>::infinity();
+	float enter = glm::max(nearX, glm::max(nearY, glm::max(nearZ, -INF)));
+	float exit = glm::min(farX, glm::min(farY, glm::min(farZ, INF)));
+	return glm::max(enter, 0.0f) <= glm::min(exit, packet.tLimit[i]);
+}
+
+#if SIMD_WIDTH > 1
+// rayHitsBox() for rays i ... i + SIMD_WIDTH - 1 at once, as a bit per ray. The rays' signs differ from lane to lane, so rather than
+// pick each one's near and far planes, this takes the smaller and larger distance to the two - which is the same thing unless one
+// of them is 0 * infinity = NaN, and that can only happen when the origin is in the plane of one of the box's faces and some ray is
+// parallel to it. Those (rare) boxes go through rayHitsBox() lane by lane instead, so this always gives exactly the same answers.
+static int raysHitBox(const RayPacket &packet, const PacketBox &box, int i)
+{
+	if(box.onPlane)
+	{
+		int mask = 0;
+		for(int lane = 0; lane < SIMD_WIDTH; lane++)
+			mask |= rayHitsBox(packet, box, i + lane) << lane;
+		return mask;
+	}
+
+	floatN invDx = loadN(packet.invDx + i), invDy = loadN(packet.invDy + i), invDz = loadN(packet.invDz + i);
+	floatN t0x = mulN(box.loX, invDx), t0y = mulN(box.loY, invDy), t0z = mulN(box.loZ, invDz);
+	floatN t1x = mulN(box.hiX, invDx), t1y = mulN(box.hiY, invDy), t1z = mulN(box.hiZ, invDz);
+
+	floatN enter = maxN(maxN(minN(t0x, t1x), minN(t0y, t1y)), maxN(minN(t0z, t1z), setN(0.0f)));
+	floatN exit = minN(minN(minN(maxN(t0x, t1x), maxN(t0y, t1y)), maxN(t0z, t1z)), loadN(packet.tLimit + i));
+	return maskN(greaterEqualN(exit, enter));
+}
+#endif
+
+bool RayPacket::narrow(const AABB &box, int &begin, int &end, float &tEntry) const
+{
+	// First the packet as a whole. Along an axis where the directions all have the same sign, every ray's slab distances lie between
+	// those of the directions bounding the packet (rounding can't break that, as each is one rounded product, monotonic in 1 / D), so
+	// the packet misses the box if those bounds don't overlap. Axes where the directions go both ways (or nowhere) don't bound it.
+	float enter = 0, exit = std::numeric_limits<float>::infinity();
+	for(int axis = 0; axis < 3; axis++)
+	{
+		if(!(dMin[axis] > 0 || dMax[axis] < 0))
+			continue;
+		float invLow = 1.0f / dMax[axis], invHigh = 1.0f / dMin[axis];
+		float nearSide = ((dMin[axis] > 0) ? box.pMin[axis] : box.pMax[axis]) - origin[axis];
+		float farSide = ((dMin[axis] > 0) ? box.pMax[axis] : box.pMin[axis]) - origin[axis];
+		enter = std::max(enter, std::min(nearSide * invLow, nearSide * invHigh));
+		exit = std::min(exit, std::max(farSide * invLow, farSide * invHigh));
+	}
+	if(enter > exit)
+		return false;
+
+	// Then the rays, from each end until one hits (a SIMD group at a time, then one at a time for whatever's left of the range)
+	PacketBox relative(box, *this);
+	int first = begin, last = end;
+#if SIMD_WIDTH > 1
+	for(; first + SIMD_WIDTH <= end; first += SIMD_WIDTH)
+	{
+		int mask = raysHitBox(*this, relative, first);
+		if(mask)
+		{
+			while(!(mask & 1))
+			{
+				mask >>= 1;
+				first++;
+			}
+			break;
+		}
+	}
+#endif
+	while(first < end && !rayHitsBox(*this, relative, first))
+		first++;
+	if(first == end)
+		return false;
+
+#if SIMD_WIDTH > 1
+	for(; last - SIMD_WIDTH > first; last -= SIMD_WIDTH)
+	{
+		int mask = raysHitBox(*this, relative, last - SIMD_WIDTH);
+		if(mask)
+		{
+			while(!(mask & (1 << (SIMD_WIDTH - 1))))
+			{
+				mask <<= 1;
+				last--;
+			}
+			break;
+		}
+	}
+#endif
+	while(!rayHitsBox(*this, relative, last - 1))
+		last--;
+
+	begin = first;
+	end = last;
+	tEntry = enter;
+	return true;
+}
+
+int RayPacket::collectHits(const AABB &box, int begin, int end, int *rays) const
+{
+	PacketBox relative(box, *this);
+	int numRays = 0, i = begin;
+#if SIMD_WIDTH > 1
+	for(; i + SIMD_WIDTH <= end; i += SIMD_WIDTH)
+	{
+		int mask = raysHitBox(*this, relative, i);
+		for(int lane = 0; mask; lane++, mask >>= 1)
+			if(mask & 1)
+				rays[numRays++] = i + lane;
+	}
+#endif
+	for(; i < end; i++)
+		if(rayHitsBox(*this, relative, i))
+			rays[numRays++] = i;
+	return numRays;
+}
+
+void BVH::build(const std::vector<AABB> &primitiveBounds)
+{
+	clear();
+	if(primitiveBounds.empty())
+		return;
+
+	primitives.resize(primitiveBounds.size());
+	std::vector<vec3> centroids(primitiveBounds.size());
+	for(size_t i = 0; i < primitiveBounds.size(); i++)
+	{
+		primitives[i] = (int)i;
+		centroids[i] = primitiveBounds[i].centroid();
+	}
+
+	// A binary tree with n leaves has 2n - 1 nodes, and there are at most as many leaves as primitives
+	nodes.reserve(2 * primitiveBounds.size() - 1);
+
+	Node root;
+	root.first = 0;
+	root.count = primitiveBounds.size();
+	nodes.push_back(root);
+	subdivide(0, 0, primitiveBounds, centroids);
+}
+
+void BVH::subdivide(int nodeIndex, int depth, const std::vector<AABB> &primitiveBounds, const std::vector<vec3> &centroids)
+{
+	// (Careful - nodes gets added to below, so don't hang on to a reference into it.)
+	int first = nodes[nodeIndex].first;
+	int count = nodes[nodeIndex].count;
+
+	AABB bounds, centroidBounds;
+	for(int i = first; i < first + count; i++)
+	{
+		bounds.expand(primitiveBounds[primitives[i]]);
+		centroidBounds.expand(centroids[primitives[i]]);
+	}
+	nodes[nodeIndex].bounds = bounds;
+
+	if(count == 1 || depth >= MAX_DEPTH)
+		return;
+
+	// Bin along the longest axis of the centroids' bounds
+	vec3 extent = centroidBounds.pMax - centroidBounds.pMin;
+	int axis = 0;
+	if(extent.y > extent[axis]) axis = 1;
+	if(extent.z > extent[axis]) axis = 2;
+	if(extent[axis] <= 0)
+		return; // every centroid is in the same place, so there's nothing to split on
+
+	float binScale = NUM_BINS / extent[axis];
+	float axisMin = centroidBounds.pMin[axis];
+
+	int binCounts[NUM_BINS] = {0};
+	AABB binBounds[NUM_BINS];
+	for(int i = first; i < first + count; i++)
+	{
+		// Clamped before converting to an int, so even a centroid that isn't finite (from bounds that aren't) lands in a bin
+		float position = (centroids[primitives[i]][axis] - axisMin) * binScale;
+		int bin = (position > 0) ? (int)std::min(position, (float)(NUM_BINS - 1)) : 0;
+		binCounts[bin]++;
+		binBounds[bin].expand(primitiveBounds[primitives[i]]);
+	}
+
+	// Sweep from the right to get the area and count of everything right of each bin boundary, then sweep from the left
+	// evaluating the SAH cost of splitting at each boundary: area(left) * count(left) + area(right) * count(right).
+	float rightAreas[NUM_BINS - 1];
+	int rightCounts[NUM_BINS - 1];
+	AABB right;
+	int rightCount = 0;
+	for(int i = NUM_BINS - 1; i > 0; i--)
+	{
+		right.expand(binBounds[i]);
+		rightCount += binCounts[i];
+		rightAreas[i - 1] = right.surfaceArea();
+		rightCounts[i - 1] = rightCount;
+	}
+
+	float bestCost = FLT_MAX;
+	int bestSplit = -1; // split between bins bestSplit and bestSplit + 1
+	AABB left;
+	int leftCount = 0;
+	for(int i = 0; i < NUM_BINS - 1; i++)
+	{
+		left.expand(binBounds[i]);
+		leftCount += binCounts[i];
+		if(leftCount == 0 || rightCounts[i] == 0)
+			continue;
+
+		float cost = left.surfaceArea() * leftCount + rightAreas[i] * rightCounts[i];
+		if(cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = i;
+		}
+	}
+
+	// Compare against the cost of leaving this as a leaf (costs here are relative to this node's own area, so the split's
+	// area-weighted cost gets divided by it)
+	float nodeArea = bounds.surfaceArea();
+	float splitCost = TRAVERSAL_COST + (nodeArea > 0 ? bestCost / nodeArea : 0);
+	if(bestSplit < 0 || (count <= MAX_LEAF_SIZE && splitCost >= count))
+		return;
+
+	// Partition this node's primitives around the chosen boundary
+	int *middle = std::partition(&primitives[first], &primitives[first] + count, [&](int primitive) {
+		return std::min(NUM_BINS - 1, (int)((centroids[primitive][axis] - axisMin) * binScale)) <= bestSplit;
+	});
+	int numLeft = middle - &primitives[first];
+
+	Node leftChild, rightChild;
+	leftChild.first = first;
+	leftChild.count = numLeft;
+	rightChild.first = first + numLeft;
+	rightChild.count = count - numLeft;
+
+	int leftIndex = nodes.size();
+	nodes.push_back(leftChild);
+	nodes.push_back(rightChild);
+	nodes[nodeIndex].first = leftIndex;
+	nodes[nodeIndex].count = 0; // now an interior node
+
+	subdivide(leftIndex, depth + 1, primitiveBounds, centroids);
+	subdivide(leftIndex + 1, depth + 1, primitiveBounds, centroids);
+}
+
+bool BVH::View::isValid(int numPrimitives) const
+{
+	if(numNodes == 0)
+		return true;
+
+	// Walk the whole tree the way the queries do, with the depth of each node on the stack too. Requiring children to come after
+	// their parents rules out cycles, and since each node can then only be reached once in a tree, visiting more nodes than there
+	// are means some are shared.
+	struct Entry {int node, depth;} stack[STACK_SIZE];
+	int stackSize = 0, numVisited = 0;
+	Entry root = {0, 0};
+	stack[stackSize++] = root;
+	while(stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+		if(++numVisited > numNodes)
+			return false;
+
+		const Node &node = nodes[entry.node];
+		if(node.count > 0)
+		{
+			if(node.first < 0 || node.first > numPrimitives - node.count)
+				return false;
+			for(int i = node.first; i < node.first + node.count; i++)
+				if(primitives[i] < 0 || primitives[i] >= numPrimitives)
+					return false;
+		}
+		else
+		{
+			if(node.count < 0 || node.first <= entry.node || node.first > numNodes - 2 || entry.depth >= MAX_DEPTH)
+				return false;
+			Entry left = {node.first, entry.depth + 1}, right = {node.first + 1, entry.depth + 1};
+			stack[stackSize++] = left;
+			stack[stackSize++] = right;
+		}
+	}
+	return true;
+}
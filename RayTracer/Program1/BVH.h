@@ -0,0 +1,455 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include "../glm/glm.hpp"
+#include "../../Ray Generation/Ray Generation/Ray.h"
+#include "../../IntersectionTesting/FinalProject_IntersectionTesting/stubs.h"
+
+using glm::vec3;
+
+// The smallest float that's no less than t (or close to it), so the box tests - which work in float - can take a double t as a limit
+// without turning down a box that something closer than t could be in
+inline float roundUpToFloat(double t)
+{
+	if(t >= FLT_MAX)
+		return std::numeric_limits<float>::infinity();
+	float f = (float)t;
+	return (f >= t) ? f : f + glm::max(std::abs(f) * FLT_EPSILON, FLT_MIN);
+}
+
+// Axis-aligned bounding box. A default-constructed AABB is empty (and expanding it by anything gives that thing's bounds).
+struct AABB
+{
+	vec3 pMin, pMax;
+
+	AABB() : pMin(FLT_MAX), pMax(-FLT_MAX) {}
+	AABB(const vec3 &pMin, const vec3 &pMax) : pMin(pMin), pMax(pMax) {}
+
+	void expand(const vec3 &p) {pMin = glm::min(pMin, p); pMax = glm::max(pMax, p);}
+	void expand(const AABB &b) {pMin = glm::min(pMin, b.pMin); pMax = glm::max(pMax, b.pMax);}
+
+	vec3 centroid() const {return (pMin + pMax) * 0.5f;}
+
+	float surfaceArea() const
+	{
+		if(pMin.x > pMax.x) return 0; // empty
+		vec3 d = pMax - pMin;
+		return 2 * (d.x*d.y + d.y*d.z + d.z*d.x);
+	}
+
+	// Returns true if the ray passes through the box somewhere in its [tMin, tMax], and if so, puts the distance at which it gets into
+	// the box (no nearer than tMin) in tEntry. This is the unit cube's slab test, rayBoxIntersect(), with pMin and pMax as the bounds.
+	bool intersect(const Ray &ray, float &tEntry) const
+	{
+		float tExit;
+		bool hit = rayBoxIntersect(ray, &pMin, tEntry, tExit);
+		tEntry = glm::max(tEntry, ray.tMin);
+		return hit;
+	}
+};
+
+static_assert(offsetof(AABB, pMax) == sizeof(vec3), "AABB::intersect() needs pMin and pMax next to each other, as an array");
+
+// A bundle of up to MAX_SIZE rays leaving from the same point - e.g. the primary rays through a block of neighboring pixels - to be
+// traced through a BVH together (see BVH::View::closestHits()). The directions are stored structure-of-arrays so that the box tests
+// can take several rays per SIMD instruction, and each ray carries the distance to the closest thing it's hit so far and what that
+// was. As with the single-ray queries, directions don't need to be unit length, and t is in units of the ray's own direction.
+struct RayPacket
+{
+	static const int MAX_SIZE = 256; // 16 x 16 pixels
+
+	vec3 origin;
+	int size;
+	float dx[MAX_SIZE], dy[MAX_SIZE], dz[MAX_SIZE];
+	float invDx[MAX_SIZE], invDy[MAX_SIZE], invDz[MAX_SIZE]; // 1 / direction, componentwise, for the slab tests
+	double t[MAX_SIZE]; // how far along the ray the closest hit so far is (or the farthest a hit may be, until there is one)
+	float tLimit[MAX_SIZE]; // t rounded up to a float, for the box tests (which work in float)
+	int hit[MAX_SIZE]; // what's at t, as given to recordHit(), or -1
+	vec3 dMin, dMax; // componentwise bounds of all the directions, for testing boxes against the packet as a whole
+	int parallelAxes; // bit axis is set if any ray is parallel to that axis's slabs (its reciprocal direction is infinite there)
+
+	RayPacket() : size(0) {}
+
+	// Empties the packet, for rays from origin
+	void reset(const vec3 &origin)
+	{
+		RayPacket::origin = origin;
+		size = 0;
+		dMin = vec3(FLT_MAX);
+		dMax = vec3(-FLT_MAX);
+		parallelAxes = 0;
+	}
+
+	// Adds a ray in direction D, looking for hits closer than tMax, and returns its index. There must be room for it.
+	int add(const vec3 &D, double tMax = DBL_MAX)
+	{
+		int i = size++;
+		dx[i] = D.x; dy[i] = D.y; dz[i] = D.z;
+		invDx[i] = 1.0f / D.x; invDy[i] = 1.0f / D.y; invDz[i] = 1.0f / D.z;
+		const float INF = std::numeric_limits<float>::infinity();
+		parallelAxes |= ((std::abs(invDx[i]) == INF) ? 1 : 0) | ((std::abs(invDy[i]) == INF) ? 2 : 0) | ((std::abs(invDz[i]) == INF) ? 4 : 0);
+		t[i] = tMax;
+		tLimit[i] = roundUpToFloat(tMax);
+		hit[i] = -1;
+		dMin = glm::min(dMin, D);
+		dMax = glm::max(dMax, D);
+		return i;
+	}
+
+	vec3 getDirection(int i) const {return vec3(dx[i], dy[i], dz[i]);}
+	// Ray i on its own, over [0, tMax], reusing the reciprocal direction the packet already has for it
+	Ray getRay(int i, float tMax = std::numeric_limits<float>::infinity()) const
+	{
+		return Ray(origin, getDirection(i), vec3(invDx[i], invDy[i], invDz[i]), 0, tMax);
+	}
+
+	// Records that ray i hits what at distance tHit, if that's closer than anything it's hit so far
+	void recordHit(int i, double tHit, int what)
+	{
+		if(tHit < t[i])
+		{
+			t[i] = tHit;
+			tLimit[i] = roundUpToFloat(tHit);
+			hit[i] = what;
+		}
+	}
+
+	// The box tests traversal is made of (in BVH.cpp). Each counts a ray as hitting box exactly when AABB::intersect() would with the
+	// ray's t as tMax. narrow() shrinks [begin, end) to run from the first of those rays that hits box to the last, returning false
+	// (without changing them) if none do, and gives a distance the packet can't enter box any closer than in tEntry; boxes the
+	// packet as a whole misses are turned down without looking at the rays one by one. collectHits() lists the rays in [begin, end)
+	// that hit box in rays (in order), returning how many there are.
+	bool narrow(const AABB &box, int &begin, int &end, float &tEntry) const;
+	int collectHits(const AABB &box, int begin, int end, int *rays) const;
+};
+
+// Bounding volume hierarchy over a set of primitives, which it only knows by their bounding boxes - what the primitives actually
+// are is up to the caller, which passes a function to intersect a ray with primitive i when querying.
+// Built top-down, choosing each split with the surface area heuristic (SAH) evaluated at the boundaries of a fixed number of bins
+// laid out along the longest axis of the node's primitive centroids.
+class BVH
+{
+public:
+	struct Node
+	{
+		AABB bounds;
+		int first; // interior node: index of the left child (the right child is always first + 1); leaf: index into primitives
+		int count; // number of primitives in a leaf; 0 for an interior node
+	};
+
+	// A read-only hierarchy over nodes and primitive indices stored somewhere else, which is all querying needs - BVH queries through
+	// one of these over its own arrays, and CompiledScene uses them over arrays in a memory-mapped file. Cheap to copy.
+	class View
+	{
+	public:
+		View() : nodes(0), numNodes(0), primitives(0) {}
+		View(const Node *nodes, int numNodes, const int *primitives) : nodes(nodes), numNodes(numNodes), primitives(primitives) {}
+
+		bool empty() const {return numNodes == 0;}
+		AABB getBounds() const {return numNodes == 0 ? AABB() : nodes[0].bounds;}
+
+		// Checks that the nodes form a tree the queries can safely walk: every index in range, children after their parents, and no
+		// deeper than the traversal stack allows. (build() always makes one; this is for hierarchies that came from somewhere else.)
+		bool isValid(int numPrimitives) const;
+
+		template<typename IntersectFunc>
+		int closestHit(const Ray &ray, double &t, IntersectFunc intersect) const;
+		template<typename IntersectFunc>
+		bool anyHit(const Ray &ray, IntersectFunc intersect) const;
+		template<typename IntersectFunc>
+		void closestHits(RayPacket &packet, IntersectFunc intersect) const;
+
+	private:
+		const Node *nodes; // nodes[0] is the root
+		int numNodes;
+		const int *primitives;
+
+		// closestHits() for ray i of packet on its own, through the subtree under node root
+		template<typename IntersectFunc>
+		void closestHit(int root, RayPacket &packet, int i, IntersectFunc &intersect) const;
+	};
+
+	// Builds the hierarchy over primitives 0 ... primitiveBounds.size() - 1, replacing whatever was there before.
+	void build(const std::vector<AABB> &primitiveBounds);
+
+	void clear() {nodes.clear(); primitives.clear();}
+	bool empty() const {return nodes.empty();}
+
+	// The order the build left the primitives in, which keeps each leaf's primitives together. A caller that stores its primitives
+	// in this order and then calls renumberPrimitives() gets each leaf's primitives next to each other in memory; primitive i is then
+	// the i-th one in this order, rather than the i-th one passed to build().
+	const std::vector<int> &getPrimitiveOrder() const {return primitives;}
+	void renumberPrimitives()
+	{
+		for(size_t i = 0; i < primitives.size(); i++)
+			primitives[i] = (int)i;
+	}
+
+	// The nodes themselves, for storing the hierarchy somewhere else (see View)
+	const std::vector<Node> &getNodes() const {return nodes;}
+
+	View getView() const {return nodes.empty() ? View() : View(&nodes[0], (int)nodes.size(), &primitives[0]);}
+
+	// Bounds of everything in the hierarchy
+	AABB getBounds() const {return getView().getBounds();}
+
+	// Finds the closest primitive along the ray, no nearer than its tMin and closer than its tMax. intersect(i) is called to test
+	// primitive i, and must return the t at which the (same) ray hits it from tMin on, or a negative number on a miss. Returns the index
+	// of the primitive hit, with its t in t, or -1 if nothing is hit.
+	template<typename IntersectFunc>
+	int closestHit(const Ray &ray, double &t, IntersectFunc intersect) const
+	{
+		return getView().closestHit(ray, t, intersect);
+	}
+
+	// Returns true as soon as any primitive is found along the ray closer than its tMax (for shadow rays).
+	template<typename IntersectFunc>
+	bool anyHit(const Ray &ray, IntersectFunc intersect) const
+	{
+		return getView().anyHit(ray, intersect);
+	}
+
+	// Finds the closest primitive along each of the rays in packet (which all leave from the same point, so they can go through the
+	// hierarchy together - this is for coherent rays like the primary rays through a block of pixels). intersect(i, rays, numRays)
+	// is called to test primitive i against the numRays rays of the packet listed in rays, and records the ones it hits closer than
+	// their t with packet.recordHit(). Rays that don't hit anything keep the t they started with, and a hit of -1.
+	template<typename IntersectFunc>
+	void closestHits(RayPacket &packet, IntersectFunc intersect) const
+	{
+		getView().closestHits(packet, intersect);
+	}
+
+private:
+	std::vector<Node> nodes; // nodes[0] is the root
+	std::vector<int> primitives; // primitive indices, ordered so each leaf's primitives are contiguous
+
+	// Traversal keeps a fixed-size stack, which holds at most one entry per level of the tree (plus one), so the build stops splitting
+	// at this depth. SAH trees never get anywhere near this deep unless something's degenerate.
+	static const int MAX_DEPTH = 60;
+	static const int STACK_SIZE = MAX_DEPTH + 2;
+	// Packets whose rays that hit a node are down to this few go through the rest of its subtree one ray at a time, since there's
+	// nothing left to share between them
+	static const int MIN_PACKET_RAYS = 2;
+
+	void subdivide(int nodeIndex, int depth, const std::vector<AABB> &primitiveBounds, const std::vector<vec3> &centroids);
+};
+
+template<typename IntersectFunc>
+int BVH::View::closestHit(const Ray &ray, double &t, IntersectFunc intersect) const
+{
+	int closest = -1;
+	double tClosest = ray.tMax;
+	if(numNodes == 0)
+		return -1;
+
+	// The boxes are tested with the ray cut off at the closest hit so far
+	Ray remaining = ray;
+
+	// Stack of nodes still to visit, with the distance at which the ray enters each - by the time we get to one, we may have
+	// already found a hit closer than that, and can skip it.
+	struct Entry {int node; float tEntry;} stack[STACK_SIZE];
+	int stackSize = 0;
+
+	float tEntry;
+	if(nodes[0].bounds.intersect(remaining, tEntry))
+	{
+		stack[0].node = 0;
+		stack[0].tEntry = tEntry;
+		stackSize = 1;
+	}
+
+	while(stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+		if(entry.tEntry > tClosest)
+			continue;
+
+		const Node &node = nodes[entry.node];
+		if(node.count > 0) // leaf
+		{
+			for(int i = node.first; i < node.first + node.count; i++)
+			{
+				double tPrimitive = intersect(primitives[i]);
+				if(tPrimitive >= 0 && tPrimitive < tClosest)
+				{
+					tClosest = tPrimitive;
+					closest = primitives[i];
+					remaining.tMax = roundUpToFloat(tClosest);
+				}
+			}
+		}
+		else
+		{
+			float tLeft, tRight;
+			bool hitLeft = nodes[node.first].bounds.intersect(remaining, tLeft);
+			bool hitRight = nodes[node.first + 1].bounds.intersect(remaining, tRight);
+
+			// Push the farther child first, so the nearer one gets visited first
+			if(hitLeft && hitRight)
+			{
+				Entry left = {node.first, tLeft}, right = {node.first + 1, tRight};
+				stack[stackSize++] = (tLeft < tRight) ? right : left;
+				stack[stackSize++] = (tLeft < tRight) ? left : right;
+			}
+			else if(hitLeft)
+			{
+				Entry left = {node.first, tLeft};
+				stack[stackSize++] = left;
+			}
+			else if(hitRight)
+			{
+				Entry right = {node.first + 1, tRight};
+				stack[stackSize++] = right;
+			}
+		}
+	}
+
+	if(closest >= 0)
+		t = tClosest;
+	return closest;
+}
+
+template<typename IntersectFunc>
+bool BVH::View::anyHit(const Ray &ray, IntersectFunc intersect) const
+{
+	if(numNodes == 0)
+		return false;
+
+	// Order doesn't matter here, so the stack only needs node indices
+	int stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while(stackSize > 0)
+	{
+		const Node &node = nodes[stack[--stackSize]];
+
+		float tEntry;
+		if(!node.bounds.intersect(ray, tEntry))
+			continue;
+
+		if(node.count > 0) // leaf
+		{
+			for(int i = node.first; i < node.first + node.count; i++)
+			{
+				double tPrimitive = intersect(primitives[i]);
+				if(tPrimitive >= 0 && tPrimitive < ray.tMax)
+					return true;
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+
+	return false;
+}
+
+template<typename IntersectFunc>
+void BVH::View::closestHits(RayPacket &packet, IntersectFunc intersect) const
+{
+	if(numNodes == 0 || packet.size == 0)
+		return;
+
+	// The packet goes down the tree as a range of its rays: at each node, the range is narrowed to run from the first ray that hits
+	// the node to the last, and the node is skipped if none do - so each node is fetched once for all of them, and their box tests
+	// run side by side. Once too few rays are left for that to be worth it, they're sent through the rest of the subtree singly.
+	struct Entry {int node, begin, end; float tEntry;} stack[STACK_SIZE];
+	int stackSize = 0;
+
+	Entry root = {0, 0, packet.size, 0};
+	if(packet.narrow(nodes[0].bounds, root.begin, root.end, root.tEntry))
+		stack[stackSize++] = root;
+
+	int rays[RayPacket::MAX_SIZE];
+	while(stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+		const Node &node = nodes[entry.node];
+		if(node.count > 0) // leaf
+		{
+			// Only the rays that still hit the leaf (with what they've hit since it was pushed) get tested against its primitives
+			int numRays = packet.collectHits(node.bounds, entry.begin, entry.end, rays);
+			for(int i = node.first; i < node.first + node.count && numRays > 0; i++)
+				intersect(primitives[i], rays, numRays);
+		}
+		else if(entry.end - entry.begin <= MIN_PACKET_RAYS)
+		{
+			for(int i = entry.begin; i < entry.end; i++)
+				closestHit(entry.node, packet, i, intersect);
+		}
+		else
+		{
+			Entry left = {node.first, entry.begin, entry.end, 0}, right = {node.first + 1, entry.begin, entry.end, 0};
+			bool hitLeft = packet.narrow(nodes[left.node].bounds, left.begin, left.end, left.tEntry);
+			bool hitRight = packet.narrow(nodes[right.node].bounds, right.begin, right.end, right.tEntry);
+
+			// Push the farther child first, so the nearer one gets visited first
+			if(hitLeft && hitRight)
+			{
+				stack[stackSize++] = (left.tEntry < right.tEntry) ? right : left;
+				stack[stackSize++] = (left.tEntry < right.tEntry) ? left : right;
+			}
+			else if(hitLeft)
+				stack[stackSize++] = left;
+			else if(hitRight)
+				stack[stackSize++] = right;
+		}
+	}
+}
+
+template<typename IntersectFunc>
+void BVH::View::closestHit(int root, RayPacket &packet, int i, IntersectFunc &intersect) const
+{
+	// The same as the single-ray closestHit(), with the ray's t as the closest hit so far
+	Ray ray = packet.getRay(i, packet.tLimit[i]);
+
+	struct Entry {int node; float tEntry;} stack[STACK_SIZE];
+	Entry first = {root, 0};
+	stack[0] = first;
+	int stackSize = 1;
+
+	while(stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+		if(entry.tEntry > packet.t[i])
+			continue;
+
+		const Node &node = nodes[entry.node];
+		if(node.count > 0) // leaf
+		{
+			for(int j = node.first; j < node.first + node.count; j++)
+				intersect(primitives[j], &i, 1);
+			ray.tMax = packet.tLimit[i];
+		}
+		else
+		{
+			float tLeft, tRight;
+			bool hitLeft = nodes[node.first].bounds.intersect(ray, tLeft);
+			bool hitRight = nodes[node.first + 1].bounds.intersect(ray, tRight);
+
+			if(hitLeft && hitRight)
+			{
+				Entry left = {node.first, tLeft}, right = {node.first + 1, tRight};
+				stack[stackSize++] = (tLeft < tRight) ? right : left;
+				stack[stackSize++] = (tLeft < tRight) ? left : right;
+			}
+			else if(hitLeft)
+			{
+				Entry left = {node.first, tLeft};
+				stack[stackSize++] = left;
+			}
+			else if(hitRight)
+			{
+				Entry right = {node.first + 1, tRight};
+				stack[stackSize++] = right;
+			}
+		}
+	}
+}
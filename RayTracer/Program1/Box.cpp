@@ -131,4 +131,31 @@ void Box::initialize(vec3 boxColor)
 	Box::boxColor = boxColor;
 
 	initialized = true;
-}
\ No newline at end of file
+}
+void Box::addTriangles(const mat4 &transform, unsigned firstFaceId, TriangleBatch &triangles, std::vector<vec3> &cornerNormals)
+{
+	mat3 normalTransform = glm::transpose(glm::inverse(mat3(transform)));
+	for(int axis = 0; axis < 3; axis++)
+	{
+		for(int side = 0; side < 2; side++)
+		{
+			// The face's normal, and two directions across it whose cross product is the normal (so the corners below wind CCW)
+			vec3 normal(0.0f), across(0.0f), up(0.0f);
+			float sign = side ? 1.0f : -1.0f;
+			normal[axis] = sign;
+			across[(axis + 1) % 3] = sign * 0.5f;
+			up[(axis + 2) % 3] = 0.5f;
+
+			vec3 center = 0.5f * normal;
+			vec3 corners[4] = {center - across - up, center + across - up, center + across + up, center - across + up};
+			for(int i = 0; i < 4; i++)
+				corners[i] = v4Tov3(transform * vec4(corners[i], 1));
+
+			vec3 shadingNormal = glm::normalize(normalTransform * normal);
+			unsigned faceId = firstFaceId + 2*axis + side;
+			triangles.add(buildTriangle(corners[0], corners[1], corners[2]), faceId);
+			triangles.add(buildTriangle(corners[0], corners[2], corners[3]), faceId);
+			cornerNormals.insert(cornerNormals.end(), 6, shadingNormal);
+		}
+	}
+}
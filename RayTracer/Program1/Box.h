@@ -10,6 +10,7 @@
 #pragma once
 
 #include "GeometryItem.h"
+#include "Intersection.h"
 
 // Unit cube
 class Box : public AbstractGeometryItem
@@ -32,6 +33,45 @@ public:
 
 	virtual float getUnitHeight() { return 1.0f; }
 
+	virtual double intersect(const Ray &ray)
+	{
+		return rayCubeIntersect(ray);
+	}
+
+	virtual double intersect(const Ray &ray, vec3 &normal)
+	{
+		double t = rayCubeIntersect(ray);
+		if(t >= 0)
+		{
+			// The face hit is the one on the axis the hit point is farthest along
+			vec3 hit = ray.at(t);
+			vec3 dist = glm::abs(hit);
+			int axis = (dist.x > dist.y) ? ((dist.x > dist.z) ? 0 : 2) : ((dist.y > dist.z) ? 1 : 2);
+			normal = vec3(0.0f);
+			normal[axis] = (hit[axis] < 0) ? -1.0f : 1.0f;
+		}
+		return t;
+	}
+
+	virtual void getBounds(vec3 &boundsMin, vec3 &boundsMax)
+	{
+		boundsMin = vec3(-0.5f, -0.5f, -0.5f);
+		boundsMax = vec3(0.5f, 0.5f, 0.5f);
+	}
+
+	virtual vec3 getColor() { return boxColor; }
+
+	virtual void getTriangles(TriangleBatch &triangles, std::vector<vec3> &cornerNormals)
+	{
+		triangles.clear();
+		cornerNormals.clear();
+		addTriangles(mat4(1.0f), 0, triangles, cornerNormals);
+	}
+
+	// Adds the unit cube's 12 triangles, transformed by transform, to triangles (and their flat normals to cornerNormals). The face ids
+	// are firstFaceId and the 5 after it, one per side of the cube.
+	static void addTriangles(const mat4 &transform, unsigned firstFaceId, TriangleBatch &triangles, std::vector<vec3> &cornerNormals);
+
 	// Default constructor - nothing to see here, move along people
 	Box() : initialized(false)
 	{ }
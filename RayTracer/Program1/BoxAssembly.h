@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "AbstractGeometryItem.h"
+#include "Box.h"
+#include "BVH.h"
+
+using glm::mat4;
+using glm::vec3;
+
+// Base class for furniture built out of Boxes (Table and Chair): each part is the one shared Box under its own transformation.
+// Derived classes add their parts in their constructors with addPart(), and then call finishParts(), which precomputes everything
+// raytracing needs - each part's inverse transformation, and a small BVH over the parts. Since every table (or chair) in the scene is
+// the same Table object placed by a different scene graph node, this is built once per kind of furniture, not once per item.
+class BoxAssembly : public AbstractGeometryItem
+{
+public:
+	virtual void draw(mat4 transform)
+	{
+		for(size_t i = 0; i < parts.size(); i++)
+			box.draw(transform * parts[i]);
+	}
+
+	virtual double intersect(const Ray &ray)
+	{
+		double t = -1;
+		bvh.closestHit(ray, t, [&](int i) -> double {
+			return intersectTransformed(ray, partInverses[i], box);
+		});
+		return t;
+	}
+
+	virtual double intersect(const Ray &ray, vec3 &normal)
+	{
+		double t = -1;
+		int part = bvh.closestHit(ray, t, [&](int i) -> double {
+			return intersectTransformed(ray, partInverses[i], box);
+		});
+		if(part >= 0)
+			intersectTransformed(ray, partInverses[part], box, normal);
+		return t;
+	}
+
+	virtual void getBounds(vec3 &boundsMin, vec3 &boundsMax)
+	{
+		AABB bounds = bvh.getBounds();
+		boundsMin = bounds.pMin;
+		boundsMax = bounds.pMax;
+	}
+
+	virtual vec3 getColor() { return box.getColor(); }
+
+	virtual void getTriangles(TriangleBatch &triangles, std::vector<vec3> &cornerNormals)
+	{
+		triangles.clear();
+		cornerNormals.clear();
+		for(size_t i = 0; i < parts.size(); i++)
+			Box::addTriangles(parts[i], (unsigned)(6*i), triangles, cornerNormals);
+	}
+
+protected:
+	Box box;
+
+	void addPart(const mat4 &transform)
+	{
+		parts.push_back(transform);
+	}
+
+	void finishParts()
+	{
+		partInverses.clear();
+		std::vector<AABB> partBounds;
+		for(size_t i = 0; i < parts.size(); i++)
+		{
+			partInverses.push_back(glm::inverse(parts[i]));
+
+			vec3 boundsMin, boundsMax;
+			box.getBounds(boundsMin, boundsMax);
+			transformBounds(parts[i], boundsMin, boundsMax);
+			partBounds.push_back(AABB(boundsMin, boundsMax));
+		}
+		bvh.build(partBounds);
+	}
+
+private:
+	std::vector<mat4> parts; // transformation of each box, relative to the assembly
+	std::vector<mat4> partInverses;
+	BVH bvh; // over the parts
+};
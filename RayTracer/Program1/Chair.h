@@ -11,50 +11,48 @@
 
 #include "../glm/gtc/matrix_transform.hpp"
 
-#include "AbstractGeometryItem.h"
-#include "Box.h"
+#include "BoxAssembly.h"
 
 using glm::mat4;
 using glm::vec3;
 using glm::scale;
 using glm::translate;
 
-class Chair : public AbstractGeometryItem
+class Chair : public BoxAssembly
 {
 public:
-	void initialize(vec3 chairColor)
-	{
-		box.initialize(chairColor);
-	}
-
-	// Pure virtual functions inherited from AbstractGeometryItem
-	virtual void draw(mat4 transform)
+	// Lays out the chair's boxes
+	Chair()
 	{
 		mat4 seatTrans = translate(mat4(1.0f), vec3(0.0f, 0.5f, 0.0f));
 		mat4 seatScale = scale(mat4(1.0f), vec3(1.0f, 0.2f, 1.0f));
-		box.draw(transform * seatTrans * seatScale);
+		addPart(seatTrans * seatScale);
 
 		mat4 backingScale = scale(mat4(1.0f), vec3(1.0f, 1.0f, 0.2f));
 		mat4 backingTrans = translate(mat4(1.0f), vec3(0.0f, 1.1f, -0.3f));
-		box.draw(transform * backingTrans * backingScale);
+		addPart(backingTrans * backingScale);
 
 		mat4 legTrans = scale(mat4(1.0f), vec3(0.05f, 1.0f, 0.05f));
 		mat4 frontLeftLegTrans = translate(mat4(1.0f), vec3(-0.475f, 0.0f, 0.475f));
 		mat4 frontRightLegTrans = translate(mat4(1.0f), vec3(0.475f, 0.0f, 0.475f));
 		mat4 backLeftLegTrans = translate(mat4(1.0f), vec3(-0.475f, 0.0f, -0.475f));
 		mat4 backRightLegTrans = translate(mat4(1.0f), vec3(0.475f, 0.0f, -0.475f));
-		
-		box.draw(transform * frontLeftLegTrans * legTrans);
-		box.draw(transform * frontRightLegTrans * legTrans);
-		box.draw(transform * backLeftLegTrans * legTrans);
-		box.draw(transform * backRightLegTrans * legTrans);
+		addPart(frontLeftLegTrans * legTrans);
+		addPart(frontRightLegTrans * legTrans);
+		addPart(backLeftLegTrans * legTrans);
+		addPart(backRightLegTrans * legTrans);
+
+		finishParts();
 	}
 
+	void initialize(vec3 chairColor)
+	{
+		box.initialize(chairColor);
+	}
+
+	// Pure virtual function inherited from AbstractGeometryItem (the rest are implemented by BoxAssembly)
 	virtual float getUnitHeight()
 	{
 		return 2.2; //chair leg yScale = 1.0, seat yScale = 0.2, back yScale = 1.0, so chair height = 2.2
 	}
-
-private:
-	Box box;
 };
\ No newline at end of file
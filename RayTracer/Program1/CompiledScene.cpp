@@ -0,0 +1,404 @@
+#include "CompiledScene.h"
+
+#include <fstream>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <climits>
+
+#include "Intersection.h"
+
+static const char MAGIC[8] = "RTSCENE";
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Appends size bytes from data to out, after padding out with zeros to the next multiple of alignment, and returns the offset it put
+// them at
+static uint64_t append(std::vector<char> &out, const void *data, size_t size, size_t alignment)
+{
+	out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+	uint64_t offset = out.size();
+	out.insert(out.end(), (const char*)data, (const char*)data + size);
+	return offset;
+}
+
+CompiledScene::CompiledScene() : header(0), instances(0), geometries(0)
+{
+}
+
+void CompiledScene::write(SceneGraph &scene, const std::string &fileName)
+{
+	scene.updateTransforms();
+	std::vector<SceneGraph::Node*> nodes;
+	scene.collectGeometryNodes(nodes);
+
+	std::vector<char> out(sizeof(Header), 0); // the header goes in last, once all the offsets are known
+	Header fileHeader;
+	memset(&fileHeader, 0, sizeof(fileHeader));
+
+	// Each geometry item once, however many nodes use it, with its triangles in the order of their own BVH (as Mesh keeps its)
+	std::map<AbstractGeometryItem*, int> geometryIndices;
+	std::vector<Geometry> geometryRecords;
+	std::vector<AABB> geometryBounds;
+	std::vector<SceneGraph::Node*> instanceNodes;
+	std::vector<uint32_t> instanceGeometries;
+	for(size_t n = 0; n < nodes.size(); n++)
+	{
+		AbstractGeometryItem *geo = nodes[n]->getGeometry();
+		std::map<AbstractGeometryItem*, int>::iterator found = geometryIndices.find(geo);
+		if(found == geometryIndices.end())
+		{
+			TriangleBatch triangles;
+			std::vector<vec3> cornerNormals;
+			geo->getTriangles(triangles, cornerNormals);
+
+			std::vector<AABB> triangleBounds(triangles.size());
+			for(int i = 0; i < triangles.size(); i++)
+			{
+				Triangle tri = triangles.getTriangle(i);
+				triangleBounds[i].expand(tri.p1);
+				triangleBounds[i].expand(tri.p1 + tri.e1);
+				triangleBounds[i].expand(tri.p1 + tri.e2);
+			}
+			BVH bvh;
+			bvh.build(triangleBounds);
+
+			// The arrays as they'll be stored: each component padded out to the capacity, and everything in BVH order
+			Geometry geometry;
+			memset(&geometry, 0, sizeof(geometry));
+			geometry.numTriangles = triangles.size();
+			geometry.capacity = (triangles.size() + 7) / 8 * 8;
+			geometry.numNodes = bvh.getNodes().size();
+
+			const std::vector<int> &order = bvh.getPrimitiveOrder();
+			TriangleBatch::View source(triangles);
+			std::vector<float> components((size_t)TriangleBatch::NUM_COMPONENTS * geometry.capacity, 0.0f);
+			std::vector<uint32_t> faceIds(triangles.size());
+			std::vector<vec3> orderedNormals(cornerNormals.size());
+			for(int i = 0; i < triangles.size(); i++)
+			{
+				for(int c = 0; c < TriangleBatch::NUM_COMPONENTS; c++)
+					components[(size_t)c * geometry.capacity + i] = source.get((TriangleBatch::Component)c)[order[i]];
+				faceIds[i] = triangles.getFaceId(order[i]);
+				for(int c = 0; c < 3; c++)
+					orderedNormals[3*i + c] = cornerNormals[3*order[i] + c];
+			}
+			bvh.renumberPrimitives();
+
+			if(!triangles.size())
+				geometry.trianglesOffset = geometry.faceIdsOffset = geometry.cornerNormalsOffset = geometry.nodesOffset =
+					geometry.primitivesOffset = append(out, 0, 0, FILE_ALIGNMENT);
+			else
+			{
+				geometry.trianglesOffset = append(out, &components[0], components.size() * sizeof(float), FILE_ALIGNMENT);
+				geometry.faceIdsOffset = append(out, &faceIds[0], faceIds.size() * sizeof(uint32_t), FILE_ALIGNMENT);
+				geometry.cornerNormalsOffset = append(out, &orderedNormals[0], orderedNormals.size() * sizeof(vec3), FILE_ALIGNMENT);
+				geometry.nodesOffset = append(out, &bvh.getNodes()[0], bvh.getNodes().size() * sizeof(BVH::Node), FILE_ALIGNMENT);
+				geometry.primitivesOffset = append(out, &order[0], order.size() * sizeof(int), FILE_ALIGNMENT);
+			}
+
+			found = geometryIndices.insert(std::make_pair(geo, (int)geometryRecords.size())).first;
+			geometryRecords.push_back(geometry);
+			geometryBounds.push_back(bvh.getBounds());
+		}
+
+		// Nothing can hit a node whose geometry has no triangles, so it's left out
+		if(geometryRecords[found->second].numTriangles > 0)
+		{
+			instanceNodes.push_back(nodes[n]);
+			instanceGeometries.push_back(found->second);
+		}
+	}
+
+	// The top-level BVH, over the instances' world-space bounds, with the instances stored in its order too
+	std::vector<AABB> instanceBounds(instanceNodes.size());
+	for(size_t i = 0; i < instanceNodes.size(); i++)
+	{
+		const AABB &bounds = geometryBounds[instanceGeometries[i]];
+		vec3 boundsMin = bounds.pMin, boundsMax = bounds.pMax;
+		transformBounds(instanceNodes[i]->getWorldTransform(), boundsMin, boundsMax);
+		instanceBounds[i] = AABB(boundsMin, boundsMax);
+	}
+	BVH instanceBVH;
+	instanceBVH.build(instanceBounds);
+
+	const std::vector<int> &order = instanceBVH.getPrimitiveOrder();
+	std::vector<Instance> instanceRecords(instanceNodes.size());
+	for(size_t i = 0; i < instanceNodes.size(); i++)
+	{
+		SceneGraph::Node *node = instanceNodes[order[i]];
+		instanceRecords[i].worldTransform = glm::mat4x3(node->getWorldTransform());
+		instanceRecords[i].worldInverse = glm::mat4x3(node->getWorldInverse());
+		instanceRecords[i].color = node->getGeometry()->getColor();
+		instanceRecords[i].geometry = instanceGeometries[order[i]];
+	}
+	instanceBVH.renumberPrimitives();
+
+	memcpy(fileHeader.magic, MAGIC, sizeof(MAGIC));
+	fileHeader.version = VERSION;
+	fileHeader.byteOrder = BYTE_ORDER_MARK;
+	fileHeader.headerSize = sizeof(Header);
+	fileHeader.instanceSize = sizeof(Instance);
+	fileHeader.geometrySize = sizeof(Geometry);
+	fileHeader.nodeSize = sizeof(BVH::Node);
+	fileHeader.numInstances = instanceRecords.size();
+	fileHeader.numGeometries = geometryRecords.size();
+	fileHeader.numNodes = instanceBVH.getNodes().size();
+	fileHeader.instancesOffset = instanceRecords.empty() ? append(out, 0, 0, FILE_ALIGNMENT)
+		: append(out, &instanceRecords[0], instanceRecords.size() * sizeof(Instance), FILE_ALIGNMENT);
+	fileHeader.geometriesOffset = geometryRecords.empty() ? append(out, 0, 0, FILE_ALIGNMENT)
+		: append(out, &geometryRecords[0], geometryRecords.size() * sizeof(Geometry), FILE_ALIGNMENT);
+	if(instanceBVH.empty())
+		fileHeader.nodesOffset = fileHeader.primitivesOffset = append(out, 0, 0, FILE_ALIGNMENT);
+	else
+	{
+		fileHeader.nodesOffset = append(out, &instanceBVH.getNodes()[0], instanceBVH.getNodes().size() * sizeof(BVH::Node), FILE_ALIGNMENT);
+		fileHeader.primitivesOffset = append(out, &order[0], order.size() * sizeof(int), FILE_ALIGNMENT);
+	}
+	memcpy(&out[0], &fileHeader, sizeof(Header));
+
+	std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+	file.write(&out[0], out.size());
+	file.close();
+	if(file.fail())
+	{
+		SceneGraphException ex;
+		ex.reason = "CompiledScene: can't write " + fileName;
+		throw ex;
+	}
+}
+
+bool CompiledScene::isCompiledScene(const std::string &fileName)
+{
+	char magic[sizeof(MAGIC)];
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	return file.read(magic, sizeof(magic)) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void CompiledScene::load(const std::string &fileName)
+{
+	clear();
+
+	std::string problem;
+	if(!file.open(fileName))
+		problem = "can't open ";
+	else
+	{
+		const Header *fileHeader = (const Header*)file.getData();
+		if(file.getSize() < sizeof(Header) || memcmp(fileHeader->magic, MAGIC, sizeof(MAGIC)) != 0)
+			problem = "not a compiled scene: ";
+		else if(fileHeader->byteOrder != BYTE_ORDER_MARK || fileHeader->headerSize != sizeof(Header) ||
+			fileHeader->instanceSize != sizeof(Instance) || fileHeader->geometrySize != sizeof(Geometry) || fileHeader->nodeSize != sizeof(BVH::Node))
+			problem = "compiled on a different kind of machine: ";
+		else if(fileHeader->version != VERSION)
+			problem = "compiled by a different version: ";
+		else if(fileHeader->numInstances > INT_MAX || fileHeader->numGeometries > INT_MAX || fileHeader->numNodes > INT_MAX ||
+			!isInFile(fileHeader->instancesOffset, fileHeader->numInstances, sizeof(Instance)) ||
+			!isInFile(fileHeader->geometriesOffset, fileHeader->numGeometries, sizeof(Geometry)) ||
+			!isInFile(fileHeader->nodesOffset, fileHeader->numNodes, sizeof(BVH::Node)) ||
+			!isInFile(fileHeader->primitivesOffset, fileHeader->numInstances, sizeof(int)))
+			problem = "damaged compiled scene: ";
+		else
+		{
+			header = fileHeader;
+			instances = (const Instance*)(file.getData() + header->instancesOffset);
+			geometries = (const Geometry*)(file.getData() + header->geometriesOffset);
+			instanceBVH = BVH::View((const BVH::Node*)(file.getData() + header->nodesOffset), header->numNodes,
+				(const int*)(file.getData() + header->primitivesOffset));
+
+			bool valid = instanceBVH.isValid(header->numInstances);
+			for(uint32_t i = 0; valid && i < header->numGeometries; i++)
+				valid = isValidGeometry(geometries[i]);
+			for(uint32_t i = 0; valid && i < header->numInstances; i++)
+				valid = instances[i].geometry < header->numGeometries;
+			if(!valid)
+				problem = "damaged compiled scene: ";
+		}
+	}
+
+	if(!problem.empty())
+	{
+		clear();
+		SceneGraphException ex;
+		ex.reason = "CompiledScene: " + problem + fileName;
+		throw ex;
+	}
+}
+
+void CompiledScene::clear()
+{
+	file.close();
+	header = 0;
+	instances = 0;
+	geometries = 0;
+	instanceBVH = BVH::View();
+}
+
+int CompiledScene::getNumTriangles() const
+{
+	int numTriangles = 0;
+	for(int i = 0; i < getNumGeometries(); i++)
+		numTriangles += geometries[i].numTriangles;
+	return numTriangles;
+}
+
+bool CompiledScene::isInFile(uint64_t offset, uint64_t count, size_t elementSize) const
+{
+	if(offset % FILE_ALIGNMENT != 0 || offset > file.getSize())
+		return false;
+	return count <= (file.getSize() - offset) / elementSize;
+}
+
+bool CompiledScene::isValidGeometry(const Geometry &geometry) const
+{
+	if(geometry.numTriangles > INT_MAX / 3 || geometry.capacity < geometry.numTriangles || geometry.capacity % 8 != 0 ||
+		geometry.numNodes > INT_MAX || (geometry.numNodes == 0) != (geometry.numTriangles == 0))
+		return false;
+
+	return isInFile(geometry.trianglesOffset, (uint64_t)TriangleBatch::NUM_COMPONENTS * geometry.capacity, sizeof(float)) &&
+		isInFile(geometry.faceIdsOffset, geometry.numTriangles, sizeof(uint32_t)) &&
+		isInFile(geometry.cornerNormalsOffset, 3 * (uint64_t)geometry.numTriangles, sizeof(vec3)) &&
+		isInFile(geometry.nodesOffset, geometry.numNodes, sizeof(BVH::Node)) &&
+		isInFile(geometry.primitivesOffset, geometry.numTriangles, sizeof(int)) &&
+		getBVH(geometry).isValid(geometry.numTriangles);
+}
+
+TriangleBatch::View CompiledScene::getTriangles(const Geometry &geometry) const
+{
+	return TriangleBatch::View((const float*)(file.getData() + geometry.trianglesOffset), geometry.numTriangles, geometry.capacity,
+		(const unsigned*)(file.getData() + geometry.faceIdsOffset));
+}
+
+BVH::View CompiledScene::getBVH(const Geometry &geometry) const
+{
+	return BVH::View((const BVH::Node*)(file.getData() + geometry.nodesOffset), geometry.numNodes,
+		(const int*)(file.getData() + geometry.primitivesOffset));
+}
+
+int CompiledScene::intersectInstance(const Instance &instance, const Ray &ray, double &t) const
+{
+	// The ray in object space, where t comes out in the same units it has in world space
+	Ray objectRay = ray.transformed(instance.worldInverse);
+
+	const Geometry &geometry = geometries[instance.geometry];
+	TriangleBatch::View triangles = getTriangles(geometry);
+	return getBVH(geometry).closestHit(objectRay, t, [&](int i) -> double {
+		return rayTriangleIntersect(objectRay, triangles, i);
+	});
+}
+
+int CompiledScene::intersect(const Ray &ray, double &t, vec3 &normal) const
+{
+	vec3 faceNormal;
+	return intersect(ray, t, normal, faceNormal);
+}
+
+int CompiledScene::intersect(const Ray &ray, double &t, vec3 &normal, vec3 &faceNormal) const
+{
+	// Keep the triangle of each hit closestHit() takes as the closest so far (it takes one that's closer than all before it, within the
+	// ray's reach), so the instance that was hit doesn't need tracing again to find it
+	int triangle = -1;
+	double tTriangle = ray.tMax;
+	int hit = instanceBVH.closestHit(ray, t, [&](int i) -> double {
+		double tInstance;
+		int instanceTriangle = intersectInstance(instances[i], ray, tInstance);
+		if(instanceTriangle < 0)
+			return -1;
+		if(tInstance < tTriangle)
+		{
+			triangle = instanceTriangle;
+			tTriangle = tInstance;
+		}
+		return tInstance;
+	});
+	if(hit < 0)
+		return -1;
+
+	// As in SceneGraph::intersect(), only the instance that was hit works out its normal
+	getNormals(instances[hit], triangle, ray.transformed(instances[hit].worldInverse), normal, faceNormal);
+	return hit;
+}
+
+int CompiledScene::intersect(const vec3 &p0, const vec3 &v0, double &t, vec3 &normal) const
+{
+	return intersect(Ray(p0, glm::normalize(v0)), t, normal);
+}
+
+void CompiledScene::intersect(RayPacket &packet, vec3 *normals, vec3 *faceNormals) const
+{
+	// As with SceneGraph, each instance traces the rays that reach it as a packet of their own in its object space - through its
+	// geometry's BVH here - which also leaves us the triangle each ray hit, for its normal
+	int triangles[RayPacket::MAX_SIZE];
+	RayPacket objectRays;
+	instanceBVH.closestHits(packet, [&](int i, const int *rays, int numRays) {
+		const Instance &instance = instances[i];
+		objectRays.reset(instance.worldInverse * glm::vec4(packet.origin, 1));
+		for(int j = 0; j < numRays; j++)
+			objectRays.add(instance.worldInverse * glm::vec4(packet.getDirection(rays[j]), 0), packet.t[rays[j]]);
+
+		const Geometry &geometry = geometries[instance.geometry];
+		TriangleBatch::View triangleBatch = getTriangles(geometry);
+		getBVH(geometry).closestHits(objectRays, [&](int triangle, const int *objectRayList, int numObjectRays) {
+			for(int k = 0; k < numObjectRays; k++)
+			{
+				int ray = objectRayList[k];
+				double t = rayTriangleIntersect(objectRays.origin, objectRays.getDirection(ray), triangleBatch, triangle);
+				if(t >= 0)
+					objectRays.recordHit(ray, t, triangle);
+			}
+		});
+
+		for(int j = 0; j < numRays; j++)
+		{
+			if(objectRays.hit[j] >= 0)
+			{
+				packet.recordHit(rays[j], objectRays.t[j], i);
+				triangles[rays[j]] = objectRays.hit[j];
+			}
+		}
+	});
+
+	for(int i = 0; i < packet.size; i++)
+	{
+		if(packet.hit[i] >= 0)
+		{
+			const Instance &instance = instances[packet.hit[i]];
+			getNormals(instance, triangles[i], packet.getRay(i).transformed(instance.worldInverse), normals[i], faceNormals[i]);
+		}
+	}
+}
+
+void CompiledScene::getNormals(const Instance &instance, int triangle, const Ray &objectRay, vec3 &normal, vec3 &faceNormal) const
+{
+	// Blend the triangle's corner normals, and bring the result (and the triangle's own normal) out of object space through the
+	// inverse transpose
+	const Geometry &geometry = geometries[instance.geometry];
+	TriangleBatch::View triangles = getTriangles(geometry);
+	float u, v;
+	getTriangleBarycentrics(objectRay, triangles, triangle, u, v);
+	const vec3 *corners = getCornerNormals(geometry) + 3*triangle;
+	vec3 objectNormal = (1 - u - v) * corners[0] + u * corners[1] + v * corners[2];
+	glm::mat3 normalMatrix = glm::transpose(glm::mat3(instance.worldInverse));
+	normal = glm::normalize(normalMatrix * objectNormal);
+	faceNormal = glm::normalize(normalMatrix * triangles.getNormal(triangle));
+}
+
+bool CompiledScene::occluded(const Ray &ray) const
+{
+	return instanceBVH.anyHit(ray, [&](int i) -> double {
+		const Instance &instance = instances[i];
+		Ray objectRay = ray.transformed(instance.worldInverse);
+
+		// Any triangle short of tMax will do, and then the instance counts as hit right where the ray starts
+		const Geometry &geometry = geometries[instance.geometry];
+		TriangleBatch::View triangles = getTriangles(geometry);
+		bool hit = getBVH(geometry).anyHit(objectRay, [&](int t) -> double {
+			return rayTriangleIntersect(objectRay, triangles, t);
+		});
+		return hit ? ray.tMin : -1.0;
+	});
+}
+
+bool CompiledScene::occluded(const vec3 &p0, const vec3 &v0, double tMax) const
+{
+	return occluded(Ray(p0, glm::normalize(v0), 0, (float)tMax));
+}
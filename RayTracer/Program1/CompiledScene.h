@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "../glm/glm.hpp"
+
+#include "SceneGraph.h"
+#include "BVH.h"
+#include "MappedFile.h"
+#include "ExceptionClasses.h"
+#include "../../IntersectionTesting/FinalProject_IntersectionTesting/batch.h"
+
+using glm::vec3;
+
+// A scene flattened into a single binary file, for raytracing straight out of memory: every node with geometry becomes an instance
+// holding its resolved world transformation (and inverse) and color, every geometry item those use becomes one triangle batch in the
+// order of its own prebuilt BVH, and the instances have a prebuilt BVH over them too - which is everything SceneGraph::buildBVH()
+// and the geometry items build for raytracing, already done. load() maps the file and points into it, with no parsing and no
+// allocation per object, so it takes about as long as the OS takes to map the file however big the scene is.
+//
+// Boxes and the furniture built from them are stored as triangles like everything else, so they render the same apart from
+// floating point noise at the edges. The file is only meant to be read on the kind of machine that wrote it: load() refuses files
+// with a different byte order or structure layout rather than converting them.
+class CompiledScene
+{
+public:
+	CompiledScene();
+
+	// Flattens scene into a compiled scene file at fileName (updating the nodes' cached transformations on the way), replacing any
+	// file that's there. Throws a SceneGraphException if the file can't be written.
+	static void write(SceneGraph &scene, const std::string &fileName);
+
+	// Returns true if fileName starts the way a compiled scene file does (to tell them apart from scene description files)
+	static bool isCompiledScene(const std::string &fileName);
+
+	// Maps the compiled scene in fileName, replacing the scene loaded before. Throws a SceneGraphException (leaving nothing loaded)
+	// if the file can't be mapped, or if it isn't a compiled scene this build can use - checking every offset and hierarchy in it,
+	// so a damaged file can't make the queries below read outside of it.
+	void load(const std::string &fileName);
+	void clear();
+
+	int getNumInstances() const {return header ? (int)header->numInstances : 0;}
+	int getNumGeometries() const {return header ? (int)header->numGeometries : 0;}
+	int getNumTriangles() const; // over all the geometries (not instances)
+
+	vec3 getColor(int instance) const {return instances[instance].color;}
+
+	// The same queries as SceneGraph's: the closest instance along the (world-space) ray within its [tMin, tMax] (or -1 on a miss),
+	// with the distance to it in units of the ray's direction in t and the (unit length, world-space) normal of the surface hit in
+	// normal...
+	int intersect(const Ray &ray, double &t, vec3 &normal) const;
+	// ...or with the normal of the triangle actually hit in faceNormal too, for starting secondary rays off it (normal is blended
+	// between its corners')...
+	int intersect(const Ray &ray, double &t, vec3 &normal, vec3 &faceNormal) const;
+	// ...and whether anything lies along the ray within its [tMin, tMax)
+	bool occluded(const Ray &ray) const;
+	// Both for the ray from p0 in direction v0, with t and tMax in units of normalized v0
+	int intersect(const vec3 &p0, const vec3 &v0, double &t, vec3 &normal) const;
+	bool occluded(const vec3 &p0, const vec3 &v0, double tMax) const;
+	// The closest hits along every ray in packet at once, as SceneGraph's packet intersect() does, for unit length directions: each
+	// ray's distance to the closest hit in packet.t, the instance it hit (or -1) in packet.hit, and the normals there in normals[i]
+	// and faceNormals[i]
+	void intersect(RayPacket &packet, vec3 *normals, vec3 *faceNormals) const;
+
+private:
+	// File layout. Everything is stored in place in native byte order, with each array starting at a multiple of FILE_ALIGNMENT
+	// bytes from the start of the file (at an offset given in the header or a Geometry), so that the triangle arrays are aligned for
+	// the SIMD kernels once the file is mapped.
+	static const int FILE_ALIGNMENT = 32;
+	static const uint32_t VERSION = 1;
+
+	struct Header
+	{
+		char magic[8]; // "RTSCENE" and a terminating 0
+		uint32_t version;
+		uint32_t byteOrder; // 0x01020304, as written by the machine that wrote the file
+		uint32_t headerSize, instanceSize, geometrySize, nodeSize; // the sizes of the structures below, which must match ours
+		uint32_t numInstances, numGeometries;
+		uint32_t numNodes, reserved; // the top-level BVH's nodes (over instances)
+		uint64_t instancesOffset, geometriesOffset, nodesOffset, primitivesOffset;
+	};
+
+	// A node with geometry, in the order of the top-level BVH (so its primitive i is instance i)
+	struct Instance
+	{
+		glm::mat4x3 worldTransform, worldInverse; // the bottom rows are always 0 0 0 1
+		vec3 color;
+		uint32_t geometry; // index into the geometries
+	};
+
+	// One geometry item's triangles, in the order of its BVH, stored like a TriangleBatch: a float array for each component with
+	// room for capacity triangles each (a multiple of 8, so each array stays aligned), then a face id for each triangle and the
+	// vertex normals at its three corners.
+	struct Geometry
+	{
+		uint32_t numTriangles, capacity;
+		uint32_t numNodes, reserved;
+		uint64_t trianglesOffset, faceIdsOffset, cornerNormalsOffset, nodesOffset, primitivesOffset;
+	};
+
+	MappedFile file;
+	const Header *header; // null when nothing is loaded
+	const Instance *instances;
+	const Geometry *geometries;
+	BVH::View instanceBVH;
+
+	// Views of a geometry's arrays, which are only pointers into the file, so they're made as they're needed
+	TriangleBatch::View getTriangles(const Geometry &geometry) const;
+	BVH::View getBVH(const Geometry &geometry) const;
+	const vec3 *getCornerNormals(const Geometry &geometry) const {return (const vec3*)(file.getData() + geometry.cornerNormalsOffset);}
+
+	// Checks that the count elements of elementSize bytes at offset are aligned and inside the file
+	bool isInFile(uint64_t offset, uint64_t count, size_t elementSize) const;
+	bool isValidGeometry(const Geometry &geometry) const;
+
+	// Closest triangle of instance's geometry along the ray (in world space), or -1, with its t in t
+	int intersectInstance(const Instance &instance, const Ray &ray, double &t) const;
+	// The (unit length, world-space) normal and face normal where the ray, already brought into instance's object space, hits
+	// triangle of its geometry
+	void getNormals(const Instance &instance, int triangle, const Ray &objectRay, vec3 &normal, vec3 &faceNormal) const;
+
+	// Not copyable (nor is the mapping)
+	CompiledScene(const CompiledScene&);
+	CompiledScene& operator=(const CompiledScene&);
+};
@@ -14,7 +14,7 @@
 
 class SceneGraphException : public std::exception
 {
-	virtual const char* what() const
+	virtual const char* what() const throw()
 	{
 		return reason.c_str();
 	}
@@ -25,7 +25,19 @@ public:
 
 class MeshException : public std::exception
 {
-	virtual const char* what() const
+	virtual const char* what() const throw()
+	{
+		return reason.c_str();
+	}
+
+public:
+	std::string reason;
+};
+
+// Thrown by TextScanner, with a reason that says where in the file the problem is
+class ParseException : public std::exception
+{
+	virtual const char* what() const throw()
 	{
 		return reason.c_str();
 	}
@@ -0,0 +1,36 @@
+#include "GeometryCache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <limits>
+
+bool GeometryCache::makeKey(const std::string &path, int numSubdivides, Key &key)
+{
+	struct stat info;
+	if(stat(path.c_str(), &info) != 0)
+		return false;
+
+	key.path = path;
+	key.numSubdivides = numSubdivides;
+	key.modified = info.st_mtime;
+	return true;
+}
+
+std::shared_ptr<Mesh> GeometryCache::find(const Key &key) const
+{
+	std::map<Key, std::shared_ptr<Mesh>>::const_iterator entry = entries.find(key);
+	return entry != entries.end() ? entry->second : std::shared_ptr<Mesh>();
+}
+
+void GeometryCache::insert(const Key &key, std::shared_ptr<Mesh> mesh)
+{
+	// Entries for the same path and subdivisions are next to each other (only their modification times differ), so start from the
+	// first one and drop everything up to the end of the run
+	Key first = key;
+	first.modified = std::numeric_limits<time_t>::min();
+	std::map<Key, std::shared_ptr<Mesh>>::iterator entry = entries.lower_bound(first);
+	while(entry != entries.end() && entry->first.path == key.path && entry->first.numSubdivides == key.numSubdivides)
+		entries.erase(entry++);
+
+	entries[key] = mesh;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <ctime>
+
+#include "Mesh.h"
+
+// Meshes built from geometry description files, keyed by the file they came from, how many times they were subdivided, and when
+// the file was last modified - so a file that's referenced over and over (within a scene, or across scenes loaded one after another)
+// is only built once, but one that changes on disk gets built again. Meshes are handed out shared: whoever uses one must treat it as
+// immutable, since any number of scene graph nodes (in any number of scenes) may be using it.
+class GeometryCache
+{
+public:
+	struct Key
+	{
+		std::string path; // as it was given, after making it relative to the scene file (so two spellings of one path are two keys)
+		int numSubdivides;
+		time_t modified;
+
+		bool operator<(const Key &other) const
+		{
+			if(path != other.path)
+				return path < other.path;
+			if(numSubdivides != other.numSubdivides)
+				return numSubdivides < other.numSubdivides;
+			return modified < other.modified;
+		}
+	};
+
+	// Makes the key for the file at path as it is on disk right now. Returns false if the file doesn't exist (or can't be looked at).
+	static bool makeKey(const std::string &path, int numSubdivides, Key &key);
+
+	// The mesh built for key, or null if there isn't one
+	std::shared_ptr<Mesh> find(const Key &key) const;
+
+	// Adds a mesh that's been built (and buffered) for key. Any meshes built from older versions of the same file (with the same
+	// number of subdivisions) are dropped, since nothing will ask for them again; scenes that still use them keep them alive.
+	void insert(const Key &key, std::shared_ptr<Mesh> mesh);
+
+	void clear() {entries.clear();}
+	size_t size() const {return entries.size();}
+
+private:
+	std::map<Key, std::shared_ptr<Mesh>> entries;
+};
@@ -9,8 +9,7 @@
 
 #pragma once
 
-#define GLEW_STATIC
-#include "glew.h"
+#include "OpenGL.h"
 #include "../glm/glm.hpp"
 
 #include "AbstractGeometryItem.h"
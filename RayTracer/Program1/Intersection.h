@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cfloat>
+
+// The ray intersection functions are developed (and unit tested) in the IntersectionTesting project;
+// we compile its stubs.cpp and batch.cpp into this project too, rather than keeping a second copy of them here.
+#include "../../IntersectionTesting/FinalProject_IntersectionTesting/batch.h"
+
+// Transforms the axis-aligned box [boundsMin, boundsMax] by transform, and replaces it with an axis-aligned box
+// that contains the result (in place).
+inline void transformBounds(const mat4 &transform, vec3 &boundsMin, vec3 &boundsMax)
+{
+	vec3 newMin(FLT_MAX), newMax(-FLT_MAX);
+	for(int i = 0; i < 8; i++)
+	{
+		vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+		vec3 transformed = v4Tov3(transform * vec4(corner, 1));
+		newMin = glm::min(newMin, transformed);
+		newMax = glm::max(newMax, transformed);
+	}
+	boundsMin = newMin;
+	boundsMax = newMax;
+}
+
+// Intersects a ray with an object through its inverse transformation (the ray starts out in the space the object's transformation
+// takes it into): brings the ray into object space and hands it to the object's own intersect(), which is expected to return t
+// in units of the direction it was given - so the t that comes back is in units of the ray's direction here, too.
+template<typename Object>
+inline double intersectTransformed(const Ray &ray, const mat4 &tInv, Object &object)
+{
+	return object.intersect(ray.transformed(tInv));
+}
+
+// The same, but also gives the normal of the surface hit (from the object's intersect()), brought back out of object space -
+// normals transform by the inverse transpose, which is just the transpose of tInv here. It isn't normalized.
+template<typename Object>
+inline double intersectTransformed(const Ray &ray, const mat4 &tInv, Object &object, vec3 &normal)
+{
+	double t = object.intersect(ray.transformed(tInv), normal);
+	normal = glm::transpose(mat3(tInv)) * normal;
+	return t;
+}
@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// An empty file has nothing to map (and mapping zero bytes fails on both platforms), so it gets this instead
+static const char EMPTY_FILE[1] = {0};
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : data(0), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(0)
+{
+}
+
+bool MappedFile::open(const std::string &fileName)
+{
+	close();
+
+	fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if(fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+	if(size == 0)
+	{
+		data = EMPTY_FILE;
+		return true;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if(mappingHandle)
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if(!data)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(data && data != EMPTY_FILE)
+		UnmapViewOfFile(data);
+	if(mappingHandle)
+		CloseHandle(mappingHandle);
+	if(fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	data = 0;
+	size = 0;
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = 0;
+}
+
+#else
+
+MappedFile::MappedFile() : data(0), size(0)
+{
+}
+
+bool MappedFile::open(const std::string &fileName)
+{
+	close();
+
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	size = (size_t)info.st_size;
+	if(size == 0)
+	{
+		::close(fd);
+		data = EMPTY_FILE;
+		return true;
+	}
+
+	// The mapping keeps the file open by itself, so the descriptor isn't needed past this
+	void *mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mapped == MAP_FAILED)
+	{
+		size = 0;
+		return false;
+	}
+	data = (const char*)mapped;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(data && data != EMPTY_FILE)
+		munmap((void*)data, size);
+	data = 0;
+	size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// A whole file mapped read-only into memory, so it can be used in place rather than read into buffers. The mapping (and the
+// pointer from getData()) lasts until close() or destruction. The data starts on a page boundary, so anything stored at an aligned
+// offset in the file is just as aligned in memory.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps fileName, replacing any file already mapped. Returns false (with nothing mapped) if the file can't be opened or mapped.
+	bool open(const std::string &fileName);
+	void close();
+
+	bool isOpen() const {return data != 0;}
+	const char *getData() const {return data;}
+	size_t getSize() const {return size;}
+
+private:
+	const char *data;
+	size_t size;
+#ifdef _WIN32
+	void *fileHandle, *mappingHandle;
+#endif
+
+	// Not copyable (the mapping would be unmapped twice)
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
@@ -1,133 +1,311 @@
 #include "Mesh.h"
+#include "Parallel.h"
 
-void Mesh::Face::deleteFace()
+#include <algorithm>
+
+const Mesh::Index Mesh::NONE;
+
+void Mesh::deleteFace(Index face)
 {
 	// For original pseudocode, see notes: "[2014-04-07] Subdivision.pptx", slide 20
 
 	// Traverse the halfedges associated with this face:
 	// * If a vertex points to this HE, point it to the symmetric HE on another face instead.
 	// * Point the symmetric HE's sym pointer to null.
-	HalfEdge *he = halfEdge;
+	Index first = faces[face].halfEdge;
+	Index he = first;
 	do
 	{
-		if(he->vertex != 0)
-			he->vertex->halfEdge = he->next->sym;
-		he->sym->sym = 0;
-
-		he = he->next;
-	} while(he != halfEdge); // loop until we've gone around to the halfedge we started at
+		HalfEdge &edge = halfEdges[he];
+		if(vertices[edge.vertex].halfEdge == he)
+			vertices[edge.vertex].halfEdge = halfEdges[edge.next].sym;
+		if(edge.sym != NONE)
+			halfEdges[edge.sym].sym = NONE;
+
+		he = edge.next;
+	} while(he != first); // loop until we've gone around to the halfedge we started at
+
+	// Faces with no half-edge are skipped when building index buffers and triangles
+	faces[face].halfEdge = NONE;
+	trianglesBuilt = false;
 }
 
-vec3 Mesh::Vertex::getNormal()
+vec3 Mesh::getVertexNormal(Index vertex)
 {
 	// For original pseudocode, see notes: "[2014-04-07] Subdivision.pptx", slide 17
 
 	// Start with the normal from the face we have a pointer to
-	vec3 sumNormals = halfEdge->face->normal;
-
-	// Step through all the other faces this vertex is part of, adding them to ours
-	HalfEdge *he = halfEdge->next->sym;
-	while(he != halfEdge)
+	Index first = vertices[vertex].halfEdge;
+	vec3 sumNormals = faces[halfEdges[first].face].normal;
+
+	// Step through all the other faces this vertex is part of, adding them to ours. If we run off the edge of the mesh (no sym), we've
+	// seen all the faces we can get to from here. (No vertex can be on more faces than there are half-edges, so that bounds the walk
+	// even if the syms around this vertex aren't consistent and we never get back to the one we started at.)
+	Index he = halfEdges[halfEdges[first].next].sym;
+	for(size_t steps = 0; he != NONE && he != first && steps < halfEdges.size(); steps++)
 	{
-		sumNormals += he->face->normal;
-		he = he->next->sym;
+		sumNormals += faces[halfEdges[he].face].normal;
+		he = halfEdges[halfEdges[he].next].sym;
 	}
 
 	// Renormalize our normal to get the average of the face normals around this point
 	return glm::normalize(sumNormals);
 }
 
-int Mesh::splitFace(Face *f, Vertex *p1, Vertex *p2)
+void Mesh::computeVertexNormals(std::vector<vec3> &normals) const
+{
+	// Each face's normal, scaled by its area: the cross products of the edges of the triangles it fans out into all point along the
+	// normal, with lengths of twice the triangles' areas, so their sum does both at once (and works for non-planar faces too). The
+	// faces aren't all wound the same way, though, so it's the face's own normal that says which way is out (as in subDivideOnce()).
+	std::vector<vec3> weightedNormals(faces.size());
+	parallelFor(0, faces.size(), [&](size_t f) {
+		vec3 sum(0, 0, 0);
+		Index first = faces[f].halfEdge;
+		if(first != NONE)
+		{
+			const vec3 &p1 = vertices[halfEdges[first].vertex].pos;
+			for(Index he = halfEdges[first].next; halfEdges[he].next != first; he = halfEdges[he].next)
+				sum += glm::cross(vertices[halfEdges[he].vertex].pos - p1, vertices[halfEdges[halfEdges[he].next].vertex].pos - p1);
+			if(glm::dot(sum, faces[f].normal) < 0)
+				sum = -sum;
+		}
+		weightedNormals[f] = sum;
+	});
+
+	// Every half-edge is one corner of its face, at the vertex it points to, so each vertex's normal is the sum over the half-edges
+	// pointing to it. Sorting the corners by vertex first (a counting sort, which keeps them in half-edge order within a vertex)
+	// lets each vertex add up just its own, with nothing written by two threads and no locking - and in the same order however many
+	// threads there are, so the normals don't depend on that.
+	// Vertex v's corners (the faces they belong to) are cornerFaces[firstCorner[v] ... firstCorner[v + 1] - 1]
+	std::vector<Index> firstCorner(vertices.size() + 1, 0);
+	for(size_t h = 0; h < halfEdges.size(); h++)
+		if(halfEdges[h].face != NONE)
+			firstCorner[halfEdges[h].vertex + 1]++;
+	for(size_t v = 0; v < vertices.size(); v++)
+		firstCorner[v + 1] += firstCorner[v];
+	std::vector<Index> cornerFaces(firstCorner[vertices.size()]);
+	std::vector<Index> nextCorner(firstCorner.begin(), firstCorner.end() - 1);
+	for(size_t h = 0; h < halfEdges.size(); h++)
+		if(halfEdges[h].face != NONE)
+			cornerFaces[nextCorner[halfEdges[h].vertex]++] = halfEdges[h].face;
+
+	normals.resize(vertices.size());
+	parallelFor(0, normals.size(), [&](size_t v) {
+		vec3 sum(0, 0, 0);
+		for(Index c = firstCorner[v]; c < firstCorner[v + 1]; c++)
+			sum += weightedNormals[cornerFaces[c]];
+		float length = glm::length(sum);
+		normals[v] = (length > 0) ? sum / length : sum;
+	});
+}
+
+void Mesh::setIndexedTriangles(std::vector<vec3> &positions, std::vector<vec3> &normals, std::vector<unsigned> &indices)
 {
-	// Find halfedges pointing to p1 and p2
-	HalfEdge *he_p1 = p1->halfEdge;
-	while(he_p1->vertex != p1)
-		he_p1 = he_p1->next;
-	HalfEdge *he_p2 = he_p1;
-	while(he_p2->vertex != p2)
-		he_p2 = he_p2->next;
-
-	// Create two new halfedges on the split line
-	int he1 = addHalfEdge(p2, he_p2->next, 0, 0);
-	int he2 = addHalfEdge(p1, he_p1->next, 0, 0);
-	HalfEdge *pHE1 = getHalfEdge(he1);
-	HalfEdge *pHE2 = getHalfEdge(he2);
-
-	// Create a new face
-	int newFace = addFace(pHE1, f->normal);
-	Face *pNewFace = getFace(newFace);
-
-	// Point he1 to the new face, and he2 to the old one
-	pHE1->face = pNewFace;
-	pHE2->face = f;
-	// Point the new face to he1, and the old face to he2
-	pNewFace->halfEdge = pHE1;
-	f->halfEdge = pHE2;
-
-	// Point p1 to he1 and p2 to he2
-	p1->halfEdge = pHE1;
-	p2->halfEdge = pHE2;
+	faces.clear();
+	vertices.clear();
+	halfEdges.clear();
+
+	Mesh::positions.swap(positions);
+	Mesh::normals.swap(normals);
+	Mesh::indices.swap(indices);
+	indexed = true;
+	trianglesBuilt = false;
+}
+
+void Mesh::buildHalfEdges()
+{
+	if(!indexed)
+		return;
+
+	faces.clear();
+	vertices.clear();
+	halfEdges.clear();
+	reserve(indices.size() / 3, positions.size(), indices.size());
+
+	// Vertices in the same place are one vertex as far as the surface is concerned (a mesh may be laid out with several there, to
+	// give the triangles that meet there different normals, e.g. along a crease), so each group is merged into its first vertex.
+	// Sorting the vertices by position - stably, so each group's first comes first - lines the groups up.
+	std::vector<Index> byPosition(positions.size());
+	for(size_t i = 0; i < positions.size(); i++)
+		byPosition[i] = i;
+	std::stable_sort(byPosition.begin(), byPosition.end(), [&](Index a, Index b) {
+		const vec3 &p = positions[a], &q = positions[b];
+		return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+	});
+	std::vector<Index> mergedInto(positions.size());
+	for(size_t i = 0; i < byPosition.size(); i++)
+	{
+		bool repeat = i > 0 && positions[byPosition[i]] == positions[byPosition[i - 1]];
+		mergedInto[byPosition[i]] = repeat ? mergedInto[byPosition[i - 1]] : byPosition[i];
+	}
+	std::vector<Index> vertexOf(positions.size());
+	for(size_t i = 0; i < positions.size(); i++)
+	{
+		if(mergedInto[i] != i)
+			vertexOf[i] = vertexOf[mergedInto[i]]; // (which comes before it, so it's been numbered)
+		else
+		{
+			vertexOf[i] = vertices.size();
+			vertices.push_back(Vertex(NONE, positions[i]));
+		}
+	}
+
+	// The triangles' corners as those vertices, leaving out any triangle that merging has left with fewer than three
+	std::vector<unsigned> corners;
+	corners.reserve(indices.size());
+	for(size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned a = vertexOf[indices[i]], b = vertexOf[indices[i + 1]], c = vertexOf[indices[i + 2]];
+		if(a == b || b == c || c == a)
+			continue;
+		corners.push_back(a);
+		corners.push_back(b);
+		corners.push_back(c);
+	}
+
+	// Triangle t is face t, with half-edges 3t, 3t + 1, 3t + 2 pointing to its corners after the first in turn (so 3t + 2 points
+	// back to the first)
+	size_t numTriangles = corners.size() / 3;
+	for(size_t t = 0; t < numTriangles; t++)
+	{
+		const unsigned *corner = &corners[3*t];
+		vec3 normal = glm::cross(vertices[corner[1]].pos - vertices[corner[0]].pos, vertices[corner[2]].pos - vertices[corner[0]].pos);
+		float length = glm::length(normal);
+		faces.push_back(Face(3*t, (length > 0) ? normal / length : normal));
+		for(int c = 0; c < 3; c++)
+		{
+			Index he = addHalfEdge(corner[(c + 1) % 3], 3*t + (c + 1) % 3, NONE, t);
+			vertices[corner[(c + 1) % 3]].halfEdge = he;
+		}
+	}
+
+	// The sym of the half-edge from a to b is the one from b to a. Sorting the half-edges by (from, to) puts each one's sym where a
+	// binary search for (to, from) finds it. (Half-edge h comes from the corner before the one it points to, which is corners[h].)
+	// An edge that more than two triangles share is left without syms, as if it were on a boundary, since there's no telling
+	// which of them are meant to be neighbors.
+	typedef std::pair<unsigned long long, Index> EdgeKey;
+	std::vector<EdgeKey> edges(halfEdges.size());
+	parallelFor(0, halfEdges.size(), [&](size_t h) {
+		unsigned long long from = corners[h], to = halfEdges[h].vertex;
+		edges[h] = EdgeKey(from << 32 | to, (Index)h);
+	});
+	std::sort(edges.begin(), edges.end());
+	parallelFor(0, edges.size(), [&](size_t i) {
+		unsigned long long key = edges[i].first;
+		if((i > 0 && edges[i - 1].first == key) || (i + 1 < edges.size() && edges[i + 1].first == key))
+			return; // more than one half-edge from a to b
+		unsigned long long symKey = (key & 0xFFFFFFFF) << 32 | key >> 32;
+		std::vector<EdgeKey>::const_iterator sym = std::lower_bound(edges.begin(), edges.end(), EdgeKey(symKey, 0));
+		if(sym != edges.end() && sym->first == symKey && (sym + 1 == edges.end() || (sym + 1)->first != symKey))
+			halfEdges[edges[i].second].sym = sym->second;
+	});
+
+	positions.clear();
+	normals.clear();
+	indexed = false;
+	trianglesBuilt = false;
+}
+
+Mesh::Index Mesh::getPreviousHalfEdge(Index he)
+{
+	Index current = he;
+	while(halfEdges[current].next != he) // loop until we've gone around to the halfedge before the halfedge we started at
+		current = halfEdges[current].next;
+	return current;
+}
+
+Mesh::Index Mesh::splitFace(Index f, Index p1, Index p2)
+{
+	// Find halfedges pointing to p1 and p2 (on this face - p1 and p2 are on others too)
+	Index he_p1 = faces[f].halfEdge;
+	while(halfEdges[he_p1].vertex != p1)
+		he_p1 = halfEdges[he_p1].next;
+	Index he_p2 = he_p1;
+	while(halfEdges[he_p2].vertex != p2)
+		he_p2 = halfEdges[he_p2].next;
+
+	// Create two new halfedges on the split line (symmetric to each other), and a new face for the first one;
+	// the second stays on the old face
+	Index he1 = halfEdges.size();
+	Index he2 = he1 + 1;
+	Index newFace = addFace(he1, faces[f].normal);
+	addHalfEdge(p2, halfEdges[he_p2].next, he2, newFace);
+	addHalfEdge(p1, halfEdges[he_p1].next, he1, f);
+
+	// Point the old face to he2
+	faces[f].halfEdge = he2;
+
+	// Point p1 to he2 and p2 to he1 (the new halfedges pointing to them)
+	vertices[p1].halfEdge = he2;
+	vertices[p2].halfEdge = he1;
 
 	// Fix the next pointers for he_p1 and he_p2
-	he_p1->next = pHE1;
-	he_p2->next = pHE2;
+	halfEdges[he_p1].next = he1;
+	halfEdges[he_p2].next = he2;
 
-	// he1 and he2 are symmetric to each other
-	pHE1->sym = pHE2;
-	pHE2->sym = pHE1;
+	// The rest of the halfedges around the new face still think they're on the old one
+	for(Index he = halfEdges[he1].next; he != he1; he = halfEdges[he].next)
+		halfEdges[he].face = newFace;
 
-	// We *should* be done now (assuming I remembered all the pointers! :-)) - return the index of the new face
+	// Return the index of the new face
 	return newFace;
 }
 
 void Mesh::triangulateAllFaces()
 {
-	for(int i = 0; i < faces.size(); i++)
+	// Each split of an n-gon adds a face and two half-edges, and it takes n - 3 of them to triangulate it - make room for all of them
+	// up front
+	size_t numSplits = 0;
+	for(size_t i = 0; i < faces.size(); i++)
 	{
-		// Pick a vertex on the face to "fan out" from
-		Vertex *fanVert = faces[i].halfEdge->vertex;
-		HalfEdge *he = faces[i].halfEdge->next->next;
-		do // loop over all vertices except the one we just picked, and the one right next to it
-		{
-			splitFace(&faces[i], fanVert, he->vertex);
-		} while(he->next != faces[i].halfEdge);
+		if(faces[i].halfEdge == NONE)
+			continue;
+		size_t numEdges = 1;
+		for(Index he = halfEdges[faces[i].halfEdge].next; he != faces[i].halfEdge; he = halfEdges[he].next)
+			numEdges++;
+		if(numEdges > 3)
+			numSplits += numEdges - 3;
 	}
-}
+	reserve(faces.size() + numSplits, vertices.size(), halfEdges.size() + 2 * numSplits);
 
-Mesh::Vertex Mesh::getCenterPoint(Face* face)
-{
-	std::vector<vec3> positions;
-			
-	HalfEdge *he = face->halfEdge;
-	do
+	// Each split cuts a triangle off of the face and puts the rest in a new face at the end of faces, which gets split in turn
+	// when the loop gets to it
+	for(size_t i = 0; i < faces.size(); i++)
 	{
-		positions.push_back(he->vertex->pos);
-	} while(he != face->halfEdge); // loop until we've gone around to the halfedge we started at
-	Vertex newVertex(he, vec3(0,0,0));
-	for (int j = 0; j < positions.size(); j++) {
-		newVertex.pos.x += positions[j].x;
-		newVertex.pos.y += positions[j].y;
-		newVertex.pos.z += positions[j].z;
+		Index he = faces[i].halfEdge;
+		if(he == NONE || halfEdges[halfEdges[halfEdges[he].next].next].next == he)
+			continue; // deleted, or already a triangle
+
+		// Cut off the triangle between a vertex and the vertex two along from it
+		splitFace(i, halfEdges[he].vertex, halfEdges[halfEdges[halfEdges[he].next].next].vertex);
 	}
-	newVertex.pos /= positions.size();
-	return newVertex;
 }
 
 void Mesh::fillIndexBuffer(std::vector<unsigned> &indexBuffer)
 {
 	// For original pseudocode, see notes: "[2014-04-07] Subdivision.pptx", slide 18
 
+	if(indexed)
+	{
+		indexBuffer = indices;
+		return;
+	}
 	indexBuffer.clear();
 
-	// For each face, get a halfedge associated with it, and traverse he.next to determine all the vertices for the face
-	for(int i = 0; i < faces.size(); i++)
+	// For each face, get a halfedge associated with it, and traverse he.next to determine all the vertices for the face, fanning
+	// them out from the first one into triangles (faces are usually triangles already, unless the mesh has been subdivided)
+	for(size_t i = 0; i < faces.size(); i++)
 	{
-		HalfEdge *he = faces[i].halfEdge;
-		do
+		Index first = faces[i].halfEdge;
+		if(first == NONE)
+			continue; // deleted
+
+		for(Index he = halfEdges[first].next; halfEdges[he].next != first; he = halfEdges[he].next)
 		{
-			indexBuffer.push_back(he->vertex->internalIndex);
-			he = he->next;
-		} while(he != faces[i].halfEdge); // loop until we've gone around to the halfedge we started at
+			indexBuffer.push_back(halfEdges[first].vertex);
+			indexBuffer.push_back(halfEdges[he].vertex);
+			indexBuffer.push_back(halfEdges[halfEdges[he].next].vertex);
+		}
 	}
 }
 
@@ -143,16 +321,21 @@ void Mesh::bufferData(AttribLocations attribs)
 		glDeleteBuffers(1, &ibo);
 	}
 
-	// Create "raw data" buffers based on the data stored in our half-edge structure
-	std::vector<vec3> positions;
-	for(int i = 0; i < vertices.size(); i++)
-		positions.push_back(vertices[i].pos);
+	// Create "raw data" buffers based on the data stored in our half-edge structure (an indexed mesh has them already)
+	std::vector<vec3> vertexPositions, vertexNormals;
+	if(!indexed)
+	{
+		vertexPositions.reserve(vertices.size());
+		for(size_t i = 0; i < vertices.size(); i++)
+			vertexPositions.push_back(vertices[i].pos);
 
-	std::vector<vec3> normals;
-	for(int i = 0; i < vertices.size(); i++)
-		normals.push_back(vertices[i].getNormal());
+		computeVertexNormals(vertexNormals);
 
-	fillIndexBuffer(indices); // note: fillIndexBuffer() automatically clears anything previously left in indices, which is what we want
+		fillIndexBuffer(indices); // note: fillIndexBuffer() automatically clears anything previously left in indices, which is what we want
+	}
+	const std::vector<vec3> &positions = indexed ? Mesh::positions : vertexPositions;
+	const std::vector<vec3> &normals = indexed ? Mesh::normals : vertexNormals;
+	buildTriangles();
 
 	// Generate and fill new buffers
 	glGenBuffers(1, &vbo);
@@ -200,244 +383,350 @@ void Mesh::draw(mat4 transform)
 
 float Mesh::getUnitHeight()
 {
-	if(vertices.size() < 1)
+	size_t numVertices = indexed ? positions.size() : vertices.size();
+	if(numVertices < 1)
 		return 0.0f;
 
-	float maxY = vertices[0].pos.y;
-	float minY = vertices[0].pos.y;
+	float maxY = indexed ? positions[0].y : vertices[0].pos.y;
+	float minY = maxY;
 
-	for(int i = 1; i < vertices.size(); i++)
+	for(size_t i = 1; i < numVertices; i++)
 	{
-		if(vertices[i].pos.y > maxY)
-			maxY = vertices[i].pos.y;
-		if(vertices[i].pos.y < minY)
-			minY = vertices[i].pos.y;
+		float y = indexed ? positions[i].y : vertices[i].pos.y;
+		if(y > maxY)
+			maxY = y;
+		if(y < minY)
+			minY = y;
 	}
 
 	return maxY - minY;
 }
 
-void Mesh::subDivide()
+void Mesh::exportTriangles(TriangleBatch &triangles, std::vector<AABB> *bounds) const
 {
-	Mesh newMesh = *this; // Maybe have to write a copy constructor for this to work as we would like
-		
-	//All vertices that were in the original mesh are stored in the oldVertices vector
-	//to give us a reference for what vertices will be moved later on
-	std::vector<Vertex*> oldVertices;
-	for (int i = 0; i < newMesh.halfEdges.size(); i++) 
-		oldVertices.push_back(newMesh.halfEdges[i].vertex);
-		
-	//This will be filled as new vertices are created so that we can ensure that these vertices are pointing 
-	//to the correct half-edge at the end.
-	//std::vector<Vertex*> newVertices;
-
-	/* Next we find the center points of each face by averaging the positions of all the vertices 
-		that make up the face. Store that center vertex as a temporary member of the face. */
-	for (int i = 0; i < newMesh.faces.size(); i++) {
-		Face* currentFace = &newMesh.faces[i];
-		Vertex centerVertex = getCenterPoint(currentFace);
-		currentFace->centerPoint = &centerVertex;
-		/********** I foresee a problem with centerPoint being added to the vertex but then going out of scope
-		so now the vector just sees a junk vertex.
-		*/
+	// A face with n sides fans out into n - 2 triangles, so there are at most this many (fewer if any faces have been deleted)
+	size_t maxTriangles = indexed ? indices.size() / 3 : halfEdges.size() > 2*faces.size() ? halfEdges.size() - 2*faces.size() : 0;
+	triangles.clear();
+	triangles.reserve((int)maxTriangles);
+	if(bounds)
+	{
+		bounds->clear();
+		bounds->reserve(maxTriangles);
 	}
 
-	/* Next create all new vertices that will lay on the current edges.
-		These vertices are given a position (obviously), and a halfEdge. The halfedge that the vertex
-		points to is the halfedge that it lies on. The halfEdge that the vertex lies on also is given
-		a temporary pointer to that vertex as well.
-	*/
-	/***********	 NOTE: Remember to change the new vertices to contain a pointer to the halfedge 
-		= halfedge->next->sym (where halfedge is the original halfedge that pointed to the vertex)
-	**/
-	for (int i = 0; i < newMesh.halfEdges.size(); i++) {
-		Vertex edgeVertex;
-		if (newMesh.halfEdges[i].halfVertex != NULL || newMesh.halfEdges[i].sym->halfVertex != NULL) continue; //if the half edge already has a vertex there.
-			
-		/************If Sym can never be null, then there will always be 4 points at the center of a face (Erase the else)**/
-		if (halfEdges[i].sym != NULL) { 
-			//average vertices on all four sides of half edge
-			Vertex v1 = *newMesh.halfEdges[i].vertex;
-			Vertex v2 = *getPreviousVertex(&newMesh.halfEdges[i]);
-			Vertex v3 = *newMesh.halfEdges[i].face->centerPoint;
-			Vertex v4 = *newMesh.halfEdges[i].sym->face->centerPoint;
-			edgeVertex.pos = (v1.pos + v2.pos + v3.pos + v4.pos) / 4.0f;
-
-		//MIGHT NOT NEED THIS ELSE IF THERE WILL NEVER BE A NULL "SYM"
-		}else { //outer half edge
-			//Only use vertices on either side of the halfedge
-			Vertex v1 = *newMesh.halfEdges[i].vertex;
-			Vertex v2 = *getPreviousVertex(&newMesh.halfEdges[i]);	
-			edgeVertex.pos = (v1.pos + v2.pos)/2.0f;
-		}
-		//A vertex needs to store a position and a halfEdge
-		edgeVertex.halfEdge = &newMesh.halfEdges[i]; //add a halfedge to the vertex
-		newMesh.halfEdges[i].halfVertex = &edgeVertex; //add the vertex to the halfedge (temporarily)
-		newMesh.halfEdges[i].sym->halfVertex = &edgeVertex; //add the vertex to the halfedge's sym (temporarily)
-
-		//store the two faces for this in the face's newVertices vector
-		edgeVertex.halfEdge->face->newVertices.push_back(&edgeVertex);
-		edgeVertex.halfEdge->sym->face->newVertices.push_back(&edgeVertex);
-			
-		//how do i set it for a face, when we're looping through half edges?
-		/****** I foresee a problem with adding edgeVertex to the vector and then it going out of scope so
-		the vector is left pointing at a junk vertex.
-		*/
-	}
+	for(size_t i = 0; indexed && i < maxTriangles; i++)
+	{
+		const vec3 &p1 = positions[indices[3*i]], &p2 = positions[indices[3*i + 1]], &p3 = positions[indices[3*i + 2]];
+		triangles.add(buildTriangle(p1, p2, p3), (unsigned)i);
 
-	/* Next create the halfedges that will border the existing faces (Halfedges that go from the original 
-		vertices to the edge half-vertices). In this step, no halfedges will be created that go from the center 
-		of the face out to the edges. That comes later (after creating the faces).
-	*/
-	for (int i = 0; i < newMesh.faces.size(); i++) {
-		HalfEdge* firstHe = newMesh.faces[i].halfEdge;
-
-		//For each halfedge around the face.
-		for (HalfEdge* originalHe = firstHe; originalHe->next != firstHe; originalHe = originalHe->next) {
-			HalfEdge newHalfEdge = *originalHe; //Create halfedge identical to this halfedge
-			//add it to newMesh
-			newMesh.halfEdges.push_back(newHalfEdge);
-			newHalfEdge.halfVertex = NULL; //clear the new halfedge's halfvertex. Only the original needs it.
-			//I foresee a problem with this HE going out of scope and so all the information is borked.
-
-			//Update all the original half-edge data members to reference the new halfedge that is placed in 
-			//	front of it.
-			originalHe->vertex->halfEdge = &newHalfEdge;
-			originalHe->vertex = originalHe->halfVertex;
-			originalHe->halfVertex = NULL;
-			originalHe->next = &newHalfEdge;
-			originalHe->sym = originalHe->next->sym->next; 
-			originalHe->face = originalHe->face; //Keep the same for now.
+		if(bounds)
+		{
+			AABB triangleBounds;
+			triangleBounds.expand(p1);
+			triangleBounds.expand(p2);
+			triangleBounds.expand(p3);
+			bounds->push_back(triangleBounds);
 		}
 	}
 
+	// Fan each face out from its first vertex (faces are usually triangles already, in which case this is just the one)
+	for(size_t i = 0; !indexed && i < faces.size(); i++)
+	{
+		Index first = faces[i].halfEdge;
+		if(first == NONE)
+			continue; // deleted
 
-	/* Next create all the new faces that will be inside the original face. These faces will take the place
-	of the one big face. At the end of this, make sure to set the originalFace->centerPoint equal to NULL.
-	Don't forget to add a normal equal to the normal of the original face as well.
-	Also set newVertices to null for all faces
-	*/
-	/***********	 NOTE: Remember to change the new vertices to contain a pointer to the halfedge 
-		= halfedge->next->sym (where halfedge is the original halfedge that pointed to the vertex)
-	**/
-	std::vector<Face*> newFaces;
-
-	for (int i = 0; i < newMesh.faces.size(); i++) {
-			
-		//first create vector of new faces
-		for(int j=0; j<newMesh.faces[i].newVertices.size(); j++)
+		const vec3 &p1 = vertices[halfEdges[first].vertex].pos;
+		for(Index he = halfEdges[first].next; halfEdges[he].next != first; he = halfEdges[he].next)
 		{
-			Face* face;
-			newFaces.push_back(face);
+			const vec3 &p2 = vertices[halfEdges[he].vertex].pos;
+			const vec3 &p3 = vertices[halfEdges[halfEdges[he].next].vertex].pos;
+			triangles.add(buildTriangle(p1, p2, p3), (unsigned)i);
+
+			if(bounds)
+			{
+				AABB triangleBounds;
+				triangleBounds.expand(p1);
+				triangleBounds.expand(p2);
+				triangleBounds.expand(p3);
+				bounds->push_back(triangleBounds);
+			}
 		}
+	}
+}
 
-		//first set the first HE you start at to point to face 1 (newFaces[0]) in the newFaces vec
-		newMesh.faces[i].halfEdge->face = newFaces[0];
-		//set newFaces[0]'s HE to this first HE
-		newFaces[0]->halfEdge = newMesh.faces[i].halfEdge;
-		HalfEdge* firstHe = newMesh.faces[i].halfEdge;
-		HalfEdge* iterator = newMesh.faces[i].halfEdge;
-		for(int j=1; j<newMesh.faces[i].newVertices.size(); j++)
+void Mesh::buildTriangles()
+{
+	std::vector<AABB> triangleBounds;
+	exportTriangles(triangles, &triangleBounds);
+	triangleBVH.build(triangleBounds);
+
+	// The vertex normals at each triangle's corners, for shading. An indexed mesh's triangles have their corners' normals right there;
+	// otherwise, exportTriangles() fans each face out in order starting from its first half-edge, so the triangles from each face are
+	// together, and the k-th one has corners at the face's first vertex and the k-th and (k + 1)-th after it.
+	std::vector<vec3> vertexNormals;
+	if(!indexed)
+		computeVertexNormals(vertexNormals);
+	std::vector<vec3> normalsInFaceOrder(3 * triangles.size());
+	for(int i = 0; indexed && i < triangles.size(); i++)
+	{
+		for(int c = 0; c < 3; c++)
 		{
-			//go to next HE, set face to newFaces[i]
-			iterator = iterator->next;
-			iterator->face = newFaces[i];
-			//go to next HE, set face to newFaces[i]
-			iterator = iterator->next;
-			iterator->face = newFaces[i];
-			//set newFaces[i]'s HE to this HE
-			newFaces[i]->halfEdge = iterator;
-			newFaces[i]->normal = newMesh.faces[i].normal;
-			newFaces[i]->centerPoint = NULL;
+			vec3 normal = normals[indices[3*i + c]];
+			normalsInFaceOrder[3*i + c] = (normal == vec3(0, 0, 0)) ? triangles.getNormal(i) : normal;
 		}
-		//set last one to face 1 -- the next one should now be the first one
-		iterator = iterator->next;
-		iterator->face = newFaces[0];
-		
-		
-		//NOW WE WILL CREATE THE NEW HE's for this face that are between the center point and the new vertices
-		//temp vector of HE's that point out from middle to be used for connecting "nexts"
-		std::vector<HalfEdge*> outwardHEs;
-		std::vector<HalfEdge*> inwardHEs;
-		for(int j = 0; j < newMesh.faces[i].newVertices.size(); j++) {
-			//he1 and he2 are down and up
-			HalfEdge he1(newMesh.faces[i].centerPoint, NULL, NULL, newFaces[j]); //face to the left -- NOT SURE IF THIS IS RIGHT FACE -- now face to the right.....now clap your hands
-			HalfEdge he2(newMesh.faces[i].newVertices[j], NULL, &he1, newFaces[(j+1)%newMesh.faces[i].newVertices.size()]);//face to the right
-			newMesh.faces[i].newVertices[j]->halfEdge = &he2;
-			//add them to newMesh
-			newMesh.halfEdges.push_back(he1);
-			newMesh.halfEdges.push_back(he2);
-			outwardHEs.push_back(&he2);
-			inwardHEs.push_back(&he1);
-			he1.sym = &he2;
-			//loop through all outer HE, comparing their "vertex" to newVertices[j]
-			//he2.next will equal THAT one's next
-			for (HalfEdge* originalHe = firstHe; originalHe->next != firstHe; originalHe = originalHe->next) {
-				if(newMesh.faces[i].halfEdge->vertex == newMesh.faces[i].newVertices[j])
-					he2.next = newMesh.faces[i].halfEdge->next;
-				//else major error
-			}
-
-			//for all the new faces, set the remaining unconnected "next" HE to be connected
-			//This assumes that the first halfedge of a face matches up with the first item in the inwardHEs.
-			for(int k=0; k<newFaces.size(); k++)
+	}
+	for(int i = 0; !indexed && i < triangles.size(); )
+	{
+		const Face &face = faces[triangles.getFaceId(i)];
+		Index first = face.halfEdge;
+		for(Index he = halfEdges[first].next; halfEdges[he].next != first; he = halfEdges[he].next, i++)
+		{
+			Index corners[3] = {halfEdges[first].vertex, halfEdges[he].vertex, halfEdges[halfEdges[he].next].vertex};
+			for(int c = 0; c < 3; c++)
 			{
-				newFaces[i]->halfEdge->next = inwardHEs[i];
+				// Fall back on the triangle's own normal if the vertex doesn't have one
+				vec3 normal = vertexNormals[corners[c]];
+				normalsInFaceOrder[3*i + c] = (normal == vec3(0, 0, 0)) ? triangles.getNormal(i) : normal;
 			}
-					
-			int temp = j;
-			if((temp-1) < 0) temp = newMesh.faces[i].newVertices.size()-1;
-			he1.next = outwardHEs[temp];
-			newMesh.faces[i].centerPoint->halfEdge = &he1;
 		}
 	}
 
-	
-	/*
-	By this point, the mesh should be in a state where it has been completely subdivided. All new vertices 
-	have been added, all new halfedges have been added, all new faces have been added.
-	*/
-
-	/*
-	Next, move all original vertices. Do this by looping through the vector of original vertices, 
-		and move their positions to the average of the four surrounding vertices. The four surrounding vertices
-		are the vertices that were created in the center of the edge during this CC iteration.
-	*/
-	for (int i = 0; i < oldVertices.size(); i++) {
-		Vertex* vert = oldVertices[i];
-
-		Vertex v1 = *getPreviousVertex(vert->halfEdge);					//Beneath
-		Vertex v2 = *vert->halfEdge->next->vertex;						//Right
-		Vertex v3 = *vert->halfEdge->next->sym->next->vertex;			//Up
-		Vertex v4 = *vert->halfEdge->next->sym->next->sym->next->vertex;//Left
-			
-		vec3 newPos = (v1.pos+v2.pos+v3.pos+v4.pos)/4.0f;
-		vert->pos = newPos;
+	// Put the triangles in the BVH's order, so the ones each leaf tests are next to each other in memory
+	const std::vector<int> &order = triangleBVH.getPrimitiveOrder();
+	TriangleBatch ordered;
+	ordered.resize(triangles.size());
+	cornerNormals.resize(3 * triangles.size());
+	for(int i = 0; i < triangles.size(); i++)
+	{
+		ordered.set(i, triangles.getTriangle(order[i]), triangles.getFaceId(order[i]));
+		for(int c = 0; c < 3; c++)
+			cornerNormals[3*i + c] = normalsInFaceOrder[3*order[i] + c];
 	}
+	triangles.swap(ordered);
+	triangleBVH.renumberPrimitives();
 
+	trianglesBuilt = true;
+}
 
-	//LEFT TO UPDATE IN NEWMESH:
-	//faces, as well as their normals, halfEdge, centerPoint -- DONE
-	//vertices, as well as their pos, halfEdge -- DONE
-	//halfEdges, as well as their vertex, next, sym, face, halfVertex -- not sure
+double Mesh::intersect(const Ray &ray)
+{
+	double t = -1;
+	triangleBVH.closestHit(ray, t, [&](int i) -> double {
+		return rayTriangleIntersect(ray, triangles, i);
+	});
+	return t;
+}
 
+double Mesh::intersect(const Ray &ray, vec3 &normal)
+{
+	vec3 faceNormal;
+	return intersect(ray, normal, faceNormal);
+}
 
-	//update newMesh's faces
-	newMesh.faces.clear();
-	for(int i=0; i<newFaces.size(); i++)
+double Mesh::intersect(const Ray &ray, vec3 &normal, vec3 &faceNormal)
+{
+	double t = -1;
+	int triangle = triangleBVH.closestHit(ray, t, [&](int i) -> double {
+		return rayTriangleIntersect(ray, triangles, i);
+	});
+	if(triangle >= 0)
 	{
-		newMesh.faces.push_back(*newFaces[i]);
+		// Smooth shading: blend the corners' vertex normals, just as the rasterizer does with the normals bufferData() sends it
+		float u, v;
+		getTriangleBarycentrics(ray, triangles, triangle, u, v);
+		const vec3 *corners = &cornerNormals[3*triangle];
+		normal = (1 - u - v) * corners[0] + u * corners[1] + v * corners[2];
+		faceNormal = triangles.getNormal(triangle);
 	}
+	return t;
+}
+
+void Mesh::intersect(RayPacket &packet)
+{
+	triangleBVH.closestHits(packet, [&](int i, const int *rays, int numRays) {
+		for(int j = 0; j < numRays; j++)
+		{
+			double t = rayTriangleIntersect(packet.origin, packet.getDirection(rays[j]), triangles, i);
+			if(t >= 0)
+				packet.recordHit(rays[j], t, i);
+		}
+	});
+}
+
+void Mesh::getBounds(vec3 &boundsMin, vec3 &boundsMax)
+{
+	if(!trianglesBuilt)
+		buildTriangles();
+
+	AABB bounds = triangleBVH.getBounds();
+	boundsMin = bounds.pMin;
+	boundsMax = bounds.pMax;
+}
+
+void Mesh::getTriangles(TriangleBatch &triangles, std::vector<vec3> &cornerNormals)
+{
+	if(!trianglesBuilt)
+		buildTriangles();
+
+	triangles = Mesh::triangles;
+	cornerNormals = Mesh::cornerNormals;
+}
+
+void Mesh::subDivide(int levels)
+{
+	if(levels > 0)
+		buildHalfEdges();
+	for(int i = 0; i < levels; i++)
+		subDivideOnce();
+}
 
-	//update newMesh's vertices
-	//run through all OLD faces, getting the "newVertices" AND centerPoint for that face and adding that to newMesh's vertices along with old vertices...?
-	for(int i=0; i<this->faces.size(); i++)
+void Mesh::subDivideOnce()
+{
+	// The new level has:
+	//	* A vertex for each old vertex (moved to its vertex point), in the same place in the array, then a face point for each old
+	//	  face, then an edge point for each old edge (pair of half-edges, or lone half-edge on a boundary).
+	//	* A quad for each old half-edge h, at the corner h points to: h's edge point, h's vertex, the next half-edge's edge point,
+	//	  and the face point. Quad h is made of new half-edges 4h..4h+3, in that order (4h points to h's edge point, and so on
+	//	  around to 4h+3, which points to the face point).
+	// So quad h covers the second half of edge h (4h+1) and the first half of edge next(h) (4h+2); that tells us all the syms.
+	size_t numOldVertices = vertices.size(), numOldFaces = faces.size(), numOldHalfEdges = halfEdges.size();
+
+	// Each half-edge's predecessor on its face
+	std::vector<Index> prev(numOldHalfEdges, NONE);
+	parallelFor(0, numOldHalfEdges, [&](size_t h) {
+		prev[halfEdges[h].next] = h;
+	});
+
+	// Number the edges: the lower-numbered half-edge of each pair owns the edge (this is a running count, so it's not worth
+	// splitting up)
+	std::vector<Index> edgeOf(numOldHalfEdges);
+	Index numEdges = 0;
+	for(size_t h = 0; h < numOldHalfEdges; h++)
 	{
-		for(int j=0; j<this->faces[i].newVertices.size(); j++)
-			newMesh.vertices.push_back(*this->faces[i].newVertices[j]);
-		newMesh.vertices.push_back(*this->faces[i].centerPoint);
+		Index sym = halfEdges[h].sym;
+		edgeOf[h] = (sym == NONE || h < sym) ? numEdges++ : edgeOf[sym];
 	}
+	Index firstFacePoint = numOldVertices;
+	Index firstEdgePoint = firstFacePoint + numOldFaces;
+
+	std::vector<Vertex> newVertices(firstEdgePoint + numEdges, Vertex(NONE, vec3(0,0,0)));
+	std::vector<Face> newFaces(numOldHalfEdges, Face(NONE, vec3(0,0,0)));
+	std::vector<HalfEdge> newHalfEdges(4 * numOldHalfEdges, HalfEdge(NONE, NONE, NONE, NONE));
+
+	// Face points: the average of each face's vertices
+	parallelFor(0, numOldFaces, [&](size_t f) {
+		Index first = faces[f].halfEdge;
+		if(first == NONE)
+			return; // deleted
+		vec3 sum(0,0,0);
+		int n = 0;
+		Index he = first;
+		do
+		{
+			sum += vertices[halfEdges[he].vertex].pos;
+			n++;
+			he = halfEdges[he].next;
+		} while(he != first);
+		newVertices[firstFacePoint + f] = Vertex(4 * first + 3, sum / (float)n);
+	}, 1024);
+
+	// Edge points: the average of the edge's two ends and the face points on either side, or just the midpoint on a boundary
+	parallelFor(0, numOldHalfEdges, [&](size_t h) {
+		Index sym = halfEdges[h].sym;
+		if(sym != NONE && sym < h)
+			return; // the other half-edge does this edge
+		vec3 end = vertices[halfEdges[h].vertex].pos;
+		vec3 start = vertices[halfEdges[prev[h]].vertex].pos;
+		vec3 pos;
+		if(sym == NONE)
+			pos = (start + end) * 0.5f;
+		else
+			pos = (start + end + newVertices[firstFacePoint + halfEdges[h].face].pos + newVertices[firstFacePoint + halfEdges[sym].face].pos) * 0.25f;
+		newVertices[firstEdgePoint + edgeOf[h]] = Vertex(4 * h, pos);
+	});
+
+	// Vertex points. Going around an interior vertex P of valence n, with Q the average of the face points around it and R the
+	// average of the midpoints of the edges leaving it, the vertex point is (Q + 2R + (n - 3)P) / n. A vertex on the boundary of the
+	// mesh only follows the boundary instead: it goes to 3/4 P plus 1/8 of each of its two neighbors along the boundary.
+	parallelFor(0, numOldVertices, [&](size_t v) {
+		vec3 P = vertices[v].pos;
+		Index first = vertices[v].halfEdge;
+		if(first == NONE)
+		{
+			newVertices[v] = Vertex(NONE, P); // not on any face
+			return;
+		}
 
-	//Finally, overwrite THIS mesh to be equal to the mesh that we just created!
-	*this = newMesh; 
-}
\ No newline at end of file
+		// Walk around the vertex (each step goes from a half-edge pointing to it, to the next one, one face over), adding up the face
+		// points and the far ends of the edges leaving it. (As in getVertexNormal(), we can't take more steps than there are half-edges.)
+		vec3 sumFaces(0,0,0), sumEnds(0,0,0);
+		int n = 0;
+		Index he = first, out;
+		do
+		{
+			sumFaces += newVertices[firstFacePoint + halfEdges[he].face].pos;
+			out = halfEdges[he].next;
+			sumEnds += vertices[halfEdges[out].vertex].pos;
+			n++;
+			he = halfEdges[out].sym;
+		} while(he != NONE && he != first && n < (int)numOldHalfEdges);
+
+		vec3 pos;
+		if(he == NONE)
+		{
+			// We ran into the boundary going out along out; walk back the other way from where we started to find the boundary edge
+			// coming in
+			Index in = first;
+			for(int steps = 0; halfEdges[in].sym != NONE && steps < (int)numOldHalfEdges; steps++)
+				in = prev[halfEdges[in].sym];
+			vec3 ahead = vertices[halfEdges[out].vertex].pos;
+			vec3 behind = vertices[halfEdges[prev[in]].vertex].pos;
+			pos = 0.75f * P + 0.125f * (ahead + behind);
+		}
+		else
+		{
+			vec3 Q = sumFaces / (float)n;
+			vec3 R = (sumEnds / (float)n + P) * 0.5f; // the average of the midpoints is halfway between P and the average of the ends
+			pos = (Q + 2.0f * R + (float)(n - 3) * P) / (float)n;
+		}
+		newVertices[v] = Vertex(4 * first + 1, pos);
+	});
+
+	// Topology: a quad and four half-edges for each old half-edge
+	parallelFor(0, numOldHalfEdges, [&](size_t h) {
+		Index face = halfEdges[h].face;
+		Index next = halfEdges[h].next;
+		Index sym = halfEdges[h].sym;
+		Index nextSym = halfEdges[next].sym;
+		Index q = 4 * h;
+
+		newHalfEdges[q] = HalfEdge(firstEdgePoint + edgeOf[h], q + 1, 4 * prev[h] + 3, h);
+		newHalfEdges[q + 1] = HalfEdge(halfEdges[h].vertex, q + 2, (sym == NONE) ? NONE : 4 * prev[sym] + 2, h);
+		newHalfEdges[q + 2] = HalfEdge(firstEdgePoint + edgeOf[next], q + 3, (nextSym == NONE) ? NONE : 4 * nextSym + 1, h);
+		newHalfEdges[q + 3] = HalfEdge(firstFacePoint + face, q, 4 * next, h);
+
+		if(faces[face].halfEdge == NONE)
+			return; // on a deleted face - so is its quad
+
+		// The quad's normal, pointing the same way as the old face's: the cross product of its diagonals
+		const vec3 &a = newVertices[firstEdgePoint + edgeOf[h]].pos;
+		const vec3 &b = newVertices[halfEdges[h].vertex].pos;
+		const vec3 &c = newVertices[firstEdgePoint + edgeOf[next]].pos;
+		const vec3 &d = newVertices[firstFacePoint + face].pos;
+		vec3 normal = glm::cross(c - a, d - b);
+		float length = glm::length(normal);
+		if(length > 0)
+			normal /= length;
+		else
+			normal = faces[face].normal; // degenerate quad
+		if(glm::dot(normal, faces[face].normal) < 0)
+			normal = -normal;
+		newFaces[h] = Face(q, normal);
+	});
+
+	faces.swap(newFaces);
+	vertices.swap(newVertices);
+	halfEdges.swap(newHalfEdges);
+	trianglesBuilt = false;
+}
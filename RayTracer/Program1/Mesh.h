@@ -9,8 +9,7 @@
 
 #pragma once
 
-#define GLEW_STATIC
-#include "glew.h"
+#include "OpenGL.h"
 #include "../glm/glm.hpp"
 
 using glm::vec3;
@@ -18,126 +17,50 @@ using glm::vec4;
 using glm::mat4;
 
 #include <vector>
-#include <cstdlib>
-#include <ctime>
 
 #include "AbstractGeometryItem.h"
 #include "Drawing.h"
 #include "ExceptionClasses.h"
+#include "Intersection.h"
+#include "BVH.h"
 
 class Mesh : public AbstractGeometryItem
 {
 public:
-	// Forward declarations since Face, Vertex, and HalfEdge all cross-reference each other
-	struct Face;
-	struct Vertex;
-	struct HalfEdge;
+	// Faces, vertices, and half-edges refer to each other by their 32-bit indices in the mesh's arrays rather than by pointers, so
+	// adding to the mesh (which can reallocate the arrays) never invalidates a link, and each element is just 16 bytes.
+	// The index of an element is also its identity (for putting elements in sets, maps, etc.), and is the handle clients keep to
+	// get at it later with getFace() etc. - but don't hold on to the references those return across anything that adds to the mesh.
+	typedef unsigned int Index;
+	static const Index NONE = 0xFFFFFFFF; // a link to nothing (e.g. the sym of a half-edge on the boundary of the mesh)
 
 	struct Face
 	{
 		vec3 normal;
+		Index halfEdge; // any half-edge on this face
 
-		HalfEdge *halfEdge;
-		Vertex *centerPoint;
-
-		std::vector<Vertex*> newVertices;
-
-		// Remove the face from the mesh.
-		// (Note: this does not actually remove the face from the mesh's internal storage. It will simply be skipped over when creating
-		// an index buffer, and thus not drawn.)
-		void deleteFace();
-
-		Face(HalfEdge *halfEdge, vec3 normal) : halfEdge(halfEdge), normal(normal), centerPoint(&Vertex())
-		{
-			srand(time(0));
-			uid = (unsigned)rand();
-		}
-
-		// Get the index of this face in the mesh's face array, which can be used as a handle to it for later operations
-		int getIndex()
-		{
-			return internalIndex;
-		}
-
-	private:
-		friend class Mesh;
-
-		// The index at which this face is stored in the mesh's face array
-		// (The client might need this to access the face later, and should use getIndex() for this.)
-		int internalIndex;
-
-		// To enable defining a total ordering of faces (mainly useful for putting them in sets, maps, etc. since the ordering is meaningless)
-		unsigned uid;
+		Face(Index halfEdge, vec3 normal) : normal(normal), halfEdge(halfEdge) {}
 	};
 
 	struct Vertex
 	{
 		vec3 pos;
-		vec3 color; // not used at the moment because we don't have a color VBO (it was removed when per-object colors were implemented...might want to rethink this)
-
-		HalfEdge *halfEdge;
+		Index halfEdge; // any half-edge pointing to this vertex
 
-		Vertex():halfEdge(NULL), pos(vec3(-1,-1,-1)){}
-
-		Vertex(HalfEdge *halfEdge, vec3 pos) : halfEdge(halfEdge), pos(pos)
-		{
-			srand(time(0));
-			uid = (unsigned)rand();
-		}
-
-		// Get the index of this vertex in the mesh's vertex buffer array, which can be used as a handle to it for later operations
-		int getIndex()
-		{
-			return internalIndex;
-		}
-
-		// Computes the normal for this vertex as the average of the face normals it's associated with
-		vec3 getNormal();
-
-	private:
-		friend class Mesh;
-
-		// The index at which this vertex is stored in the mesh's vertex buffer array
-		// (The client might need this to access the face later, and should use getIndex() for this; also used by Mesh to build an index buffer.)
-		int internalIndex;
-
-		// To enable defining a total ordering of vertices (mainly useful for putting them in sets, maps, etc. since the ordering is meaningless)
-		unsigned uid;
+		Vertex(Index halfEdge, vec3 pos) : pos(pos), halfEdge(halfEdge) {}
 	};
 
 	struct HalfEdge
 	{
-		Vertex *vertex;
-		HalfEdge *next; // next in CCW order on this face
-		HalfEdge *sym;
-		Face *face; 
-		Vertex *halfVertex;
-
-		HalfEdge(Vertex *vertex, HalfEdge *next, HalfEdge *sym, Face *face) : vertex(vertex), next(next), sym(sym), 
-			face(face), halfVertex(NULL)
-		{
-			srand(time(0));
-			uid = (unsigned)rand();
-		}
+		Index vertex; // the vertex this half-edge points to
+		Index next; // next in CCW order on this face
+		Index sym;
+		Index face;
 
-		// Get the index of this halfedge in the mesh's halfedge array, which can be used as a handle to it for later operations
-		int getIndex()
-		{
-			return internalIndex;
-		}
-
-	private:
-		friend class Mesh;
-
-		// The index at which this face is stored in the mesh's face array
-		// (The client might need this to access the face later, and should use getIndex() for this.)
-		int internalIndex;
-
-		// To enable defining a total ordering of faces (mainly useful for putting them in sets, maps, etc. since the ordering is meaningless)
-		unsigned uid;
+		HalfEdge(Index vertex, Index next, Index sym, Index face) : vertex(vertex), next(next), sym(sym), face(face) {}
 	};
 
-	Mesh() : buffered(false)
+	Mesh() : indexed(false), buffered(false), trianglesBuilt(false)
 	{ }
 
 	// Copy constructor - the new copy is NOT buffered, and the original's buffers are not affected
@@ -148,11 +71,16 @@ public:
 		vertices = otherMesh.vertices;
 		halfEdges = otherMesh.halfEdges;
 		indices = otherMesh.indices;
+		positions = otherMesh.positions;
+		normals = otherMesh.normals;
+		indexed = otherMesh.indexed;
 
 		attribs = otherMesh.attribs;
 		
 		buffered = false;
 		vbo = nbo = ibo = 0;
+
+		trianglesBuilt = false;
 	}
 
 	~Mesh()
@@ -162,67 +90,101 @@ public:
 		glDeleteBuffers(1, &ibo);
 	}
 
-	int addFace(HalfEdge *halfEdge, vec3 normal)
+	// Each of these returns the index of the newly-created element
+	Index addFace(Index halfEdge, vec3 normal)
 	{
-		Face newFace(halfEdge, normal);
-		newFace.internalIndex = faces.size();
-		faces.push_back(newFace);
-
-		return newFace.internalIndex;
+		faces.push_back(Face(halfEdge, normal));
+		trianglesBuilt = false;
+		return faces.size() - 1;
 	}
 
-	// Returns the internal index of the newly-created vertex
-	int addVertex(HalfEdge *halfEdge, vec3 pos)
+	Index addVertex(Index halfEdge, vec3 pos)
 	{
-		Vertex newVertex(halfEdge, pos);
-		newVertex.internalIndex = vertices.size();
-		vertices.push_back(newVertex);
-
-		return newVertex.internalIndex;
+		vertices.push_back(Vertex(halfEdge, pos));
+		trianglesBuilt = false;
+		return vertices.size() - 1;
 	}
 
-	int addHalfEdge(Vertex *vertex, HalfEdge *next, HalfEdge *sym, Face *face)
+	Index addHalfEdge(Index vertex, Index next, Index sym, Index face)
 	{
-		HalfEdge newHalfEdge(vertex, next, sym, face);
-		newHalfEdge.internalIndex = halfEdges.size();
-		halfEdges.push_back(newHalfEdge);
+		halfEdges.push_back(HalfEdge(vertex, next, sym, face));
+		trianglesBuilt = false;
+		return halfEdges.size() - 1;
+	}
 
-		return newHalfEdge.internalIndex;
+	// Makes room for at least this many of each element, so a mesh whose size is known up front is built without reallocating
+	void reserve(size_t numFaces, size_t numVertices, size_t numHalfEdges)
+	{
+		faces.reserve(numFaces);
+		vertices.reserve(numVertices);
+		halfEdges.reserve(numHalfEdges);
 	}
 
 	// Note: we *don't* have corresponding delete functions because this would require shifting back all successive elements of the respective
 	// array, which would invalidate all handles to successive items (not to mention that it'd be a very slow operation for large meshes).
 
-	Face* getFace(int index)
+	Face& getFace(Index index)
 	{
-		return &faces[index];
+		return faces[index];
 	}
 
-	Vertex* getVertex(int index)
+	Vertex& getVertex(Index index)
 	{
-		return &vertices[index];
+		return vertices[index];
 	}
 
-	HalfEdge* getHalfEdge(int index)
+	HalfEdge& getHalfEdge(Index index)
 	{
-		return &halfEdges[index];
+		return halfEdges[index];
 	}
 
+	size_t getNumFaces() const { return faces.size(); }
+	size_t getNumVertices() const { return vertices.size(); }
+	size_t getNumHalfEdges() const { return halfEdges.size(); }
+
+	// Remove a face from the mesh.
+	// (Note: this does not actually remove the face from the mesh's internal storage. It will simply be skipped over when creating
+	// an index buffer, and thus not drawn.)
+	void deleteFace(Index face);
+
+	// Computes the normal for a vertex as the average of the face normals it's associated with
+	vec3 getVertexNormal(Index vertex);
+
+	// Computes every vertex's normal at once, as the average of the normals of the faces around it weighted by their areas, into
+	// normals (which is resized to one per vertex). Rather than walking around each vertex the way getVertexNormal() does, this adds
+	// each face's contribution to its corners in passes over the faces and half-edges that run in parallel (see Parallel.h).
+	// A vertex that isn't on any face (or only on degenerate ones) gets a zero normal.
+	void computeVertexNormals(std::vector<vec3> &normals) const;
+
+	// The half-edge before he on its face (i.e. the one whose next is he)
+	Index getPreviousHalfEdge(Index he);
+
 	// Split a face by drawing a line from p1 to p2. p1 and p2 must be part of this face.
 	// Returns the index of the newly-created face.
-	int splitFace(Face *f, Vertex *p1, Vertex *p2);
+	Index splitFace(Index f, Index p1, Index p2);
 
 	void triangulateAllFaces();
 
-	// Determine the center of a face
-	Vertex getCenterPoint(Face* face);
-
-	Vertex* getPreviousVertex(HalfEdge* he) {
-		HalfEdge current = *he;
-		while(current.next != he)  // loop until we've gone around to the halfedge before the halfedge we started at
-			current = *current.next;
-		return (he->vertex);
-	}
+	// Replaces the mesh with a ready-made indexed triangle list - the way the buffers bufferData() makes hold it - for generators that
+	// can lay out their vertices, normals, and triangles directly (each triangle is indices[3i], indices[3i + 1], indices[3i + 2],
+	// wound counterclockwise seen from outside). The arrays are swapped in, so the ones passed are left with the mesh's old contents.
+	// A mesh made this way has no faces, vertices, or half-edges until something needs them: subDivide() builds them first (see
+	// buildHalfEdges()), and everything else works from the triangles as they are.
+	void setIndexedTriangles(std::vector<vec3> &positions, std::vector<vec3> &normals, std::vector<unsigned> &indices);
+	bool isIndexed() const { return indexed; }
+
+	// Turns an indexed mesh (see setIndexedTriangles()) into faces, vertices, and half-edges: a triangle face for each triangle,
+	// with the half-edges along each edge the triangles share sym'd together. Vertices in the same place become one vertex, so the
+	// triangles around them are connected however they were laid out. Its normals are computed from then on, like any other mesh's.
+	// Does nothing to a mesh that isn't indexed.
+	void buildHalfEdges();
+
+	// Catmull-Clark subdivision, applied levels times. Each face becomes a quad per corner, so after this the mesh is all quads.
+	// Every level is built from scratch into new arrays sized up front, in passes over the faces, edges, and vertices that each
+	// run in parallel (see Parallel.h); the old level's half-edges tell each pass where everything goes, so no pass has to wait
+	// on another's output except through the order of the passes themselves.
+	// An indexed mesh gets its half-edges built first (see buildHalfEdges()).
+	void subDivide(int levels = 1);
 
 	// Remove all faces from the mesh structure
 	void clear()
@@ -232,6 +194,13 @@ public:
 		halfEdges.clear();
 
 		indices.clear();
+		positions.clear();
+		normals.clear();
+		indexed = false;
+		triangles.clear();
+		cornerNormals.clear();
+		triangleBVH.clear();
+		trianglesBuilt = false;
 
 		if(buffered)
 		{
@@ -247,14 +216,28 @@ public:
 	// Note: the std::vector indexBuffer will be emptied first, if there's anything in it.
 	void fillIndexBuffer(std::vector<unsigned> &indexBuffer);
 
+	// Fans every face out into prepared triangles (the raytracing counterpart of fillIndexBuffer()), in one pass over the faces.
+	// Each triangle's face id is the index of the face it came from. (An indexed mesh's triangles are exported as they are, with their
+	// own indices as their face ids.) If bounds isn't null, it receives each triangle's bounding box
+	// (computed from the original points, so it's exact), ready to hand to BVH::build().
+	// Note: triangles is emptied first, just like fillIndexBuffer()'s indexBuffer; so is bounds.
+	void exportTriangles(TriangleBatch &triangles, std::vector<AABB> *bounds = 0) const;
+
 	// Generate VBOs on the GPU based on the data stored in our half-edge structure
 	void bufferData(AttribLocations attribs);
 
-	void subDivide();
-
 	// Abstract functions inherited from AbstractGeometryItem
 	virtual void draw(mat4 transform);
 	virtual float getUnitHeight(); // Calculate the height of the mesh (maximum - minimum points in y-dimension)
+	// Note: intersect() relies on the prepared triangles built by getBounds() (or bufferData()) - one of those needs to have been
+	// called since the mesh was last changed. (Building a BVH over the scene calls getBounds() on everything, so that takes care of it.)
+	virtual double intersect(const Ray &ray);
+	virtual double intersect(const Ray &ray, vec3 &normal);
+	virtual double intersect(const Ray &ray, vec3 &normal, vec3 &faceNormal);
+	virtual void intersect(RayPacket &packet); // records the index of the triangle hit
+	virtual void getBounds(vec3 &boundsMin, vec3 &boundsMax);
+	virtual vec3 getColor() { return vec3(1.0f, 0.0f, 0.0f); } // the same red draw() uses
+	virtual void getTriangles(TriangleBatch &triangles, std::vector<vec3> &cornerNormals);
 
 private:
 	std::vector<Face> faces;
@@ -263,7 +246,24 @@ private:
 
 	std::vector<unsigned> indices;
 
+	// An indexed mesh's vertices (see setIndexedTriangles()); indices holds its triangles. For any other mesh, these are empty, and
+	// indices is filled from the faces when the mesh is buffered.
+	bool indexed;
+	std::vector<vec3> positions, normals;
+
 	bool buffered;
 	AttribLocations attribs;
 	unsigned vbo, nbo, ibo;
+
+	// Each face fanned out into prepared triangles for raytracing (see buildTriangles()), stored in the BVH's leaf order, and the BVH
+	// over them. Meshes are shared between the scene graph nodes that place them, so this only gets built once per mesh no matter how
+	// many times it appears.
+	TriangleBatch triangles;
+	std::vector<vec3> cornerNormals; // vertex normals at each triangle's p1, p2, p3 (three per triangle, in the same order), for shading
+	BVH triangleBVH;
+	bool trianglesBuilt; // false if the mesh has changed since triangles was filled
+
+	void buildTriangles();
+
+	void subDivideOnce();
 };
\ No newline at end of file
@@ -66,16 +66,13 @@ void MyGLWidget::initializeGL() {
 	Box::staticInitialize(attribs);
 	// Initialize geometry instances
 	whiteBox.initialize(vec3(1,1,1)); // white
-	greenBox.initialize(vec3(0,1,0)); // green
-	yellowBox.initialize(vec3(1,1,0)); // yellow
-	table.initialize(vec3(1,0,0)); // red
-	chair.initialize(vec3(0,0,1)); // blue
+	sceneLoader.initialize(attribs); // the scene's geometry
 
 	// Parse scene description and build scene graph
 	parseSceneDescription(scene, "testScene.txt");
 
 	// Read geometry description and buffer the mesh
-	//parseGeometryDescription(mesh, "extrusion1.dat");
+	//sceneLoader.parseGeometryDescription(mesh, "extrusion1.dat");
 
 	// Initialize zoom, upDownAngle, and leftRightAngle
 	zoom = 0;
@@ -169,216 +166,25 @@ char* MyGLWidget::textFileRead(const char* fileName) {
 
 void MyGLWidget::parseSceneDescription(SceneGraph &scene, std::string fileName)
 {
-	
-	//The way stacking works: 
-	/*
-	The yScale of each piece of geometry is recorded as that geometry's yScale.
-	That geometry is given to a SceneGraph Node which is then added as a child
-		to furnitureRoot. 
-	FurnitureRoot is a childNode of floor.
-	Floor is a child of Scene, which is a member of MyGlWidget.
-	An object itself shouldn't know it's height. In local space, an object only knows it's size.
-	We should set an objects yTransformation out here in Paint (or in this func) where we can see the location of all 
-		the objects. If we see that an object is over another object, we should set its yTrans
-		equal to it's parent's yTrans + it's parent's scaled height.
-
-
-	//Drawing:
-	Then, when you call scene.draw(), it calls head->draw() (Where head is the topmost node)
-	That first transforms the same as it's parent's transformation, and then also transforms by
-		the transformation that you pass into it in the Node() constructor.
-	Then it calls draw() on its geometry. This draw function is virtual and routes to
-		the draw function contained in the class that matches the type of geometry calling draw()
-	That draw function will transform a box into whatever position it needs to be in in local 
-		space and then call the most basic Draw() function (member of GeometryItem), which
-		takes the VBO, NBO and IBO into account and sends all the information into the shader.
-	*/
+	// (See SceneLoader for how the scene graph gets built, and how stacking works.)
+	sceneLoader.load(scene, fileName);
+	objects = sceneLoader.getObjects();
+	if(objects.empty())
+		return;
 
-	
-	
-	// Clear the scene, in case there's already something there
-	scene.clear();
-
-	std::ifstream file;
-	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-	try
-	{
-		file.open(fileName);
-		
-		int floorXSize, floorZSize;
-		int numItems;
-
-		file >> floorXSize >> floorZSize >> numItems;
-
-		// Start our tree at the floor
-		/*mat4 scene_rotx = glm::rotate(mat4(1.0f), 0.0f, vec3(1.0f, 0.0f, 0.0f));
-		mat4 scene_roty = glm::rotate(mat4(1.0f), 0.0f, vec3(0.0f, 1.0f, 0.0f));
-		mat4 scene_rotz = glm::rotate(mat4(1.0f), 0.0f, vec3(0.0f, 0.0f, 1.0f));
-		mat4 scene_scale = glm::scale(mat4(1.0f), vec3(2, 2, 2));
-		mat4 floorScale = glm::scale(mat4(1.0f), vec3((float)floorXSize, 0.1f, (float)floorZSize));
-		mat4 floorTransform = scene_rotz * scene_roty * scene_rotx * scene_scale * floorScale;*/
-		//construct vectors to store transformation values in node
-		SceneGraph::Node *floor = new SceneGraph::Node(&greenBox, vec3(0,0,0), vec3(0,0,0), vec3(2*(float)floorXSize,2*0.1f,2*(float)floorZSize));
-		// But, we need to send up the camera matrix as a root node above the floor, so make the floor a child of that.
-		//SceneGraph::Node *root = new SceneGraph::Node(0, camera);
-		//scene.addChildToHead(root);
-		//root->addChild(floor);
-		scene.addChildToHead(floor);
-
-		// Add a transformation node to reverse the floor's scaling, and place items on top of the floor
-		// This will be the immediate parent for all floor-level furniture items.
-		//floorTransform = glm::scale(floorTransform, vec3(2, 2, 2));
-		//floorTransform = glm::inverse(floorScale) * floorTransform;
-		mat4 onFloor_trans = glm::translate(mat4(1.0f), vec3(0,0.55f,0));
-		//SceneGraph::Node *furnitureRoot = new SceneGraph::Node(0, glm::inverse(floorScale) * onFloor_trans);
-		SceneGraph::Node *furnitureRoot = new SceneGraph::Node(0, vec3(0,0,0), vec3(0,0.55,0), vec3(1/((float)floorXSize), 1/(0.1f), 1/((float)floorZSize)));
-		floor->addChild(furnitureRoot);
-
-
-		// Add walls around the edges of the floor
-		/*mat4 frontWall_scale = glm::scale(mat4(1.0f), vec3(floorXSize, WALL_HEIGHT, 0.1));
-		mat4 frontWall_trans = glm::translate(mat4(1.0f), vec3(0, WALL_HEIGHT*.5, (floorZSize*.5)+0.05));
-		furnitureRoot->addChild(new SceneGraph::Node(&box, frontWall_trans * frontWall_scale));
-		mat4 backWall_trans = glm::translate(mat4(1.0f), vec3(0, WALL_HEIGHT*.5, -((floorZSize*.5)+0.05)));
-		furnitureRoot->addChild(new SceneGraph::Node(&box, backWall_trans * frontWall_scale));
-		mat4 leftWall_scale = glm::scale(mat4(1.0f), vec3(0.1f, WALL_HEIGHT, floorZSize));
-		mat4 leftWall_trans = glm::translate(mat4(1.0f), vec3((floorXSize*.5f)+0.05, WALL_HEIGHT*.5f, 0));
-		furnitureRoot->addChild(new SceneGraph::Node(&box, leftWall_trans * leftWall_scale));
-		mat4 rightWall_trans = glm::translate(mat4(1.0f), vec3(-((floorXSize*.5f)+0.05), WALL_HEIGHT*.5f, 0));
-		furnitureRoot->addChild(new SceneGraph::Node(&box, rightWall_trans * leftWall_scale));
-*/
-		// Read in the furniture from the file and build the scene graph
-		// First off, we need to keep track of what the "stacking level" is at each grid location:
-		float **stackingLevels = new float*[floorXSize];
-		// Likewise, we're going to need another array to keep track of the "top" item at each grid location:
-		SceneGraph::Node ***stackingItems = new SceneGraph::Node**[floorXSize];
-		for(int i = 0; i < floorXSize; i++)
-		{
-			stackingLevels[i] = new float[floorZSize];
-			stackingItems[i] = new SceneGraph::Node*[floorZSize];
-		}
-
-		// Initialize each grid location's item pointer to 0
-		for(int i = 0; i < floorXSize; i++)
-		{
-			for(int j = 0; j < floorZSize; j++)
-			{
-				stackingLevels[i][j] = 0;
-				stackingItems[i][j] = 0; // null pointer means the grid location is empty
-			}
-		}
-
-		// Build the scene
-		for(int item = 0; item < numItems; item++)
-		{
-			std::string type, meshFileName;
-			int meshNumSubdivides;
-			int xIndex, zIndex;
-			float rotation;
-			float xScale, yScale, zScale;
-
-			file >> type;
-			if(type == "mesh")
-				file >>	meshFileName >> meshNumSubdivides >> xIndex >> zIndex >> rotation >> xScale >> yScale >> zScale;
-			else
-				file >> xIndex >> zIndex >> rotation >> xScale >> yScale >> zScale;
-
-			AbstractGeometryItem *geo;
-
-			if(type == "box")
-			{
-				geo = &yellowBox;
-			}
-			else if(type == "chair")
-			{
-				geo = &chair;
-			}
-			else if(type == "table")
-			{
-				geo = &table;
-			}
-			else if(type == "mesh")
-			{
-				sceneMeshes.push_back(Mesh());
-				parseGeometryDescription(sceneMeshes[sceneMeshes.size()-1], meshFileName);
-			}
-			else
-			{
-				SceneGraphException ex;
-				ex.reason = "SceneGraph: invalid furniture type \"" + type + "\"!";
-				throw ex;
-			}
-			
-			// For the translation, first we need to determine where this item's grid position is in world space.
-			// For simplicity, we'll define our grid to be a floorXSize-by-floorZSize "square" in the x-z plane, centered
-			// at the origin. The grid point 0,0 will be at (-floorXSize*.5f, -floorZSize*.5f) in world space.
-			//mat4 trans_grid = glm::translate(mat4(1.0f), vec3(-((float)floorXSize)/2.0f + xIndex, 0.0f, -((float)floorZSize)/2.0f + zIndex));
-			//// Now, we need to position the item vertically, on top of any previous items in its grid location.
-			//mat4 trans_y = glm::translate(mat4(1.0f), vec3(0.0f, stackingLevels[xIndex][zIndex], 0.0f)); // 0.5 is a hardcoded hack, specific to current furniture - need to change this
-			//// Rotate and scale
-			//mat4 trans_rot = glm::rotate(mat4(1.0f), rotation, vec3(0.0f, 1.0f, 0.0f)); // rotation is about the y-axis
-			//mat4 trans_scale = glm::scale(mat4(1.0f), vec3(xScale, yScale, zScale));
-			vec3 gridTranslation(-((float)floorXSize)/2.0f + xIndex, 0.5f, -((float)floorZSize)/2.0f + zIndex);
-			
-			float itemBaseLevel = stackingLevels[xIndex][zIndex]; // save the stacking level before this item was added so we know where to put it
-			stackingLevels[xIndex][zIndex] += geo->getUnitHeight()*yScale;
-			//stackingLevels[xIndex][zIndex] = 0.0f;
-
-			SceneGraph::Node *thisItem = 0;
-
-			// Add the furniture item as a child node of whatever's under it on its grid location.
-			// If there's nothing under it, we will make it a child of the furniture root.
-			if(stackingItems[xIndex][zIndex] == 0)
-			{
-				thisItem = new SceneGraph::Node(geo, vec3(0,rotation,0), gridTranslation, vec3(xScale, yScale, zScale));
-				furnitureRoot->addChild(thisItem);
-			}
-			else //if there's geometry at this spot already.
-			{
-				SceneGraph::Node *baseNode = stackingItems[xIndex][zIndex];
-				AbstractGeometryItem *baseGeo = baseNode->getGeometry();
-				float stackingHeight = (.5*baseGeo->getUnitHeight()*baseNode->getScalingY()) + (.5*geo->getUnitHeight()*yScale);
-				thisItem = new SceneGraph::Node(geo, vec3(0,rotation,0), vec3(0,stackingHeight,0), vec3(xScale, yScale, zScale));
-				stackingItems[xIndex][zIndex]->addChild(thisItem);
-			}
-			stackingItems[xIndex][zIndex] = thisItem;
-
-			
-			//as of right now, i'm only having "furniture roots" be selectable until we get stacking working
-			objects.push_back(thisItem);
-		}
-
-		// Free dynamically allocated memory for grid arrays
-		for(int i = 0; i < floorXSize; i++)
-		{
-			//delete [] stackingLevels[i];
-			delete [] stackingItems[i];
-		}
-		//delete [] stackingLevels;
-		delete [] stackingItems;
-
-		//set the first vector as the default "selected"
-		iterator = 0;
-		objects[iterator]->setSelected(true);
-		//SET INITIAL SLIDER VALUES
-		float temp = objects[iterator]->getScalingX();
-		if(temp > 100) temp = 100;
-		emit changeScalingXSliderValue(temp*100.0f);
-		temp = objects[iterator]->getScalingY();
-		if(temp > 100) temp = 100;
-		emit changeScalingYSliderValue(temp*100.0f);
-		temp = objects[iterator]->getScalingZ();
-		if(temp > 100) temp = 100;
-		emit changeScalingZSliderValue(temp*100.0f);
-
-	}
-	catch(std::ifstream::failure &failure)
-	{
-		SceneGraphException ex;
-		ex.reason = "SceneGraph: file error while parsing scene description!";
-		throw ex;
-	}
+	//set the first vector as the default "selected"
+	iterator = 0;
+	objects[iterator]->setSelected(true);
+	//SET INITIAL SLIDER VALUES
+	float temp = objects[iterator]->getScalingX();
+	if(temp > 100) temp = 100;
+	emit changeScalingXSliderValue(temp*100.0f);
+	temp = objects[iterator]->getScalingY();
+	if(temp > 100) temp = 100;
+	emit changeScalingYSliderValue(temp*100.0f);
+	temp = objects[iterator]->getScalingZ();
+	if(temp > 100) temp = 100;
+	emit changeScalingZSliderValue(temp*100.0f);
 }
 
 void MyGLWidget::changeZoom(int zoomLevel)
@@ -405,7 +211,7 @@ void MyGLWidget::changeLeftRightAngle(int angle)
 void MyGLWidget::loadNewScene(QString text)
 {
 	parseSceneDescription(scene, text.toStdString());
-	//parseGeometryDescription(mesh, text.toStdString());
+	//sceneLoader.parseGeometryDescription(mesh, text.toStdString());
 	zoom = 0;
 	upDownAngle = 0;
 	leftRightAngle = 0;
@@ -494,243 +300,6 @@ void MyGLWidget::previousObject()
 	repaint();
 }
 
-void MyGLWidget::parseGeometryDescription(Mesh &mesh, std::string filename)
-{
-	mesh.clear();
-
-	// Read in the polygon description from file
-	std::ifstream inputFile(filename);
-
-	std::string procedureType;
-	inputFile >> procedureType;
-
-	if(procedureType == "extrusion")
-	{
-		float height;
-		int numPoints;
-
-		inputFile >> height >> numPoints;
-
-		std::vector<vec3> polygonPoints;
-		for(int i = 0; i < numPoints - 1; i++) // Note: loops one less time to skip repeated first point at end of input
-		{
-			vec3 loc, normal(0,1,0);
-		
-			inputFile >> loc.x >> loc.z;
-			loc.y = 0.0f;
-
-			polygonPoints.push_back(loc);
-		}
-
-		// Test for convexity; if the polygon is convex, build an index buffer based on its triangulation
-		if(polygonPoints.size() < 3)
-			return; // our algorithm won't work unless there are at least 3 points - there should be, if the input was correct
-
-		bool isConvex = true;
-		// Find vertex 0's normal
-		vec3 n = glm::cross(polygonPoints[1] - polygonPoints[0], polygonPoints[polygonPoints.size()-1] - polygonPoints[0]);
-		// Find the normal for each of the other vertices; if it's opposite v0's, the polygon is non-convex.
-		// While we're at it, add up the number of points with positive and negative normals (in the y dimension) -
-		// that'll tell us the winding order by which the polygon was specified in the input file.
-		int numPositiveNormals = 0;
-		for(int i = 1; i < polygonPoints.size(); i++)
-		{
-			int next = (i+1) % polygonPoints.size();
-			vec3 t = glm::cross(polygonPoints[next] - polygonPoints[i], polygonPoints[i-1] - polygonPoints[i]);
-			vec3 x = glm::normalize(t);
-			vec3 y = glm::normalize(-n);
-			if(x == y)
-				isConvex = false;
-			if(x.y == 1)
-				numPositiveNormals++;
-		}
-
-		if(isConvex)
-			isConvex = true;
-		else
-			isConvex = false;
-
-		// Create the side panels as quads, and, if the polygon is convex, add endcaps (as n-gons).
-		// Then, use Mesh::splitFace() to triangulate.
-
-		std::vector<Mesh::HalfEdge*> sidePanelSymEdges; // the "side" half-edges of each panel that need to be sym'd to each other
-
-		for(int i = 0; i < polygonPoints.size(); i++)
-		{
-			// Quad points for side panel:
-			// bottom[i], bottom[i+1], top[i+1], top[i]
-			vec3 bottomI = polygonPoints[i] - vec3(0,0.5*height,0);
-			vec3 topI = polygonPoints[i] + vec3(0,0.5*height,0);
-			vec3 bottomI1 = polygonPoints[(i+1) % polygonPoints.size()] - vec3(0,0.5*height,0);
-			vec3 topI1 = polygonPoints[(i+1) % polygonPoints.size()] + vec3(0,0.5*height,0);
-
-			// Create Mesh::Vertices from the four points
-			int vBottomI = mesh.addVertex(0, bottomI);
-			int vTopI = mesh.addVertex(0, topI);
-			int vBottomI1 = mesh.addVertex(0, bottomI1);
-			int vTopI1 = mesh.addVertex(0, topI1);
-
-			// Compute face normal and create a Mesh::Face
-			vec3 faceNormal;
-			if(numPositiveNormals > polygonPoints.size() - numPositiveNormals) // "wrong" winding order (CW) in input file
-				faceNormal = glm::normalize(glm::cross(bottomI - topI, topI1 - topI));
-			else
-				faceNormal = glm::normalize(glm::cross(topI1 - topI, bottomI - topI));
-			int face = mesh.addFace(0, faceNormal);
-			Mesh::Face *pFace = mesh.getFace(face);
-
-			// Create four half-edges: top, bottom, left, and right, and point them to the appropriate vertices
-			int heTop, heLeft, heBottom, heRight;
-			if(numPositiveNormals > polygonPoints.size() - numPositiveNormals) // CW winding order in input file
-			{
-				heTop = mesh.addHalfEdge(mesh.getVertex(vTopI1), 0, 0, pFace);
-				heLeft = mesh.addHalfEdge(mesh.getVertex(vBottomI1), 0, 0, pFace);
-				heBottom = mesh.addHalfEdge(mesh.getVertex(vBottomI), 0, 0, pFace);
-				heRight = mesh.addHalfEdge(mesh.getVertex(vTopI), 0, 0, pFace);
-			}
-			else
-			{
-				heTop = mesh.addHalfEdge(mesh.getVertex(vTopI), 0, 0, pFace);
-				heLeft = mesh.addHalfEdge(mesh.getVertex(vBottomI), 0, 0, pFace);
-				heBottom = mesh.addHalfEdge(mesh.getVertex(vBottomI1), 0, 0, pFace);
-				heRight = mesh.addHalfEdge(mesh.getVertex(vTopI1), 0, 0, pFace);
-			}
-
-			pFace->halfEdge = mesh.getHalfEdge(heTop); // we can point the face to any half-edge on it
-			mesh.getVertex(vTopI)->halfEdge = mesh.getHalfEdge(heTop); // likewise, we can point the vertices to any neighboring half-edge
-			mesh.getVertex(vTopI1)->halfEdge = mesh.getHalfEdge(heTop);
-			mesh.getVertex(vBottomI)->halfEdge = mesh.getHalfEdge(heBottom);
-			mesh.getVertex(vBottomI1)->halfEdge = mesh.getHalfEdge(heBottom);
-
-			mesh.getHalfEdge(heTop)->next = mesh.getHalfEdge(heLeft);
-			mesh.getHalfEdge(heLeft)->next = mesh.getHalfEdge(heBottom);
-			mesh.getHalfEdge(heBottom)->next = mesh.getHalfEdge(heRight);
-			mesh.getHalfEdge(heRight)->next = mesh.getHalfEdge(heTop);
-
-			// Add the left edge to sidePanelSymEdges - at the end we'll go back through and connect all the syms
-			sidePanelSymEdges.push_back(mesh.getHalfEdge(heLeft));
-		}
-
-		// Connect all the syms
-		for(int i = 0; i < sidePanelSymEdges.size(); i++)
-			sidePanelSymEdges[i]->sym = sidePanelSymEdges[(i+1) % sidePanelSymEdges.size()];
-
-		// Now, add the endcaps - but only if the polygon is convex.
-		if(isConvex)
-		{
-			// Grab one of the vertices pointed to by the "left" half-edges in sidePanelSymEdges - as good a starting point as any
-			Mesh::Vertex *bottom0 = sidePanelSymEdges[0]->vertex;
-			Mesh::Vertex *top0 = sidePanelSymEdges[0]->next->next->vertex;
-
-			// Create a face, and half-edges all around the polygon, connecting their next pointers accordingly
-			int bottomFace = mesh.addFace(0, vec3(0,-1,0));
-			Mesh::HalfEdge *bp = sidePanelSymEdges[0]->next;
-			std::vector<Mesh::HalfEdge*> bottomHEs; // so we can connect the next pointers at the end
-			do
-			{
-				int newHE = mesh.addHalfEdge(bp->vertex, 0, bp, mesh.getFace(bottomFace));
-				bottomHEs.push_back(mesh.getHalfEdge(newHE));
-
-				bp = bp->next;
-			} while(bp != sidePanelSymEdges[0]->next);
-			// Connect next ptrs.
-			for(int i = 0; i < bottomHEs.size(); i++)
-				bottomHEs[i]->next = bottomHEs[(i+1) % bottomHEs.size()];
-
-			// Repeat for the top
-			int topFace = mesh.addFace(0, vec3(0,1,0));
-			Mesh::HalfEdge *tp = sidePanelSymEdges[0]->next->next->next;
-			std::vector<Mesh::HalfEdge*> topHEs; // so we can connect the next pointers at the end
-			do
-			{
-				int newHE = mesh.addHalfEdge(tp->vertex, 0, tp, mesh.getFace(topFace));
-				topHEs.push_back(mesh.getHalfEdge(newHE));
-
-				tp = tp->next;
-			} while(tp != sidePanelSymEdges[0]->next->next->next);
-			// Connext next ptrs.
-			for(int i = 0; i < topHEs.size(); i++)
-				topHEs[i]->next = topHEs[(i+1) % topHEs.size()];
-		}
-
-		// Triangulate all faces of the mesh (right now they're quads on the sides and n-gons on the top/bottom)
-		mesh.triangulateAllFaces();
-	}
-	else if(procedureType == "surfrev")
-	{
-		//int numSlices;
-		//int numPoints;
-
-		//inputFile >> numSlices >> numPoints;
-
-		//// numSlices must be at least 3, or the mesh will be flat - we don't want this
-		//if(numSlices < 3)
-		//	return;
-
-		//std::vector<vec3> polygonPoints;
-		//for(int i = 0; i < numPoints; i++)
-		//{
-		//	vec3 loc, normal(0,1,0);
-		//
-		//	inputFile >> loc.x >> loc.y;
-		//	loc.z = 0.0f;
-
-		//	// x-coordinates may not be negative - clamp to [0, inf.)
-		//	if(loc.x < 0)
-		//		loc.x = 0;
-
-		//	polygonPoints.push_back(loc);
-		//}
-
-		//// Check if the polyline ends at the y-axis (on both ends) - if not, we'll need to add additional point(s) with x=0 to cap it off
-		//if(polygonPoints[0].x != 0.0f)
-		//	polygonPoints.insert(polygonPoints.begin(), vec3(0, polygonPoints[0].y, 0));
-		//if(polygonPoints[polygonPoints.size() - 1].x != 0.0f)
-		//	polygonPoints.push_back(vec3(0, polygonPoints[polygonPoints.size() - 1].y, 0));
-
-		//// Perform the rotation
-		//int sliceSize = 360 / numSlices;
-		//for(int i = 0; i < 360; i += sliceSize)
-		//{
-		//	// If this is the last slice, make sure we don't overshoot past 360 degrees
-		//	// Note: the "yes" case was erroneously "i - 360" when I turned this in; it didn't cause problems for the two sample cases
-		//	// included with the assignment, but will cause problems in the general case.
-		//	int thisSlice = (i + sliceSize > 360) ? 360 - i : sliceSize;
-
-		//	// Determine the rotated points on the polyline for the beginning and end of this slice
-		//	std::vector<vec4> begin, end;
-		//	for(int j = 0; j < polygonPoints.size(); j++)
-		//	{
-		//		// These were wrong in the turned-in version too - I had i*sliceSize instead of i in the next two lines
-		//		begin.push_back(glm::rotate(mat4(1.0f), (float)(i), vec3(0,1,0)) * vec4(polygonPoints[j], 1));
-		//		end.push_back(glm::rotate(mat4(1.0f), (float)(i + thisSlice), vec3(0,1,0)) * vec4(polygonPoints[j], 1));
-		//	}
-
-		//	// Triangulate the side of this slice and add the resultant faces to the mesh
-		//	for(int j = 0; j < polygonPoints.size() - 1; j++)
-		//	{
-		//		Mesh::Face face;
-
-		//		// First triangle
-		//		face.p0 = vec3(begin[j]);
-		//		face.p1 = vec3(begin[j+1]);
-		//		face.p2 = vec3(end[j+1]);
-		//		face.normal = glm::normalize(glm::cross(face.p0 - face.p1, face.p2 - face.p1));
-		//		mesh.addFace(face);
-
-		//		// Second triangle
-		//		face.p0 = vec3(end[j+1]);
-		//		face.p1 = vec3(end[j]);
-		//		face.p2 = vec3(begin[j]);
-		//		face.normal = glm::normalize(glm::cross(face.p0 - face.p1, face.p2 - face.p1));
-		//		mesh.addFace(face);
-		//	}
-		//}
-	}
-
-	mesh.bufferData(attribs);
-}
-
 void MyGLWidget::changeRotationDegrees(int r)
 {
 	objects[iterator]->setRotationDegreesY(r+180);
@@ -8,8 +8,7 @@
 **********************************************************/
 
 #pragma once
-#define GLEW_STATIC
-#include "glew.h"
+#include "OpenGL.h"
 #include "../glm/glm.hpp"
 #include "../glm/gtc/matrix_transform.hpp"
 #include <QGLWidget>
@@ -23,9 +22,8 @@
 #include "Drawing.h"
 
 #include "SceneGraph.h"
+#include "SceneLoader.h"
 #include "Box.h"
-#include "Table.h"
-#include "Chair.h"
 
 #include "Mesh.h"
 
@@ -88,15 +86,13 @@ private:
 	//AttribLocations attribs; // now a global variable, declared as an extern in Drawing.h and defined in MyGLWidget.cpp
 
 	Mesh mesh;
-	std::vector<Mesh> sceneMeshes;
 
 	std::vector<SceneGraph::Node*> objects;
 	int iterator;
 
 	SceneGraph scene;
-	Box whiteBox, greenBox, yellowBox;
-	Table table;
-	Chair chair;
+	SceneLoader sceneLoader; // owns the geometry the scene is built from
+	Box whiteBox;
 
 	glm::mat4 projection, camera;
 
@@ -105,6 +101,4 @@ private:
 
 	void updateCamera();
 	void parseSceneDescription(SceneGraph &scene, std::string fileName);
-
-	void parseGeometryDescription(Mesh &mesh, std::string fileName);
 };
\ No newline at end of file
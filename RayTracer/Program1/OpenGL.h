@@ -0,0 +1,45 @@
+#pragma once
+
+// Everything that makes OpenGL calls gets them through here.
+// Normally this is just GLEW. In a headless build (HEADLESS defined - see the command-line raytracer), which only ever raytraces
+// and has no GL context (or GL library) to draw with, the few GL calls the geometry and scene graph classes make are replaced
+// with stand-ins that do nothing, so those classes can be used as they are.
+#ifndef HEADLESS
+
+#define GLEW_STATIC
+#include "glew.h"
+
+#else
+
+#include <cstddef>
+
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned char GLboolean;
+typedef float GLfloat;
+typedef std::ptrdiff_t GLsizeiptr;
+
+#define GL_FALSE 0
+#define GL_ZERO 0
+#define GL_TRIANGLES 0x0004
+#define GL_UNSIGNED_INT 0x1405
+#define GL_FLOAT 0x1406
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW 0x88E4
+
+inline void glGenBuffers(GLsizei n, GLuint *buffers) {for(GLsizei i = 0; i < n; i++) buffers[i] = 0;}
+inline void glDeleteBuffers(GLsizei, const GLuint*) {}
+inline void glBindBuffer(GLenum, GLuint) {}
+inline void glBufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+inline void glEnableVertexAttribArray(GLuint) {}
+inline void glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+inline void glDrawElements(GLenum, GLsizei, GLenum, const void*) {}
+inline void glUniform1i(GLint, GLint) {}
+inline void glUniform3f(GLint, GLfloat, GLfloat, GLfloat) {}
+inline void glUniform3fv(GLint, GLsizei, const GLfloat*) {}
+inline void glUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) {}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// If this isn't 0, parallelFor() goes by it instead of the number of hardware threads - e.g. for checking that something comes
+// out the same however many threads it's split across
+inline unsigned& parallelThreadsOverride()
+{
+	static unsigned numThreads = 0;
+	return numThreads;
+}
+
+// How many threads parallelFor() splits count items across, given minPerThread
+inline size_t numParallelThreads(size_t count, size_t minPerThread = 4096)
+{
+	size_t numThreads = parallelThreadsOverride() ? parallelThreadsOverride() : std::max(1u, std::thread::hardware_concurrency());
+	return std::max((size_t)1, std::min(numThreads, (count + minPerThread - 1) / minPerThread));
+}
+
+// Calls body(i) for every i in [begin, end), splitting the range into one contiguous chunk per hardware thread. The calls for
+// different i can run at the same time, so body must only write to things that belong to its own i. Ranges too small to be
+// worth starting threads for (fewer than minPerThread items per thread) just run on the calling thread.
+template<typename Body>
+void parallelFor(size_t begin, size_t end, Body body, size_t minPerThread = 4096)
+{
+	if(end <= begin)
+		return;
+	size_t count = end - begin;
+
+	size_t numThreads = numParallelThreads(count, minPerThread);
+	if(numThreads <= 1)
+	{
+		for(size_t i = begin; i < end; i++)
+			body(i);
+		return;
+	}
+
+	// The calling thread takes the first chunk itself
+	size_t chunkSize = (count + numThreads - 1) / numThreads;
+	std::vector<std::thread> threads;
+	for(size_t chunkBegin = begin + chunkSize; chunkBegin < end; chunkBegin += chunkSize)
+	{
+		size_t chunkEnd = std::min(chunkBegin + chunkSize, end);
+		threads.push_back(std::thread([=]() {
+			for(size_t i = chunkBegin; i < chunkEnd; i++)
+				body(i);
+		}));
+	}
+	for(size_t i = begin; i < begin + chunkSize; i++)
+		body(i);
+
+	for(size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
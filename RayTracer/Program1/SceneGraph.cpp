@@ -0,0 +1,125 @@
+#include "SceneGraph.h"
+#include "Intersection.h"
+
+void SceneGraph::buildBVH()
+{
+	head->updateTransforms();
+
+	std::vector<Node*> nodes;
+	head->collectGeometryNodes(nodes);
+
+	instances.clear();
+	std::vector<AABB> bounds;
+	for(size_t i = 0; i < nodes.size(); i++)
+	{
+		// (This is also what makes geometry items build their own BVHs, if they haven't already.)
+		vec3 boundsMin, boundsMax;
+		nodes[i]->getGeometry()->getBounds(boundsMin, boundsMax);
+
+		// Nothing can hit a node whose geometry has no triangles, so it's left out (its empty bounds wouldn't survive transforming anyway)
+		if(boundsMin.x > boundsMax.x)
+			continue;
+
+		Instance instance;
+		instance.worldInverse = glm::mat4x3(nodes[i]->getWorldInverse());
+		instance.geo = nodes[i]->getGeometry();
+		instance.node = nodes[i];
+		instances.push_back(instance);
+
+		transformBounds(nodes[i]->getWorldTransform(), boundsMin, boundsMax);
+		bounds.push_back(AABB(boundsMin, boundsMax));
+	}
+
+	bvh.build(bounds);
+}
+
+int SceneGraph::closestInstance(const Ray &ray, double &t)
+{
+	return bvh.closestHit(ray, t, [&](int i) -> double {
+		return intersectInstance(instances[i], ray);
+	});
+}
+
+SceneGraph::Node* SceneGraph::intersect(const Ray &ray, double &t)
+{
+	int hit = closestInstance(ray, t);
+	return (hit >= 0) ? instances[hit].node : 0;
+}
+
+SceneGraph::Node* SceneGraph::intersect(const Ray &ray, double &t, vec3 &normal)
+{
+	vec3 faceNormal;
+	return intersect(ray, t, normal, faceNormal);
+}
+
+SceneGraph::Node* SceneGraph::intersect(const Ray &ray, double &t, vec3 &normal, vec3 &faceNormal)
+{
+	int hit = closestInstance(ray, t);
+	if(hit < 0)
+		return 0;
+
+	getNormals(instances[hit], ray.transformed(instances[hit].worldInverse), normal, faceNormal);
+	return instances[hit].node;
+}
+
+SceneGraph::Node* SceneGraph::intersect(const vec3 &p0, const vec3 &v0, double &t)
+{
+	return intersect(Ray(p0, glm::normalize(v0)), t);
+}
+
+SceneGraph::Node* SceneGraph::intersect(const vec3 &p0, const vec3 &v0, double &t, vec3 &normal)
+{
+	return intersect(Ray(p0, glm::normalize(v0)), t, normal);
+}
+
+void SceneGraph::intersect(RayPacket &packet, Node **nodes, vec3 *normals, vec3 *faceNormals)
+{
+	// Each instance gets the rays that reach it brought into its object space as a packet of their own, and records what they hit
+	// in it as hitting the instance
+	RayPacket objectRays;
+	bvh.closestHits(packet, [&](int i, const int *rays, int numRays) {
+		const Instance &instance = instances[i];
+		objectRays.reset(instance.worldInverse * glm::vec4(packet.origin, 1));
+		for(int j = 0; j < numRays; j++)
+			objectRays.add(instance.worldInverse * glm::vec4(packet.getDirection(rays[j]), 0), packet.t[rays[j]]);
+
+		instance.geo->intersect(objectRays);
+		for(int j = 0; j < numRays; j++)
+			if(objectRays.hit[j] >= 0)
+				packet.recordHit(rays[j], objectRays.t[j], i);
+	});
+
+	for(int i = 0; i < packet.size; i++)
+	{
+		nodes[i] = (packet.hit[i] >= 0) ? instances[packet.hit[i]].node : 0;
+		if(nodes[i])
+		{
+			const Instance &instance = instances[packet.hit[i]];
+			getNormals(instance, packet.getRay(i).transformed(instance.worldInverse), normals[i], faceNormals[i]);
+		}
+	}
+}
+
+void SceneGraph::getNormals(const Instance &instance, const Ray &objectRay, vec3 &normal, vec3 &faceNormal)
+{
+	// Only the one instance that was hit needs to work out its normal, so intersect it again for that rather than making every
+	// test along the way do it. The normals come back out of object space through the inverse transpose. (Callers bring the ray
+	// into object space themselves, so a world-space ray only made to be transformed never has to go through memory to get here.)
+	vec3 objectNormal, objectFaceNormal;
+	instance.geo->intersect(objectRay, objectNormal, objectFaceNormal);
+	glm::mat3 normalMatrix = glm::transpose(glm::mat3(instance.worldInverse));
+	normal = glm::normalize(normalMatrix * objectNormal);
+	faceNormal = glm::normalize(normalMatrix * objectFaceNormal);
+}
+
+bool SceneGraph::occluded(const Ray &ray)
+{
+	return bvh.anyHit(ray, [&](int i) -> double {
+		return intersectInstance(instances[i], ray);
+	});
+}
+
+bool SceneGraph::occluded(const vec3 &p0, const vec3 &v0, double tMax)
+{
+	return occluded(Ray(p0, glm::normalize(v0), 0, (float)tMax));
+}
@@ -10,12 +10,14 @@
 #pragma once
 
 #include <vector>
+#include "OpenGL.h"
 #include "../glm/glm.hpp"
 #include "../glm/gtc/matrix_transform.hpp"
 
 #include "AbstractGeometryItem.h"
 #include "ExceptionClasses.h" // not using this yet in SceneGraph
 #include "Drawing.h"
+#include "BVH.h"
 
 
 using glm::mat4;
@@ -41,6 +43,8 @@ public:
 		{ 
 			selected = false;
 			yTrans = 0.0;	
+			parent = 0;
+			dirty = true;
 		}
 
 		~Node() { // Destructor deallocates all child nodes.
@@ -53,6 +57,8 @@ public:
 		// this Node. It will deallocate all children upon destruction.
 		void addChild(Node *child) {
 			children.push_back(child);
+			child->parent = this;
+			child->setDirty(); // its world transform now goes through ours
 		}
 
 		//Used to translate the Scenegraph Node up by the appropriate amount
@@ -68,16 +74,7 @@ public:
 		//		on to its children in similar fashion
 		void draw(mat4 parentTransform)
 		{
-			//construct temporary matrix using stored values
-			mat4 scaleMat = glm::scale(mat4(1.0f), scalings);
-			mat4 rotXMat = glm::rotate(mat4(1.0f), rotations.x, vec3(1,0,0));
-			mat4 rotYMat = glm::rotate(mat4(1.0f), rotations.y, vec3(0,1,0));
-			mat4 rotZMat = glm::rotate(mat4(1.0f), rotations.z, vec3(0,0,1));
-			mat4 transMat = glm::translate(mat4(1.0f), translations);
-
-			mat4 transform = transMat * rotZMat * rotYMat * rotXMat * scaleMat;
-			
-			mat4 composition = parentTransform * transform;
+			mat4 composition = parentTransform * getTransform();
 
 			if(geo)
 			{			
@@ -94,29 +91,57 @@ public:
 				children[i]->draw(composition);
 		}
 
+		// Cached transformations, rebuilt (for this node and everything under it) only after one of the setters below changes something.
+		// getTransform() is this node's own transformation; the others are relative to the head of the scene graph (i.e. world space),
+		// for raytracing against the node's geometry without inverting a matrix per ray:
+		//	getWorldInverse() is what the ray*Intersect() functions take as tInv, and getWorldInverseStar() is that same matrix with
+		//	its translation zeroed out, which is what transforms ray directions.
+		// Note that these update lazily, so call SceneGraph::updateTransforms() before handing the graph to multiple threads.
+		const mat4& getTransform() {update(); return transform;}
+		const mat4& getWorldTransform() {update(); return worldTransform;}
+		const mat4& getWorldInverse() {update(); return worldInverse;}
+		const mat4& getWorldInverseStar() {update(); return worldInverseStar;}
+
+		// Brings the cached transformations for this node and all of its children up to date
+		void updateTransforms()
+		{
+			update();
+			for(size_t i = 0; i < children.size(); i++)
+				children[i]->updateTransforms();
+		}
+
+		// Appends every node in this subtree (including this one) that has geometry to nodes
+		void collectGeometryNodes(std::vector<Node*> &nodes)
+		{
+			if(geo)
+				nodes.push_back(this);
+			for(size_t i = 0; i < children.size(); i++)
+				children[i]->collectGeometryNodes(nodes);
+		}
+
 		void setSelected(bool s) {selected = s;}
 		bool getSelected() {return selected;}
 		int getRotationDegreesY() {return rotations.y;}
-		void setRotationDegreesY(int r) {rotations.y = r;}
+		void setRotationDegreesY(int r) {rotations.y = r; setDirty();}
 		float getScalingX() {return scalings.x;}
-		void setScalingX(float s) {scalings.x = s;}
+		void setScalingX(float s) {scalings.x = s; setDirty();}
 		float getScalingY() {return scalings.y;}
-		void setScalingY(float s) {scalings.y = s;}
+		void setScalingY(float s) {scalings.y = s; setDirty();}
 		float getScalingZ() {return scalings.z;}
-		void setScalingZ(float s) {scalings.z = s;}
+		void setScalingZ(float s) {scalings.z = s; setDirty();}
 		float getTranslationX() {return translations.x;}
-		void setTranslationX(float t) {translations.x = t;}
+		void setTranslationX(float t) {translations.x = t; setDirty();}
 		float getTranslationY() {return translations.y;}
-		void setTranslationY(float t) {translations.y = t;}
+		void setTranslationY(float t) {translations.y = t; setDirty();}
 		float getTranslationZ() {return translations.z;}
-		void setTranslationZ(float t) {translations.z = t;}
+		void setTranslationZ(float t) {translations.z = t; setDirty();}
 
 		AbstractGeometryItem* getGeometry() { return geo; }
 
 
 	private:
 		AbstractGeometryItem *geo; // null if this is a transformation-only node
-		//mat4 transform;
+		Node *parent; // null for the head
 		std::vector<Node*> children; // empty if this is a leaf
 		bool selected;
 		float yTrans;
@@ -126,6 +151,40 @@ public:
 		vec3 rotations;
 		vec3 translations;
 		vec3 scalings;
+
+		// Cached matrices built from the above (see getTransform() etc.); only valid when dirty is false
+		bool dirty;
+		mat4 transform;
+		mat4 worldTransform, worldInverse, worldInverseStar;
+
+		// Marks this node's cached matrices as stale, along with all of its descendants' (since their world transforms include ours)
+		void setDirty()
+		{
+			if(dirty) return; // children were already marked when we were
+			dirty = true;
+			for(size_t i = 0; i < children.size(); i++)
+				children[i]->setDirty();
+		}
+
+		// Rebuilds the cached matrices if they're stale
+		void update()
+		{
+			if(!dirty) return;
+
+			mat4 scaleMat = glm::scale(mat4(1.0f), scalings);
+			mat4 rotXMat = glm::rotate(mat4(1.0f), rotations.x, vec3(1,0,0));
+			mat4 rotYMat = glm::rotate(mat4(1.0f), rotations.y, vec3(0,1,0));
+			mat4 rotZMat = glm::rotate(mat4(1.0f), rotations.z, vec3(0,0,1));
+			mat4 transMat = glm::translate(mat4(1.0f), translations);
+
+			transform = transMat * rotZMat * rotYMat * rotXMat * scaleMat;
+			worldTransform = parent ? parent->getWorldTransform() * transform : transform;
+			worldInverse = glm::inverse(worldTransform);
+			worldInverseStar = worldInverse;
+			worldInverseStar[3][0] = worldInverseStar[3][1] = worldInverseStar[3][2] = 0;
+
+			dirty = false;
+		}
 	};
 
 	// Constructor
@@ -148,6 +207,9 @@ public:
 	// Removes all nodes from the scene graph, leaving just the head node.
 	void clear()
 	{
+		bvh.clear();
+		instances.clear();
+
 		delete head;
 		head = new Node(0, vec3(0,0,0), vec3(0,0,0), vec3(1,1,1)); // null geometry, identity transformations
 	}
@@ -168,11 +230,73 @@ public:
 		head->draw(m);
 	}
 
+	// Brings every node's cached world transformations up to date (see Node::getWorldTransform())
+	void updateTransforms()
+	{
+		head->updateTransforms();
+	}
+
+	// Appends every node in the scene that has geometry to nodes (preorder, as drawn)
+	void collectGeometryNodes(std::vector<Node*> &nodes)
+	{
+		head->collectGeometryNodes(nodes);
+	}
+
+	// ** Raytracing **
+	// Builds the top-level bounding volume hierarchy over the world-space bounds of every node with geometry (updating all the nodes'
+	// cached transformations on the way). This needs to be called again whenever nodes are added or moved, before raytracing.
+	void buildBVH();
+
+	// Finds the closest intersection of a (world-space) ray with the scene, within its [tMin, tMax]. Returns the node that was hit,
+	// with the distance to it (in units of the ray's direction) in t, or null if nothing was hit.
+	Node* intersect(const Ray &ray, double &t);
+	// The same, but also gives the (unit length, world-space) normal of the surface hit, for shading.
+	Node* intersect(const Ray &ray, double &t, vec3 &normal);
+	// The same, with the (unit length, world-space) normal of the surface actually hit in faceNormal too, for starting secondary rays
+	// off it. This is only different from normal where that's smoothed (see AbstractGeometryItem::intersect()).
+	Node* intersect(const Ray &ray, double &t, vec3 &normal, vec3 &faceNormal);
+	// The same for the ray from p0 along v0, with t in units of normalized v0.
+	Node* intersect(const vec3 &p0, const vec3 &v0, double &t);
+	Node* intersect(const vec3 &p0, const vec3 &v0, double &t, vec3 &normal);
+
+	// The same for every ray in packet at once (see BVH::closestHits()), for coherent rays like primary rays. The directions must be
+	// unit length. Gives each ray's distance to the closest hit in packet.t, and the node it hit (or null) in nodes[i] and the normals
+	// there in normals[i] and faceNormals[i], which need room for packet.size each.
+	void intersect(RayPacket &packet, Node **nodes, vec3 *normals, vec3 *faceNormals);
+
+	// Returns true if anything in the scene lies along the ray within its [tMin, tMax), e.g. for shadow rays.
+	bool occluded(const Ray &ray);
+	// The same for the ray from p0 along v0, up to tMax (in units of normalized v0).
+	bool occluded(const vec3 &p0, const vec3 &v0, double tMax);
+
 	
 
 private:
 	Node *head;
 
+	// Raytracing works on two levels: each geometry item has its own (bottom-level) BVH over its parts or triangles in object space,
+	// built once per item no matter how many nodes use it, and the scene has a (top-level) BVH over instances - one per node with
+	// geometry - that only needs to know how to get a ray into the instance's object space.
+	struct Instance
+	{
+		glm::mat4x3 worldInverse; // the node's cached world inverse (its bottom row is always 0 0 0 1, so we leave it off)
+		AbstractGeometryItem *geo;
+		Node *node;
+	};
+
+	BVH bvh;
+	std::vector<Instance> instances; // primitive i in bvh is instances[i]
+
+	double intersectInstance(const Instance &instance, const Ray &ray)
+	{
+		return instance.geo->intersect(ray.transformed(instance.worldInverse));
+	}
+
+	// Index of the closest instance hit, or -1
+	int closestInstance(const Ray &ray, double &t);
+	// The (unit length, world-space) normal and face normal where the ray, already brought into instance's object space, hits it
+	void getNormals(const Instance &instance, const Ray &objectRay, vec3 &normal, vec3 &faceNormal);
+
 	// Copy constructor - SceneGraphs should not be copied
 	SceneGraph(const SceneGraph &s)
 	{
@@ -0,0 +1,578 @@
+#include "SceneLoader.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "Triangulate.h"
+
+void SceneLoader::initialize(AttribLocations attribs)
+{
+	SceneLoader::attribs = attribs;
+
+	floorBox.initialize(vec3(0,1,0)); // green
+	furnitureBox.initialize(vec3(1,1,0)); // yellow
+	table.initialize(vec3(1,0,0)); // red
+	chair.initialize(vec3(0,0,1)); // blue
+}
+
+void SceneLoader::load(SceneGraph &scene, std::string fileName)
+{
+	
+	//The way stacking works: 
+	/*
+	The yScale of each piece of geometry is recorded as that geometry's yScale.
+	That geometry is given to a SceneGraph Node which is then added as a child
+		to furnitureRoot. 
+	FurnitureRoot is a childNode of floor.
+	Floor is a child of Scene, which is a member of MyGlWidget.
+	An object itself shouldn't know it's height. In local space, an object only knows it's size.
+	We should set an objects yTransformation out here in Paint (or in this func) where we can see the location of all 
+		the objects. If we see that an object is over another object, we should set its yTrans
+		equal to it's parent's yTrans + it's parent's scaled height.
+
+
+	//Drawing:
+	Then, when you call scene.draw(), it calls head->draw() (Where head is the topmost node)
+	That first transforms the same as it's parent's transformation, and then also transforms by
+		the transformation that you pass into it in the Node() constructor.
+	Then it calls draw() on its geometry. This draw function is virtual and routes to
+		the draw function contained in the class that matches the type of geometry calling draw()
+	That draw function will transform a box into whatever position it needs to be in in local 
+		space and then call the most basic Draw() function (member of GeometryItem), which
+		takes the VBO, NBO and IBO into account and sends all the information into the shader.
+	*/
+
+	
+	
+	// Clear the scene, in case there's already something there (and the meshes and objects from it - the scene's nodes are gone now)
+	scene.clear();
+	objects.clear();
+	meshes.clear();
+
+	// Mesh file names are relative to the scene file
+	std::string directory = fileName.substr(0, fileName.find_last_of("/\\") + 1);
+
+	TextScanner file;
+	if(!file.open(fileName))
+	{
+		SceneGraphException ex;
+		ex.reason = "SceneGraph: can't open scene description \"" + fileName + "\"!";
+		throw ex;
+	}
+
+	try
+	{
+		int floorXSize = file.readInt("the floor's x size", 1);
+		int floorZSize = file.readInt("the floor's z size", 1);
+		int numItems = file.readInt("the number of items", 0);
+
+		// Start our tree at the floor
+		/*mat4 scene_rotx = glm::rotate(mat4(1.0f), 0.0f, vec3(1.0f, 0.0f, 0.0f));
+		mat4 scene_roty = glm::rotate(mat4(1.0f), 0.0f, vec3(0.0f, 1.0f, 0.0f));
+		mat4 scene_rotz = glm::rotate(mat4(1.0f), 0.0f, vec3(0.0f, 0.0f, 1.0f));
+		mat4 scene_scale = glm::scale(mat4(1.0f), vec3(2, 2, 2));
+		mat4 floorScale = glm::scale(mat4(1.0f), vec3((float)floorXSize, 0.1f, (float)floorZSize));
+		mat4 floorTransform = scene_rotz * scene_roty * scene_rotx * scene_scale * floorScale;*/
+		//construct vectors to store transformation values in node
+		SceneGraph::Node *floor = new SceneGraph::Node(&floorBox, vec3(0,0,0), vec3(0,0,0), vec3(2*(float)floorXSize,2*0.1f,2*(float)floorZSize));
+		// But, we need to send up the camera matrix as a root node above the floor, so make the floor a child of that.
+		//SceneGraph::Node *root = new SceneGraph::Node(0, camera);
+		//scene.addChildToHead(root);
+		//root->addChild(floor);
+		scene.addChildToHead(floor);
+
+		// Add a transformation node to reverse the floor's scaling, and place items on top of the floor
+		// This will be the immediate parent for all floor-level furniture items.
+		//floorTransform = glm::scale(floorTransform, vec3(2, 2, 2));
+		//floorTransform = glm::inverse(floorScale) * floorTransform;
+		//SceneGraph::Node *furnitureRoot = new SceneGraph::Node(0, glm::inverse(floorScale) * onFloor_trans);
+		SceneGraph::Node *furnitureRoot = new SceneGraph::Node(0, vec3(0,0,0), vec3(0,0.55,0), vec3(1/((float)floorXSize), 1/(0.1f), 1/((float)floorZSize)));
+		floor->addChild(furnitureRoot);
+
+
+		// Add walls around the edges of the floor
+		/*mat4 frontWall_scale = glm::scale(mat4(1.0f), vec3(floorXSize, WALL_HEIGHT, 0.1));
+		mat4 frontWall_trans = glm::translate(mat4(1.0f), vec3(0, WALL_HEIGHT*.5, (floorZSize*.5)+0.05));
+		furnitureRoot->addChild(new SceneGraph::Node(&box, frontWall_trans * frontWall_scale));
+		mat4 backWall_trans = glm::translate(mat4(1.0f), vec3(0, WALL_HEIGHT*.5, -((floorZSize*.5)+0.05)));
+		furnitureRoot->addChild(new SceneGraph::Node(&box, backWall_trans * frontWall_scale));
+		mat4 leftWall_scale = glm::scale(mat4(1.0f), vec3(0.1f, WALL_HEIGHT, floorZSize));
+		mat4 leftWall_trans = glm::translate(mat4(1.0f), vec3((floorXSize*.5f)+0.05, WALL_HEIGHT*.5f, 0));
+		furnitureRoot->addChild(new SceneGraph::Node(&box, leftWall_trans * leftWall_scale));
+		mat4 rightWall_trans = glm::translate(mat4(1.0f), vec3(-((floorXSize*.5f)+0.05), WALL_HEIGHT*.5f, 0));
+		furnitureRoot->addChild(new SceneGraph::Node(&box, rightWall_trans * leftWall_scale));
+*/
+		// Read in the furniture from the file and build the scene graph
+		// First off, we need to keep track of what the "stacking level" is at each grid location:
+		std::vector<std::vector<float>> stackingLevels(floorXSize, std::vector<float>(floorZSize, 0.0f));
+		// Likewise, we're going to need another array to keep track of the "top" item at each grid location
+		// (a null pointer means the grid location is empty):
+		std::vector<std::vector<SceneGraph::Node*>> stackingItems(floorXSize, std::vector<SceneGraph::Node*>(floorZSize, 0));
+
+		// Read in all the items first, so we can build all the meshes (which can take a while, if they're subdivided) at once
+		struct SceneItem
+		{
+			std::string meshFileName; // (only for meshes)
+			int meshNumSubdivides;
+			int xIndex, zIndex;
+			float rotation;
+			float xScale, yScale, zScale;
+			AbstractGeometryItem *geo;
+		};
+		std::vector<SceneItem> items(numItems);
+		std::vector<SceneItem*> meshItems;
+		for(int item = 0; item < numItems; item++)
+		{
+			SceneItem &thisItem = items[item];
+
+			TextScanner::Word type = file.readWord("a furniture type");
+			if(type == "box")
+			{
+				thisItem.geo = &furnitureBox;
+			}
+			else if(type == "chair")
+			{
+				thisItem.geo = &chair;
+			}
+			else if(type == "table")
+			{
+				thisItem.geo = &table;
+			}
+			else if(type == "mesh")
+			{
+				thisItem.meshFileName = file.readWord("a geometry description file name").str();
+				thisItem.meshNumSubdivides = file.readInt("the number of subdivisions", 0);
+				meshItems.push_back(&thisItem);
+			}
+			else
+				file.fail("invalid furniture type \"" + type.str() + "\"");
+
+			thisItem.xIndex = file.readInt("the item's x grid index", 0, floorXSize - 1);
+			thisItem.zIndex = file.readInt("the item's z grid index", 0, floorZSize - 1);
+			thisItem.rotation = file.readFloat("the item's rotation");
+			thisItem.xScale = file.readFloat("the item's x scale");
+			thisItem.yScale = file.readFloat("the item's y scale");
+			thisItem.zScale = file.readFloat("the item's z scale");
+		}
+		file.close();
+
+		// Find the meshes we already have, and work out which ones we need to build (each only once, however many items use it)
+		std::map<GeometryCache::Key, std::shared_ptr<Mesh>> sceneMeshes;
+		std::vector<std::pair<GeometryCache::Key, std::shared_ptr<Mesh>>> newMeshes;
+		for(size_t i = 0; i < meshItems.size(); i++)
+		{
+			const std::string &meshFileName = meshItems[i]->meshFileName;
+			bool absolutePath = meshFileName[0] == '/' || meshFileName[0] == '\\' || (meshFileName.size() > 1 && meshFileName[1] == ':');
+			std::string path = absolutePath ? meshFileName : directory + meshFileName;
+
+			GeometryCache::Key key;
+			if(!GeometryCache::makeKey(path, meshItems[i]->meshNumSubdivides, key))
+			{
+				MeshException ex;
+				ex.reason = "Mesh: can't open geometry description \"" + path + "\"!";
+				throw ex;
+			}
+
+			std::shared_ptr<Mesh> &mesh = sceneMeshes[key];
+			if(!mesh)
+			{
+				mesh = geometryCache.find(key);
+				if(!mesh)
+				{
+					mesh = std::make_shared<Mesh>();
+					newMeshes.push_back(std::make_pair(key, mesh));
+				}
+				meshes.push_back(mesh);
+			}
+			meshItems[i]->geo = mesh.get();
+		}
+
+		// Each mesh only touches itself while it's being built, so build them all concurrently. Buffering has to happen on this thread
+		// (the one with the GL context), though, so that waits until they're all done - and so do any exceptions building them threw.
+		// Only meshes that were built successfully go into the cache.
+		std::vector<std::exception_ptr> meshErrors(newMeshes.size());
+		parallelFor(0, newMeshes.size(), [&](size_t i) {
+			try
+			{
+				const GeometryCache::Key &key = newMeshes[i].first;
+				buildMesh(*newMeshes[i].second, key.path, key.numSubdivides);
+			}
+			catch(...)
+			{
+				meshErrors[i] = std::current_exception();
+			}
+		}, 1);
+		for(size_t i = 0; i < newMeshes.size(); i++)
+		{
+			if(meshErrors[i])
+				std::rethrow_exception(meshErrors[i]);
+			newMeshes[i].second->bufferData(attribs);
+			geometryCache.insert(newMeshes[i].first, newMeshes[i].second);
+		}
+
+		// Build the scene
+		for(int item = 0; item < numItems; item++)
+		{
+			int xIndex = items[item].xIndex, zIndex = items[item].zIndex;
+			float rotation = items[item].rotation;
+			float xScale = items[item].xScale, yScale = items[item].yScale, zScale = items[item].zScale;
+			AbstractGeometryItem *geo = items[item].geo;
+			
+			// For the translation, first we need to determine where this item's grid position is in world space.
+			// For simplicity, we'll define our grid to be a floorXSize-by-floorZSize "square" in the x-z plane, centered
+			// at the origin. The grid point 0,0 will be at (-floorXSize*.5f, -floorZSize*.5f) in world space.
+			//mat4 trans_grid = glm::translate(mat4(1.0f), vec3(-((float)floorXSize)/2.0f + xIndex, 0.0f, -((float)floorZSize)/2.0f + zIndex));
+			//// Now, we need to position the item vertically, on top of any previous items in its grid location.
+			//mat4 trans_y = glm::translate(mat4(1.0f), vec3(0.0f, stackingLevels[xIndex][zIndex], 0.0f)); // 0.5 is a hardcoded hack, specific to current furniture - need to change this
+			//// Rotate and scale
+			//mat4 trans_rot = glm::rotate(mat4(1.0f), rotation, vec3(0.0f, 1.0f, 0.0f)); // rotation is about the y-axis
+			//mat4 trans_scale = glm::scale(mat4(1.0f), vec3(xScale, yScale, zScale));
+			vec3 gridTranslation(-((float)floorXSize)/2.0f + xIndex, 0.5f, -((float)floorZSize)/2.0f + zIndex);
+			
+			stackingLevels[xIndex][zIndex] += geo->getUnitHeight()*yScale;
+			//stackingLevels[xIndex][zIndex] = 0.0f;
+
+			SceneGraph::Node *thisItem = 0;
+
+			// Add the furniture item as a child node of whatever's under it on its grid location.
+			// If there's nothing under it, we will make it a child of the furniture root.
+			if(stackingItems[xIndex][zIndex] == 0)
+			{
+				thisItem = new SceneGraph::Node(geo, vec3(0,rotation,0), gridTranslation, vec3(xScale, yScale, zScale));
+				furnitureRoot->addChild(thisItem);
+			}
+			else //if there's geometry at this spot already.
+			{
+				SceneGraph::Node *baseNode = stackingItems[xIndex][zIndex];
+				AbstractGeometryItem *baseGeo = baseNode->getGeometry();
+				float stackingHeight = (.5*baseGeo->getUnitHeight()*baseNode->getScalingY()) + (.5*geo->getUnitHeight()*yScale);
+				thisItem = new SceneGraph::Node(geo, vec3(0,rotation,0), vec3(0,stackingHeight,0), vec3(xScale, yScale, zScale));
+				stackingItems[xIndex][zIndex]->addChild(thisItem);
+			}
+			stackingItems[xIndex][zIndex] = thisItem;
+
+			
+			//as of right now, i'm only having "furniture roots" be selectable until we get stacking working
+			objects.push_back(thisItem);
+		}
+	}
+	catch(ParseException &failure)
+	{
+		SceneGraphException ex;
+		ex.reason = "SceneGraph: " + failure.reason;
+		throw ex;
+	}
+}
+
+void SceneLoader::parseGeometryDescription(Mesh &mesh, std::string fileName, int numSubdivides)
+{
+	buildMesh(mesh, fileName, numSubdivides);
+	mesh.bufferData(attribs);
+}
+
+void SceneLoader::buildMesh(Mesh &mesh, std::string filename, int numSubdivides)
+{
+	mesh.clear();
+
+	// Read in the polygon description from file
+	TextScanner inputFile;
+	if(!inputFile.open(filename))
+	{
+		MeshException ex;
+		ex.reason = "Mesh: can't open geometry description \"" + filename + "\"!";
+		throw ex;
+	}
+
+	try
+	{
+		buildMesh(mesh, inputFile);
+	}
+	catch(ParseException &failure)
+	{
+		MeshException ex;
+		ex.reason = "Mesh: " + failure.reason;
+		throw ex;
+	}
+
+	mesh.subDivide(numSubdivides);
+}
+
+// Revolves profile (a polyline in the x-y plane, with x >= 0) around the y axis in numSlices slices, writing the vertices, their
+// normals, and the triangles straight into the arrays of an indexed mesh (see Mesh::setIndexedTriangles()) in one pass. Points on
+// the axis are a single vertex, where the triangles of each slice meet. If the profile doesn't start or end on the axis, it's
+// extended to it, to cap the surface off - unless it ends where it starts, in which case it's a closed loop (e.g. a torus's).
+// The normals come from the profile itself: each segment's normal, revolved, averaged with the next segment's where they meet.
+static void buildSurfaceOfRevolution(Mesh &mesh, std::vector<glm::vec2> &profile, int numSlices)
+{
+	// Repeated points would make empty slices
+	profile.erase(std::unique(profile.begin(), profile.end()), profile.end());
+	bool closed = profile.size() > 3 && profile.front() == profile.back();
+	if(closed)
+		profile.pop_back();
+	else if(!profile.empty())
+	{
+		if(profile.front().x != 0.0f)
+			profile.insert(profile.begin(), glm::vec2(0, profile.front().y));
+		if(profile.back().x != 0.0f)
+			profile.push_back(glm::vec2(0, profile.back().y));
+	}
+	if(profile.size() < 2)
+		return;
+
+	// Go around the profile counterclockwise (closing it along the axis if it's open), so the outside is always to the right
+	float area = 0;
+	for(size_t i = 0; i < profile.size(); i++)
+	{
+		const glm::vec2 &p = profile[i], &q = profile[(i + 1) % profile.size()];
+		area += p.x * q.y - q.x * p.y;
+	}
+	if(area < 0)
+		std::reverse(profile.begin(), profile.end());
+
+	// Segment k runs from point k to point k + 1 (wrapping around to point 0 if the profile is closed). A segment along the axis
+	// sweeps out nothing, so it has no normal (and no triangles).
+	size_t numProfilePoints = profile.size(), numSegments = closed ? numProfilePoints : numProfilePoints - 1;
+	std::vector<bool> onAxis(numProfilePoints);
+	for(size_t k = 0; k < numProfilePoints; k++)
+		onAxis[k] = profile[k].x == 0.0f;
+	std::vector<glm::vec2> segmentNormals(numSegments);
+	for(size_t k = 0; k < numSegments; k++)
+	{
+		size_t next = (k + 1) % numProfilePoints;
+		glm::vec2 d = profile[next] - profile[k];
+		segmentNormals[k] = (onAxis[k] && onAxis[next]) ? glm::vec2(0, 0) : glm::normalize(glm::vec2(d.y, -d.x));
+	}
+
+	// Where each point's vertices and each segment's triangles start: a point on the axis has one vertex and a point off it has one
+	// per slice, and each slice of a segment has a triangle for each end that's off the axis
+	std::vector<size_t> firstVertex(numProfilePoints + 1), firstIndex(numSegments + 1);
+	for(size_t k = 0; k < numProfilePoints; k++)
+		firstVertex[k + 1] = firstVertex[k] + (onAxis[k] ? 1 : numSlices);
+	for(size_t k = 0; k < numSegments; k++)
+	{
+		size_t next = (k + 1) % numProfilePoints;
+		size_t numTriangles = (onAxis[k] && onAxis[next]) ? 0 : (size_t)numSlices * (!onAxis[k] + !onAxis[next]);
+		firstIndex[k + 1] = firstIndex[k] + 3 * numTriangles;
+	}
+	if(firstVertex[numProfilePoints] > UINT_MAX || firstIndex[numSegments] > UINT_MAX)
+	{
+		MeshException ex;
+		ex.reason = "Mesh: too many slices and points in surface of revolution!";
+		throw ex;
+	}
+
+	std::vector<float> sines(numSlices), cosines(numSlices);
+	for(int s = 0; s < numSlices; s++)
+	{
+		double angle = 2 * 3.14159265358979323846 * s / numSlices;
+		sines[s] = (float)sin(angle);
+		cosines[s] = (float)cos(angle);
+	}
+
+	// Revolving about y by an angle takes (x, y, 0) to (x cos(angle), y, -x sin(angle)) - for points and normals alike
+	std::vector<vec3> positions(firstVertex[numProfilePoints]), normals(firstVertex[numProfilePoints]);
+	for(size_t k = 0; k < numProfilePoints; k++)
+	{
+		glm::vec2 normal(0, 0);
+		if(k < numSegments)
+			normal += segmentNormals[k];
+		if(k > 0 || closed)
+			normal += segmentNormals[(k + numSegments - 1) % numSegments];
+		if(normal != glm::vec2(0, 0))
+			normal = glm::normalize(normal);
+
+		const glm::vec2 &p = profile[k];
+		if(onAxis[k])
+		{
+			// The only normal that works for every slice at once is along the axis
+			positions[firstVertex[k]] = vec3(0, p.y, 0);
+			normals[firstVertex[k]] = vec3(0, (normal.y > 0) ? 1.0f : (normal.y < 0) ? -1.0f : 0.0f, 0);
+			continue;
+		}
+		for(int s = 0; s < numSlices; s++)
+		{
+			positions[firstVertex[k] + s] = vec3(p.x * cosines[s], p.y, -p.x * sines[s]);
+			normals[firstVertex[k] + s] = vec3(normal.x * cosines[s], normal.y, -normal.x * sines[s]);
+		}
+	}
+
+	// Each slice of a segment is a quad - A and B at the start of the segment at the slice's two angles, and C and D at the end of
+	// it - cut into triangles ABC and ACD, either of which is left out when its first two corners are the same point on the axis
+	std::vector<unsigned> indices(firstIndex[numSegments]);
+	for(size_t k = 0; k < numSegments; k++)
+	{
+		size_t next = (k + 1) % numProfilePoints;
+		if(onAxis[k] && onAxis[next])
+			continue;
+		unsigned *index = &indices[firstIndex[k]];
+		for(int s = 0; s < numSlices; s++)
+		{
+			int s1 = (s + 1) % numSlices;
+			unsigned A = firstVertex[k] + (onAxis[k] ? 0 : s), B = firstVertex[k] + (onAxis[k] ? 0 : s1);
+			unsigned C = firstVertex[next] + (onAxis[next] ? 0 : s1), D = firstVertex[next] + (onAxis[next] ? 0 : s);
+			if(!onAxis[k])
+			{
+				*index++ = A;
+				*index++ = B;
+				*index++ = C;
+			}
+			if(!onAxis[next])
+			{
+				*index++ = A;
+				*index++ = C;
+				*index++ = D;
+			}
+		}
+	}
+
+	mesh.setIndexedTriangles(positions, normals, indices);
+}
+
+// The smallest angle between two side panels of an extrusion that's a crease, where each panel keeps its own normals, rather than a
+// bend that's shaded smoothly across; 45 degrees keeps the corners of rooms and furniture sharp and outlines of curves smooth.
+static const float EXTRUSION_CREASE_COSINE = 0.7071f;
+
+// Extrudes polygon (in the x-z plane, as x and z) along y, from -height/2 to height/2, writing the vertices, their normals, and the
+// triangles straight into the arrays of an indexed mesh (see Mesh::setIndexedTriangles()). The polygon may be convex or not; its
+// endcaps are cut into triangles by triangulatePolygon(), and have vertices of their own, with normals straight down and up. The
+// side panels share vertices where they meet at a bend, and each have their own where they meet at a crease.
+static void buildExtrusion(Mesh &mesh, std::vector<glm::vec2> &polygon, float height)
+{
+	// Repeated points would make empty panels
+	polygon.erase(std::unique(polygon.begin(), polygon.end()), polygon.end());
+	if(polygon.size() > 1 && polygon.front() == polygon.back())
+		polygon.pop_back();
+	if(polygon.size() < 3)
+		return; // nothing to extrude - there should be at least 3 points, if the input was correct
+
+	// Go around the polygon so that it's counterclockwise seen from above (+y) - which is clockwise as x, z coordinates - so the
+	// triangles of the top endcap face up as they come from triangulatePolygon(), and the outside of each panel is to the right
+	float area = 0;
+	for(size_t i = 0; i < polygon.size(); i++)
+	{
+		const glm::vec2 &p = polygon[i], &q = polygon[(i + 1) % polygon.size()];
+		area += p.x * q.y - q.x * p.y;
+	}
+	if(area > 0)
+		std::reverse(polygon.begin(), polygon.end());
+
+	// Panel i runs from point i to point i + 1
+	size_t numPoints = polygon.size();
+	std::vector<vec3> panelNormals(numPoints);
+	for(size_t i = 0; i < numPoints; i++)
+	{
+		glm::vec2 d = polygon[(i + 1) % numPoints] - polygon[i];
+		panelNormals[i] = glm::normalize(vec3(-d.y, 0, d.x));
+	}
+
+	// Each point has a pair of side vertices (bottom, then top) for the panel ending there, and another for the panel starting
+	// there - the same pair, unless the panels meet at a crease - followed by the bottom endcap's vertices and the top's
+	std::vector<unsigned> endingPair(numPoints), startingPair(numPoints);
+	std::vector<bool> crease(numPoints);
+	unsigned numPairs = 0;
+	for(size_t i = 0; i < numPoints; i++)
+	{
+		crease[i] = glm::dot(panelNormals[(i + numPoints - 1) % numPoints], panelNormals[i]) < EXTRUSION_CREASE_COSINE;
+		endingPair[i] = numPairs;
+		startingPair[i] = crease[i] ? numPairs + 1 : numPairs;
+		numPairs += crease[i] ? 2 : 1;
+	}
+	unsigned firstBottomCap = 2 * numPairs, firstTopCap = firstBottomCap + numPoints;
+
+	std::vector<vec3> positions(firstTopCap + numPoints), normals(firstTopCap + numPoints);
+	for(size_t i = 0; i < numPoints; i++)
+	{
+		vec3 bottom(polygon[i].x, -0.5f * height, polygon[i].y), top(polygon[i].x, 0.5f * height, polygon[i].y);
+		const vec3 &before = panelNormals[(i + numPoints - 1) % numPoints], &after = panelNormals[i];
+
+		positions[2 * endingPair[i]] = positions[2 * startingPair[i]] = bottom;
+		positions[2 * endingPair[i] + 1] = positions[2 * startingPair[i] + 1] = top;
+		if(crease[i])
+		{
+			normals[2 * endingPair[i]] = normals[2 * endingPair[i] + 1] = before;
+			normals[2 * startingPair[i]] = normals[2 * startingPair[i] + 1] = after;
+		}
+		else
+			normals[2 * endingPair[i]] = normals[2 * endingPair[i] + 1] = glm::normalize(before + after);
+
+		positions[firstBottomCap + i] = bottom;
+		normals[firstBottomCap + i] = vec3(0, -1, 0);
+		positions[firstTopCap + i] = top;
+		normals[firstTopCap + i] = vec3(0, 1, 0);
+	}
+
+	// Each panel is a quad - A and B at the bottom of its start and end, and C and D at the top of its end and start - cut into
+	// triangles ABC and ACD. The endcaps' triangles are the polygon's: as they come on top, and turned over on the bottom.
+	std::vector<unsigned> capTriangles;
+	triangulatePolygon(polygon, capTriangles);
+
+	std::vector<unsigned> indices;
+	indices.reserve(6 * numPoints + 2 * capTriangles.size());
+	for(size_t i = 0; i < numPoints; i++)
+	{
+		unsigned A = 2 * startingPair[i], D = A + 1;
+		unsigned B = 2 * endingPair[(i + 1) % numPoints], C = B + 1;
+		unsigned panel[] = {A, B, C, A, C, D};
+		indices.insert(indices.end(), panel, panel + 6);
+	}
+	for(size_t t = 0; t < capTriangles.size(); t += 3)
+	{
+		unsigned top[] = {firstTopCap + capTriangles[t], firstTopCap + capTriangles[t + 1], firstTopCap + capTriangles[t + 2]};
+		unsigned bottom[] = {firstBottomCap + capTriangles[t], firstBottomCap + capTriangles[t + 2], firstBottomCap + capTriangles[t + 1]};
+		indices.insert(indices.end(), top, top + 3);
+		indices.insert(indices.end(), bottom, bottom + 3);
+	}
+
+	mesh.setIndexedTriangles(positions, normals, indices);
+}
+
+void SceneLoader::buildMesh(Mesh &mesh, TextScanner &inputFile)
+{
+	TextScanner::Word procedureType = inputFile.readWord("\"extrusion\" or \"surfrev\"");
+
+	if(procedureType == "extrusion")
+	{
+		float height = inputFile.readFloat("the extrusion's height");
+		int numPoints = inputFile.readInt("the number of points", 0);
+
+		std::vector<glm::vec2> polygon;
+		polygon.reserve(numPoints);
+		for(int i = 0; i < numPoints - 1; i++) // Note: loops one less time to skip repeated first point at end of input
+		{
+			glm::vec2 loc;
+			loc.x = inputFile.readFloat("a point's x coordinate");
+			loc.y = inputFile.readFloat("a point's z coordinate");
+
+			polygon.push_back(loc);
+		}
+		inputFile.close(); // (that's everything)
+
+		buildExtrusion(mesh, polygon, height);
+	}
+	else if(procedureType == "surfrev")
+	{
+		int numSlices = inputFile.readInt("the number of slices", 3); // (fewer would be flat)
+		int numPoints = inputFile.readInt("the number of points", 0);
+
+		std::vector<glm::vec2> profile;
+		profile.reserve(numPoints);
+		for(int i = 0; i < numPoints; i++)
+		{
+			glm::vec2 loc;
+			loc.x = inputFile.readFloat("a point's x coordinate");
+			loc.y = inputFile.readFloat("a point's y coordinate");
+
+			// x-coordinates may not be negative - clamp to [0, inf.)
+			if(loc.x < 0)
+				loc.x = 0;
+
+			profile.push_back(loc);
+		}
+		inputFile.close(); // (that's everything)
+
+		buildSurfaceOfRevolution(mesh, profile, numSlices);
+	}
+	else
+		inputFile.fail("expected \"extrusion\" or \"surfrev\", found \"" + procedureType.str() + "\"");
+}
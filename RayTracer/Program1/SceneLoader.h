@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <exception>
+
+#include "../glm/glm.hpp"
+
+#include "Drawing.h"
+#include "ExceptionClasses.h"
+#include "SceneGraph.h"
+#include "Box.h"
+#include "Table.h"
+#include "Chair.h"
+#include "Mesh.h"
+#include "GeometryCache.h"
+#include "TextScanner.h"
+#include "Parallel.h"
+
+using glm::vec3;
+
+// Builds scene graphs from scene description files (and the mesh description files those refer to), and owns the geometry items
+// the scenes are made of. Nothing here needs a GL context beyond what the geometry classes themselves need (see OpenGL.h), so the
+// same loader serves both MyGLWidget, which draws the scene, and the headless raytracer, which has no GL at all.
+class SceneLoader
+{
+public:
+	// Sets the colors of the geometry items scenes are built from, and keeps the shader attribute locations for buffering meshes.
+	// Must be called once before load() (from initializeGL() when drawing; headless programs can pass default AttribLocations).
+	void initialize(AttribLocations attribs);
+
+	// Clears scene and builds it from the scene description in fileName, stacking items that share a grid location on top of
+	// each other. The meshes the scene refers to are built concurrently (and then buffered on the calling thread) - once for each
+	// distinct file and number of subdivisions, with the results kept for later scenes too (see GeometryCache).
+	// Throws a SceneGraphException if the file can't be read or isn't a valid scene description (saying where it went wrong), or a
+	// MeshException if the same goes for a mesh it refers to.
+	void load(SceneGraph &scene, std::string fileName);
+
+	// Fills mesh from the extrusion (or surfrev) description in fileName, applies numSubdivides levels of Catmull-Clark subdivision
+	// to it, and buffers it. Throws a MeshException if the file can't be read or isn't a valid description (saying where it went wrong).
+	void parseGeometryDescription(Mesh &mesh, std::string fileName, int numSubdivides = 0);
+
+	// Nodes for the furniture items in the scene most recently loaded, in the order the file lists them
+	std::vector<SceneGraph::Node*>& getObjects() { return objects; }
+
+private:
+	AttribLocations attribs;
+
+	Box floorBox, furnitureBox;
+	Table table;
+	Chair chair;
+	GeometryCache geometryCache;
+	std::vector<std::shared_ptr<Mesh>> meshes; // the meshes the current scene uses, which its nodes point at (so they're kept alive here)
+
+	std::vector<SceneGraph::Node*> objects;
+
+	// parseGeometryDescription() without the buffering, which makes no GL calls (so it's safe to run on other threads)
+	void buildMesh(Mesh &mesh, std::string fileName, int numSubdivides);
+	// Builds mesh from the geometry description file being read (before any subdivision)
+	void buildMesh(Mesh &mesh, TextScanner &inputFile);
+};
@@ -11,46 +11,44 @@
 
 #include "../glm/gtc/matrix_transform.hpp"
 
-#include "AbstractGeometryItem.h"
-#include "Box.h"
+#include "BoxAssembly.h"
 
 using glm::mat4;
 using glm::vec3;
 using glm::scale;
 using glm::translate;
 
-class Table : public AbstractGeometryItem
+class Table : public BoxAssembly
 {
 public:
-	void initialize(vec3 tableColor)
-	{
-		box.initialize(tableColor);
-	}
-
-	// Pure virtual functions inherited from AbstractGeometryItem
-	virtual void draw(mat4 transform)
+	// Lays out the table's boxes
+	Table()
 	{
 		mat4 top_scale = scale(mat4(1.0f), vec3(1.0f, 0.2f, 1.0f));
 		mat4 top_tr = translate(mat4(1.0f), vec3(0.0f, 0.5f, 0.0f));
-		box.draw(transform * top_tr * top_scale);
+		addPart(top_tr * top_scale);
 
 		mat4 legTrans = scale(mat4(1.0f), vec3(0.05f, 1.0f, 0.05f));
 		mat4 frontLeftLegTrans = translate(mat4(1.0f), vec3(-0.475f, 0.0f, 0.475f));
 		mat4 frontRightLegTrans = translate(mat4(1.0f), vec3(0.475f, 0.0f, 0.475f));
 		mat4 backLeftLegTrans = translate(mat4(1.0f), vec3(-0.475f, 0.0f, -0.475));
 		mat4 backRightLegTrans = translate(mat4(1.0f), vec3(0.475f, 0.0f, -0.475f));
+		addPart(frontLeftLegTrans * legTrans);
+		addPart(frontRightLegTrans * legTrans);
+		addPart(backLeftLegTrans * legTrans);
+		addPart(backRightLegTrans * legTrans);
 
-		box.draw(transform * frontLeftLegTrans * legTrans);
-		box.draw(transform * frontRightLegTrans * legTrans);
-		box.draw(transform * backLeftLegTrans * legTrans);
-		box.draw(transform * backRightLegTrans * legTrans);
+		finishParts();
 	}
 
+	void initialize(vec3 tableColor)
+	{
+		box.initialize(tableColor);
+	}
+
+	// Pure virtual function inherited from AbstractGeometryItem (the rest are implemented by BoxAssembly)
 	virtual float getUnitHeight()
 	{
 		return 1.2; // the leg yScale is 1.0, the tabletop yScale is 0.2, so table height = 1.2 (cube height = 1)
 	}
-
-private:
-	Box box;
 };
\ No newline at end of file
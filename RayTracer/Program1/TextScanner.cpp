@@ -0,0 +1,199 @@
+#include "TextScanner.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cfloat>
+#include <sstream>
+
+// The longest number we'll convert; anything longer isn't one we could have written (and is reported as not a number)
+static const int MAX_NUMBER_LENGTH = 64;
+// The most of a bad token an error message quotes
+static const int MAX_QUOTED_LENGTH = 40;
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Converts a plain decimal number (digits, maybe a sign, a decimal point and an exponent) between begin and end the quick way, if it's
+// simple enough: with no more than 15 digits, the digits as an integer and the power of ten they're scaled by (if it's no more than 22)
+// are both exactly representable as doubles, so one correctly rounded multiplication or division gives exactly the double strtod()
+// would. Returns false, leaving it to strtod(), for anything else.
+static bool convertSimpleDecimal(const char *begin, const char *end, double &value)
+{
+	static const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	static const int MAX_DIGITS = 15, MAX_POWER = 22;
+
+	const char *c = begin;
+	bool negative = (c < end && *c == '-');
+	if(c < end && (*c == '-' || *c == '+'))
+		c++;
+
+	long long digits = 0;
+	int numDigits = 0, power = 0;
+	for(; c < end && *c >= '0' && *c <= '9'; c++, numDigits++)
+		digits = 10*digits + (*c - '0');
+	if(c < end && *c == '.')
+	{
+		for(c++; c < end && *c >= '0' && *c <= '9'; c++, numDigits++, power--)
+			digits = 10*digits + (*c - '0');
+	}
+	if(numDigits == 0 || numDigits > MAX_DIGITS)
+		return false;
+
+	if(c < end && (*c == 'e' || *c == 'E'))
+	{
+		c++;
+		bool negativeExponent = (c < end && *c == '-');
+		if(c < end && (*c == '-' || *c == '+'))
+			c++;
+		int exponent = 0, numExponentDigits = 0;
+		for(; c < end && *c >= '0' && *c <= '9' && numExponentDigits < 4; c++, numExponentDigits++)
+			exponent = 10*exponent + (*c - '0');
+		if(numExponentDigits == 0)
+			return false;
+		power += negativeExponent ? -exponent : exponent;
+	}
+	if(c != end || power < -MAX_POWER || power > MAX_POWER)
+		return false;
+
+	value = (power < 0) ? (double)digits / POWERS_OF_TEN[-power] : (double)digits * POWERS_OF_TEN[power];
+	if(negative)
+		value = -value;
+	return true;
+}
+
+bool TextScanner::Word::operator==(const char *s) const
+{
+	size_t length = strlen(s);
+	return (size_t)(end - begin) == length && memcmp(begin, s, length) == 0;
+}
+
+bool TextScanner::open(const std::string &fileName)
+{
+	TextScanner::fileName = fileName;
+	if(!file.open(fileName))
+		return false;
+
+	pos = lineStart = file.getData();
+	end = pos + file.getSize();
+	line = 1;
+	token.begin = token.end = pos;
+	tokenLine = tokenColumn = 1;
+	return true;
+}
+
+bool TextScanner::atEnd()
+{
+	next();
+	pos = token.begin; // (so the token is read again next time)
+	return token.begin == token.end;
+}
+
+void TextScanner::next()
+{
+	while(pos < end && isSpace(*pos))
+	{
+		if(*pos == '\n')
+		{
+			line++;
+			lineStart = pos + 1;
+		}
+		pos++;
+	}
+
+	token.begin = pos;
+	while(pos < end && !isSpace(*pos))
+		pos++;
+	token.end = pos;
+	tokenLine = line;
+	tokenColumn = (int)(token.begin - lineStart) + 1;
+}
+
+TextScanner::Word TextScanner::readWord(const char *what)
+{
+	next();
+	if(token.begin == token.end)
+		expected(what);
+	return token;
+}
+
+int TextScanner::readInt(const char *what, int min, int max)
+{
+	next();
+	char buffer[MAX_NUMBER_LENGTH + 1];
+	if(token.begin == token.end || !copyToken(buffer, sizeof(buffer)))
+		expected(what);
+
+	char *stop;
+	errno = 0;
+	long value = strtol(buffer, &stop, 10);
+	if(*stop != '\0')
+		expected(what);
+	if(errno == ERANGE || value < min || value > max)
+	{
+		std::ostringstream message;
+		message << what << " must be from " << min << " to " << max << ", not " << buffer;
+		fail(message.str());
+	}
+	return (int)value;
+}
+
+float TextScanner::readFloat(const char *what)
+{
+	next();
+	double value;
+	if(!convertSimpleDecimal(token.begin, token.end, value))
+	{
+		char buffer[MAX_NUMBER_LENGTH + 1];
+		if(token.begin == token.end || !copyToken(buffer, sizeof(buffer)))
+			expected(what);
+
+		// Only plain decimal numbers (strtod() would also take hexadecimal, infinities, and NaNs, depending on the library)
+		for(const char *c = buffer; *c; c++)
+			if(!strchr("0123456789+-.eE", *c))
+				expected(what);
+
+		char *stop;
+		value = strtod(buffer, &stop);
+		if(*stop != '\0')
+			expected(what);
+	}
+	if(value > FLT_MAX || value < -FLT_MAX)
+		fail(std::string(what) + " is too big: " + token.str());
+	return (float)value;
+}
+
+void TextScanner::fail(const std::string &message) const
+{
+	std::ostringstream reason;
+	reason << fileName << ":" << tokenLine << ":" << tokenColumn << ": " << message;
+
+	ParseException ex;
+	ex.reason = reason.str();
+	throw ex;
+}
+
+void TextScanner::expected(const char *what) const
+{
+	std::string message = std::string("expected ") + what + ", found ";
+	if(token.begin == token.end)
+		message += "the end of the file";
+	else if(token.end - token.begin > MAX_QUOTED_LENGTH)
+		message += "\"" + std::string(token.begin, token.begin + MAX_QUOTED_LENGTH) + "...\"";
+	else
+		message += "\"" + token.str() + "\"";
+	fail(message);
+}
+
+bool TextScanner::copyToken(char *buffer, size_t size) const
+{
+	size_t length = token.end - token.begin;
+	if(length >= size)
+		return false;
+	memcpy(buffer, token.begin, length);
+	buffer[length] = '\0';
+	return true;
+}
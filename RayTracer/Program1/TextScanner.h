@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <climits>
+
+#include "MappedFile.h"
+#include "ExceptionClasses.h"
+
+// Reads the whitespace-separated words and numbers that scene and geometry description files are made of, straight out of the
+// mapped file: words come back as pointers into it rather than strings, and numbers are converted from a copy on the stack, so
+// nothing is allocated per token. Anything that isn't what the caller asked for throws a ParseException giving the file, line and
+// column, and what was expected there.
+// Numbers are converted with strtol() and strtod() (strtof() isn't in VS2012's library), which go by the C locale - and the programs
+// never change that from the default, so a decimal point is always a '.'.
+class TextScanner
+{
+public:
+	// A word in the file, which is only valid while the file is open
+	struct Word
+	{
+		const char *begin, *end;
+
+		bool operator==(const char *s) const;
+		bool operator!=(const char *s) const {return !(*this == s);}
+		std::string str() const {return std::string(begin, end);}
+	};
+
+	TextScanner() : pos(0), end(0), lineStart(0), line(0), tokenLine(0), tokenColumn(0) {token.begin = token.end = 0;}
+
+	// Maps fileName to read from (replacing any file open before), and starts at its beginning. Returns false if it can't be opened.
+	bool open(const std::string &fileName);
+	void close() {file.close();}
+
+	// Each of these reads the next token, and throws a ParseException saying what was expected if it isn't one of the kind asked for.
+	// what describes the value, for the message (e.g. "the number of items").
+	Word readWord(const char *what);
+	int readInt(const char *what, int min = INT_MIN, int max = INT_MAX);
+	float readFloat(const char *what);
+
+	// Throws a ParseException saying message about the token read last
+	void fail(const std::string &message) const;
+
+	// True if there's nothing but whitespace left
+	bool atEnd();
+
+private:
+	MappedFile file;
+	std::string fileName;
+	const char *pos, *end;
+	const char *lineStart; // the start of the line pos is on
+	int line;
+
+	Word token; // the token read last, and where it starts
+	int tokenLine, tokenColumn;
+
+	// Reads the next token into token; it's empty at the end of the file
+	void next();
+	// Throws a ParseException saying what was expected instead of the token read last
+	void expected(const char *what) const;
+	// Copies the token read last into buffer, null-terminated, for the standard conversion functions; false if it doesn't fit
+	bool copyToken(char *buffer, size_t size) const;
+};
@@ -0,0 +1,315 @@
+#include "Triangulate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+// Twice the signed area of triangle abc: positive if a, b, c go counterclockwise, negative if clockwise, and 0 if they're in a line.
+// (In doubles, so the sign is right for any corners that aren't very nearly in a line.)
+static double turn(const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &c)
+{
+	return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+}
+
+// The polygon being triangulated, as a ring of its corners going counterclockwise (whichever way around it was given), with
+// the sweep line that goes down it while it's cut into y-monotone pieces
+struct PolygonRing
+{
+	const std::vector<glm::vec2> &points;
+	std::vector<unsigned> prev, next;
+	glm::vec2 sweep; // the corner the sweep line has got to
+
+	PolygonRing(const std::vector<glm::vec2> &points) : points(points), prev(points.size()), next(points.size()) {}
+
+	// Whether corner a comes before corner b going down: above it, or level with it and to the left (which is as if the sweep
+	// line were tilted the slightest bit, so no two corners are level), or in the same place and given first
+	bool above(unsigned a, unsigned b) const
+	{
+		const glm::vec2 &p = points[a], &q = points[b];
+		return p.y > q.y || (p.y == q.y && (p.x < q.x || (p.x == q.x && a < b)));
+	}
+
+	// Where edge e (from corner e to the next) crosses the sweep line
+	double crossing(unsigned e) const
+	{
+		const glm::vec2 &a = points[e], &b = points[next[e]];
+		if(a.y == b.y)
+			return std::min(std::max((double)sweep.x, (double)std::min(a.x, b.x)), (double)std::max(a.x, b.x));
+		return a.x + ((double)sweep.y - a.y) * ((double)b.x - a.x) / ((double)b.y - a.y);
+	}
+
+	double turnAt(unsigned i) const {return turn(points[prev[i]], points[i], points[next[i]]);}
+};
+
+// Orders the edges crossing the sweep line from left to right. (Edges of a simple polygon don't cross, so the order of those
+// in the set never changes as the sweep line moves down.) The index one past the last corner stands for the sweep line's corner
+// itself, for looking up the edge to the left of it.
+struct SweepEdgeOrder
+{
+	const PolygonRing *ring;
+
+	SweepEdgeOrder(const PolygonRing *ring) : ring(ring) {}
+
+	bool operator()(unsigned a, unsigned b) const
+	{
+		unsigned n = (unsigned)ring->points.size();
+		double xa = (a == n) ? ring->sweep.x : ring->crossing(a), xb = (b == n) ? ring->sweep.x : ring->crossing(b);
+		return xa < xb || (xa == xb && a < b);
+	}
+};
+
+// Cuts the polygon into y-monotone pieces by sweeping a line down it: every corner where the outline turns back up or down on the
+// inside (a split or merge corner) gets a diagonal to a corner above or below it, found with the edges crossing the sweep line
+// kept in order (Berg et al., Computational Geometry, chapter 3). Appends the diagonals to diagonals, as pairs of corners.
+static void findMonotoneDiagonals(PolygonRing &ring, std::vector<unsigned> &diagonals)
+{
+	unsigned n = (unsigned)ring.points.size();
+	enum Kind {START, SPLIT, END, MERGE, REGULAR};
+	std::vector<Kind> kinds(n);
+	std::vector<unsigned> order(n);
+	for(unsigned i = 0; i < n; i++)
+	{
+		order[i] = i;
+		bool prevAbove = ring.above(ring.prev[i], i), nextAbove = ring.above(ring.next[i], i);
+		bool convex = ring.turnAt(i) > 0;
+		if(!prevAbove && !nextAbove)
+			kinds[i] = convex ? START : SPLIT;
+		else if(prevAbove && nextAbove)
+			kinds[i] = convex ? END : MERGE;
+		else
+			kinds[i] = REGULAR;
+	}
+	std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {return ring.above(a, b);});
+
+	// The edges that have the inside of the polygon to their right where they cross the sweep line, each with its helper: the
+	// lowest corner above the sweep line that can see the edge to the next one of them on the right
+	typedef std::set<unsigned, SweepEdgeOrder> Status;
+	Status status((SweepEdgeOrder(&ring)));
+	std::vector<Status::iterator> statusOf(n);
+	std::vector<bool> inStatus(n, false);
+	std::vector<unsigned> helper(n);
+
+	auto insert = [&](unsigned e, unsigned corner) {
+		statusOf[e] = status.insert(e).first;
+		inStatus[e] = true;
+		helper[e] = corner;
+	};
+	// Takes out the edge ending at corner (if it's there - it always is, unless the polygon crosses itself), first joining corner
+	// to its helper if that's a merge corner
+	auto finishEdgeBefore = [&](unsigned corner) {
+		unsigned e = ring.prev[corner];
+		if(!inStatus[e])
+			return;
+		if(kinds[helper[e]] == MERGE)
+		{
+			diagonals.push_back(corner);
+			diagonals.push_back(helper[e]);
+		}
+		status.erase(statusOf[e]);
+		inStatus[e] = false;
+	};
+	// Makes corner the helper of the edge to its left, first joining it to the old helper if that's a merge corner (or if
+	// corner is a split corner, which needs joining to something above it)
+	auto helpEdgeLeftOf = [&](unsigned corner) {
+		Status::iterator left = status.lower_bound(n);
+		if(left == status.begin())
+			return;
+		--left;
+		if(kinds[helper[*left]] == MERGE || kinds[corner] == SPLIT)
+		{
+			diagonals.push_back(corner);
+			diagonals.push_back(helper[*left]);
+		}
+		helper[*left] = corner;
+	};
+
+	for(unsigned k = 0; k < n; k++)
+	{
+		unsigned i = order[k];
+		ring.sweep = ring.points[i];
+		switch(kinds[i])
+		{
+		case START:
+			insert(i, i);
+			break;
+		case END:
+			finishEdgeBefore(i);
+			break;
+		case SPLIT:
+			helpEdgeLeftOf(i);
+			insert(i, i);
+			break;
+		case MERGE:
+			finishEdgeBefore(i);
+			helpEdgeLeftOf(i);
+			break;
+		case REGULAR:
+			if(ring.above(ring.prev[i], i)) // (going down the left side of the inside)
+			{
+				finishEdgeBefore(i);
+				insert(i, i);
+			}
+			else
+				helpEdgeLeftOf(i);
+			break;
+		}
+	}
+}
+
+// Triangulates a y-monotone piece (its corners in order counterclockwise) by going down it with a stack of the corners that are
+// still to be joined to something below them (Berg et al. again), calling emit(a, b, c) for each triangle.
+template<typename Emit>
+static void triangulateMonotone(const PolygonRing &ring, const std::vector<unsigned> &piece, Emit emit)
+{
+	size_t m = piece.size();
+	if(m < 3)
+		return;
+
+	// The left side goes down from the top corner counterclockwise, and the right side up to it
+	size_t top = 0, bottom = 0;
+	for(size_t k = 1; k < m; k++)
+	{
+		if(ring.above(piece[k], piece[top]))
+			top = k;
+		if(ring.above(piece[bottom], piece[k]))
+			bottom = k;
+	}
+	typedef std::pair<unsigned, bool> Corner; // (corner, whether it's on the left side)
+	std::vector<Corner> corners(m);
+	for(size_t k = 0; k < m; k++)
+		corners[k] = Corner(piece[k], (k + m - top) % m < (bottom + m - top) % m);
+	std::sort(corners.begin(), corners.end(), [&](const Corner &a, const Corner &b) {return ring.above(a.first, b.first);});
+
+	std::vector<Corner> stack;
+	stack.push_back(corners[0]);
+	stack.push_back(corners[1]);
+	for(size_t k = 2; k + 1 < m; k++)
+	{
+		const Corner &corner = corners[k];
+		if(corner.second != stack.back().second)
+		{
+			// On the other side from the stack, so it can see all of the stack
+			for(size_t s = 0; s + 1 < stack.size(); s++)
+				emit(corner.first, stack[s].first, stack[s + 1].first);
+			Corner last = stack.back();
+			stack.clear();
+			stack.push_back(last);
+			stack.push_back(corner);
+		}
+		else
+		{
+			// On the same side, so it can see up the stack for as long as the side bulges out
+			Corner last = stack.back();
+			stack.pop_back();
+			while(!stack.empty())
+			{
+				const glm::vec2 &a = ring.points[stack.back().first], &b = ring.points[last.first], &c = ring.points[corner.first];
+				if((corner.second ? turn(a, b, c) : turn(c, b, a)) <= 0)
+					break;
+				emit(corner.first, last.first, stack.back().first);
+				last = stack.back();
+				stack.pop_back();
+			}
+			stack.push_back(last);
+			stack.push_back(corner);
+		}
+	}
+	for(size_t s = 0; s + 1 < stack.size(); s++)
+		emit(corners[m - 1].first, stack[s].first, stack[s + 1].first);
+}
+
+void triangulatePolygon(const std::vector<glm::vec2> &polygon, std::vector<unsigned> &triangles)
+{
+	unsigned n = (unsigned)polygon.size();
+	if(n < 3)
+		return;
+	triangles.reserve(triangles.size() + 3 * (n - 2));
+
+	// Work around the polygon counterclockwise; if it was given clockwise, the triangles are turned back around as they're written
+	double area = 0;
+	for(unsigned i = 0; i < n; i++)
+	{
+		const glm::vec2 &p = polygon[i], &q = polygon[(i + 1) % n];
+		area += (double)p.x * q.y - (double)q.x * p.y;
+	}
+	bool clockwise = area < 0;
+
+	PolygonRing ring(polygon);
+	for(unsigned i = 0; i < n; i++)
+	{
+		ring.prev[i] = clockwise ? (i + 1) % n : (i + n - 1) % n;
+		ring.next[i] = clockwise ? (i + n - 1) % n : (i + 1) % n;
+	}
+
+	std::vector<unsigned> diagonals;
+	findMonotoneDiagonals(ring, diagonals);
+
+	// The pieces are the faces the ring's edges and the diagonals (both ways) make: going around one counterclockwise, the edge
+	// after the one into a corner is the first of the corner's edges out clockwise from the way back. Each corner's edges out are
+	// sorted by angle for looking that up - all but the corners with diagonals have just the one.
+	std::vector<unsigned> firstOut(n + 1, 0);
+	for(unsigned i = 0; i < n; i++)
+		firstOut[i + 1] = 1;
+	for(size_t d = 0; d < diagonals.size(); d++)
+		firstOut[diagonals[d] + 1]++;
+	for(unsigned i = 0; i < n; i++)
+		firstOut[i + 1] += firstOut[i];
+
+	struct Out
+	{
+		double angle;
+		unsigned from, to;
+		bool operator<(const Out &o) const {return angle < o.angle;}
+	};
+	std::vector<Out> outs(firstOut[n]);
+	{
+		std::vector<unsigned> fill(firstOut.begin(), firstOut.end() - 1);
+		auto addOut = [&](unsigned from, unsigned to) {
+			glm::vec2 d = polygon[to] - polygon[from];
+			Out out = {atan2((double)d.y, (double)d.x), from, to};
+			outs[fill[from]++] = out;
+		};
+		for(unsigned i = 0; i < n; i++)
+			addOut(i, ring.next[i]);
+		for(size_t d = 0; d < diagonals.size(); d += 2)
+		{
+			addOut(diagonals[d], diagonals[d + 1]);
+			addOut(diagonals[d + 1], diagonals[d]);
+		}
+	}
+	for(unsigned i = 0; i < n; i++)
+		if(firstOut[i + 1] - firstOut[i] > 1)
+			std::sort(outs.begin() + firstOut[i], outs.begin() + firstOut[i + 1]);
+
+	auto following = [&](const Out &in) -> unsigned {
+		unsigned corner = in.to;
+		if(firstOut[corner + 1] - firstOut[corner] == 1)
+			return firstOut[corner];
+		glm::vec2 d = polygon[in.from] - polygon[corner];
+		Out back = {atan2((double)d.y, (double)d.x), corner, in.from};
+		std::vector<Out>::iterator begin = outs.begin() + firstOut[corner], end = outs.begin() + firstOut[corner + 1];
+		std::vector<Out>::iterator after = std::lower_bound(begin, end, back);
+		return (unsigned)(((after == begin) ? end : after) - 1 - outs.begin());
+	};
+
+	auto emit = [&](unsigned a, unsigned b, unsigned c) {
+		if((turn(polygon[a], polygon[b], polygon[c]) < 0) != clockwise)
+			std::swap(b, c);
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	};
+
+	std::vector<bool> visited(outs.size(), false);
+	std::vector<unsigned> piece;
+	for(unsigned first = 0; first < outs.size(); first++)
+	{
+		piece.clear();
+		for(unsigned o = first; !visited[o]; o = following(outs[o]))
+		{
+			visited[o] = true;
+			piece.push_back(outs[o].from);
+		}
+		triangulateMonotone(ring, piece, emit);
+	}
+}
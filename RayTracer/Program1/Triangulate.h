@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+#include "../glm/glm.hpp"
+
+// Cuts a simple polygon (convex or not, given by its corners in order, either way around) into triangles, appending each one's
+// three corners - as indices into polygon - to triangles. There are polygon.size() - 2 of them, wound the same way around as the
+// polygon, and corners may be in a line with their neighbors (they're still used), but no two in a row may be in the same place.
+// This sweeps a line down the polygon to cut it into pieces that are y-monotone (that any horizontal line crosses at most twice),
+// then triangulates each of those in one pass down it, so it takes O(n log n) time however the polygon winds about - rather than
+// the quadratic time of cutting one triangle at a time off a face with Mesh::splitFace(). A polygon that crosses itself comes out
+// as triangles that cover some of it, and may overlap.
+void triangulatePolygon(const std::vector<glm::vec2> &polygon, std::vector<unsigned> &triangles);
@@ -0,0 +1,53 @@
+// Scene compiler: loads a scene description (the same files the OpenGL program and raytracer read) and writes it out as a compiled
+// scene (see CompiledScene), which the raytracer can map and render without loading or building anything.
+//
+// Usage: scene_compiler <scene file> <output file>
+
+#include <iostream>
+#include <chrono>
+#include <exception>
+
+#include "../Program1/SceneGraph.h"
+#include "../Program1/SceneLoader.h"
+#include "../Program1/CompiledScene.h"
+
+using namespace std;
+
+// Seconds since start
+static double secondsSince(chrono::high_resolution_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	if(argc != 3)
+	{
+		cerr << "Usage: " << argv[0] << " <scene file> <output file>" << endl;
+		return 1;
+	}
+	const char *sceneFile = argv[1];
+	const char *outputFile = argv[2];
+
+	SceneGraph scene;
+	SceneLoader loader;
+	loader.initialize(AttribLocations());
+
+	try
+	{
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+		loader.load(scene, sceneFile);
+		cout << "Loaded " << sceneFile << " (" << loader.getObjects().size() << " items) in " << secondsSince(start) * 1000 << " ms" << endl;
+
+		start = chrono::high_resolution_clock::now();
+		CompiledScene::write(scene, outputFile);
+		cout << "Compiled " << outputFile << " in " << secondsSince(start) * 1000 << " ms" << endl;
+	}
+	catch(exception &e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
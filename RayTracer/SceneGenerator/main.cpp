@@ -0,0 +1,135 @@
+// Scene generator: writes a scene description file (in the same format as testScene.txt) with as many furniture items as asked for,
+// for measuring how loading, BVH building and rendering scale. Items are stacked on a square floor sized to fit them, and everything
+// about them is pseudorandom from the seed - and from nothing else, so a seed always gives the same file, on any platform.
+//
+// Usage: scene_generator <output file> <number of items> [seed [max stack depth [mesh fraction [mesh file[:subdivisions] ...]]]]
+//	Defaults to seed 1, stacks up to 3 items high, and no meshes. mesh fraction (from 0 to 1) is the share of the items that are
+//	meshes, picked evenly from the mesh files listed (which are written as given, so they need to be relative to where the scene file
+//	will be - or absolute); the rest are boxes, tables and chairs in equal measure.
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+
+using namespace std;
+
+// The generator's random numbers. std::mt19937's output is fully specified by the standard (unlike the distributions), so this only
+// maps its output to ranges itself.
+class Random
+{
+public:
+	Random(unsigned seed) : engine(seed) {}
+
+	// Uniform in [0, n)
+	unsigned below(unsigned n) {return (unsigned)((unsigned long long)engine() * n >> 32);}
+	// Uniform in [min, max)
+	float between(float min, float max) {return min + (max - min) * (float)(engine() >> 8) / (1 << 24);}
+
+private:
+	mt19937 engine;
+};
+
+struct MeshFile
+{
+	string fileName;
+	int numSubdivides;
+};
+
+int main(int argc, char** argv)
+{
+	long long numItems = (argc > 2) ? atoll(argv[2]) : 0;
+	unsigned seed = (argc > 3) ? (unsigned)strtoul(argv[3], 0, 10) : 1;
+	int maxStackDepth = (argc > 4) ? atoi(argv[4]) : 3;
+	double meshFraction = (argc > 5) ? atof(argv[5]) : 0;
+
+	vector<MeshFile> meshFiles;
+	for(int i = 6; i < argc; i++)
+	{
+		MeshFile mesh = {argv[i], 0};
+		size_t colon = mesh.fileName.find_last_of(':');
+		if(colon != string::npos && colon > 1) // (not a drive letter)
+		{
+			mesh.numSubdivides = atoi(mesh.fileName.c_str() + colon + 1);
+			mesh.fileName.erase(colon);
+		}
+		meshFiles.push_back(mesh);
+	}
+
+	if(argc < 3 || numItems < 1 || numItems > 100000000 || maxStackDepth < 1 || meshFraction < 0 || meshFraction > 1 ||
+		(meshFraction > 0 && meshFiles.empty()))
+	{
+		cerr << "Usage: " << argv[0] << " <output file> <number of items> [seed [max stack depth [mesh fraction [mesh file[:subdivisions] ...]]]]" << endl;
+		return 1;
+	}
+
+	Random random(seed);
+
+	// A square floor with room for all the items at half the maximum stack depth on average, each grid location getting a random
+	// height from 1 to the maximum. If those come up short, locations are topped up in turn; if they come up long, the locations
+	// left over are empty.
+	double averageDepth = (maxStackDepth + 1) / 2.0;
+	int floorSize = (int)ceil(sqrt(numItems / averageDepth));
+	long long numLocations = (long long)floorSize * floorSize;
+	vector<int> depths((size_t)numLocations);
+	long long total = 0;
+	for(long long i = 0; i < numLocations; i++)
+	{
+		depths[i] = (total < numItems) ? (int)min(1 + (long long)random.below(maxStackDepth), numItems - total) : 0;
+		total += depths[i];
+	}
+	for(long long i = 0; total < numItems; i = (i + 1) % numLocations)
+	{
+		if(depths[i] < maxStackDepth)
+		{
+			depths[i]++;
+			total++;
+		}
+	}
+
+	// One entry per item, saying where it goes, shuffled so that each stack is built up over the whole file
+	vector<int> locations;
+	locations.reserve((size_t)numItems);
+	for(long long i = 0; i < numLocations; i++)
+		locations.insert(locations.end(), depths[i], (int)i);
+	for(size_t i = locations.size() - 1; i > 0; i--)
+		swap(locations[i], locations[random.below((unsigned)i + 1)]);
+
+	FILE *file = fopen(argv[1], "w");
+	if(!file)
+	{
+		cerr << "Couldn't write " << argv[1] << endl;
+		return 1;
+	}
+
+	static const char *FURNITURE[] = {"box", "table", "chair"};
+	fprintf(file, "%d %d %lld\n", floorSize, floorSize, numItems);
+	for(size_t i = 0; i < locations.size(); i++)
+	{
+		fprintf(file, "\n");
+		if(random.between(0, 1) < meshFraction)
+		{
+			const MeshFile &mesh = meshFiles[random.below(meshFiles.size())];
+			fprintf(file, "mesh\n%s %d\n", mesh.fileName.c_str(), mesh.numSubdivides);
+		}
+		else
+			fprintf(file, "%s\n", FURNITURE[random.below(3)]);
+
+		int rotation = random.below(4) * 90;
+		float xScale = random.between(0.5f, 1), yScale = random.between(0.5f, 1.5f), zScale = random.between(0.5f, 1);
+		fprintf(file, "%d %d\n%d\n%.2f %.2f %.2f\n", locations[i] % floorSize, locations[i] / floorSize, rotation, xScale, yScale, zScale);
+	}
+
+	if(fclose(file) != 0)
+	{
+		cerr << "Couldn't write " << argv[1] << endl;
+		return 1;
+	}
+	cout << "Wrote " << argv[1] << " (" << numItems << " items on a " << floorSize << " x " << floorSize << " floor)" << endl;
+
+	return 0;
+}
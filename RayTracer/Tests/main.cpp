@@ -0,0 +1,575 @@
+// Tests for the RayTracer scene code that doesn't need a window or a GL context. Prints a line per test, then the number that
+// passed - ending in "A winner is you!" if they all did, like the intersection tests.
+//
+// Usage: raytracer_tests
+
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "../glm/glm.hpp"
+#include "../glm/gtc/matrix_transform.hpp"
+#include "../Program1/Triangulate.h"
+#include "../Program1/BVH.h"
+#include "../Program1/SceneLoader.h"
+
+using namespace std;
+
+static int numTests = 0, numSuccessful = 0;
+
+static void reportTest(const string &name, bool result)
+{
+	cout << setfill('.') << setw(50) << left << name << (result ? "SUCCESS" : "**FAILURE**") << endl;
+	numTests++;
+	if(result)
+		numSuccessful++;
+}
+
+// Writes contents to fileName (in the working directory), for the tests that read description files
+static void writeFile(const string &fileName, const string &contents)
+{
+	ofstream file(fileName.c_str(), ios::binary);
+	file << contents;
+}
+
+// Twice the signed area of a polygon (positive if it goes counterclockwise)
+static double twiceArea(const vector<glm::vec2> &polygon)
+{
+	double area = 0;
+	for(size_t i = 0; i < polygon.size(); i++)
+	{
+		const glm::vec2 &p = polygon[i], &q = polygon[(i + 1) % polygon.size()];
+		area += (double)p.x * q.y - (double)q.x * p.y;
+	}
+	return area;
+}
+
+// Triangulates polygon both ways around, and checks that each time there are n - 2 triangles of its corners, all wound the
+// same way as it (or flat, between corners in a line), adding up to its area
+static void testTriangulation(const string &name, vector<glm::vec2> polygon)
+{
+	bool passed = true;
+	for(int reversed = 0; reversed < 2; reversed++)
+	{
+		vector<unsigned> triangles;
+		triangulatePolygon(polygon, triangles);
+		if(triangles.size() != 3 * (polygon.size() - 2))
+		{
+			passed = false;
+			break;
+		}
+
+		double polygonArea = twiceArea(polygon), sum = 0;
+		for(size_t i = 0; i < triangles.size(); i += 3)
+		{
+			if(triangles[i] >= polygon.size() || triangles[i + 1] >= polygon.size() || triangles[i + 2] >= polygon.size())
+			{
+				passed = false;
+				break;
+			}
+			vector<glm::vec2> triangle;
+			triangle.push_back(polygon[triangles[i]]);
+			triangle.push_back(polygon[triangles[i + 1]]);
+			triangle.push_back(polygon[triangles[i + 2]]);
+			double area = twiceArea(triangle);
+			if(area * polygonArea < 0)
+				passed = false;
+			sum += area;
+		}
+		if(abs(sum - polygonArea) > 1e-5 * abs(polygonArea))
+			passed = false;
+
+		reverse(polygon.begin(), polygon.end());
+	}
+	reportTest(name, passed);
+}
+
+static void runTriangulateTests()
+{
+	// Regular 12-gon
+	vector<glm::vec2> convex;
+	for(int i = 0; i < 12; i++)
+		convex.push_back(glm::vec2(cos(i * 3.14159265f / 6), sin(i * 3.14159265f / 6)));
+	testTriangulation("Convex polygon", convex);
+
+	// Five-pointed star
+	vector<glm::vec2> star;
+	for(int i = 0; i < 10; i++)
+	{
+		float radius = (i % 2) ? 0.4f : 1.0f;
+		star.push_back(radius * glm::vec2(cos(i * 3.14159265f / 5), sin(i * 3.14159265f / 5)));
+	}
+	testTriangulation("Concave polygon", star);
+
+	// An L, with extra corners along each of its edges
+	vector<glm::vec2> collinear;
+	const float L[][2] = {{0, 0}, {1, 0}, {2, 0}, {3, 0}, {3, 1}, {2, 1}, {1, 1}, {1, 2}, {1, 3}, {0, 3}, {0, 2}, {0, 1}};
+	for(int i = 0; i < 12; i++)
+		collinear.push_back(glm::vec2(L[i][0], L[i][1]));
+	testTriangulation("Corners in a line", collinear);
+
+	// A comb: a bar along the bottom, with pointed teeth along the top of it
+	vector<glm::vec2> comb;
+	const int NUM_TEETH = 20;
+	comb.push_back(glm::vec2(0, 0));
+	comb.push_back(glm::vec2((float)NUM_TEETH, 0));
+	for(int i = NUM_TEETH; i > 0; i--)
+	{
+		comb.push_back(glm::vec2((float)i, 1));
+		comb.push_back(glm::vec2(i - 0.5f, 3));
+	}
+	comb.push_back(glm::vec2(0, 1));
+	testTriangulation("Comb", comb);
+
+	// The same comb turned on its side, so the sweep meets the teeth one at a time
+	vector<glm::vec2> sideways(comb);
+	for(size_t i = 0; i < sideways.size(); i++)
+		sideways[i] = glm::vec2(-sideways[i].y, sideways[i].x);
+	testTriangulation("Comb on its side", sideways);
+}
+
+// Spheres, and triangles lying flat in a plane z = constant (whose bounds have no depth), for the BVH tests
+struct TestPrimitive
+{
+	bool isSphere;
+	glm::mat4 tInv; // for a sphere
+	vec3 corners[3]; // for a triangle
+	AABB bounds;
+
+	float intersect(const Ray &ray) const
+	{
+		return isSphere ? raySphereIntersect(ray, tInv) : rayTriangleIntersect(ray, corners[0], corners[1], corners[2], glm::mat4());
+	}
+};
+
+static float randomFloat(mt19937 &random, float min, float max)
+{
+	return uniform_real_distribution<float>(min, max)(random);
+}
+
+static vec3 randomVector(mt19937 &random, float min, float max)
+{
+	return vec3(randomFloat(random, min, max), randomFloat(random, min, max), randomFloat(random, min, max));
+}
+
+// Traces random packets through a BVH over random spheres and triangles, checking that every ray of each packet hits the same
+// thing at the same distance as it does traced through the BVH on its own - and at the same distance as the closest of all the
+// primitives tested one by one (the triangles overlap, so which one that is can be a tie). Some packets have rays parallel to the
+// flat triangles, from the plane of one of them, and some rays have a limited reach.
+static void runBVHPacketTests()
+{
+	mt19937 random(22);
+	const float PLANES[] = {-20, 0, 20}; // the z of each of the triangles' planes
+	vector<TestPrimitive> primitives(600);
+	vector<AABB> bounds;
+	for(size_t i = 0; i < primitives.size(); i++)
+	{
+		TestPrimitive &primitive = primitives[i];
+		primitive.isSphere = (i % 4 != 0);
+		if(primitive.isSphere)
+		{
+			vec3 center = randomVector(random, -50, 50);
+			float radius = randomFloat(random, 0.2f, 3);
+			primitive.tInv = glm::inverse(glm::scale(glm::translate(glm::mat4(), center), vec3(radius)));
+			primitive.bounds = AABB(center - radius, center + radius);
+		}
+		else
+		{
+			vec3 center = randomVector(random, -50, 50);
+			center.z = PLANES[i / 4 % 3];
+			for(int c = 0; c < 3; c++)
+			{
+				primitive.corners[c] = center + vec3(randomFloat(random, -4, 4), randomFloat(random, -4, 4), 0);
+				primitive.bounds.expand(primitive.corners[c]);
+			}
+		}
+		bounds.push_back(primitive.bounds);
+	}
+	BVH bvh;
+	bvh.build(bounds);
+
+	int numRays = 0, numHits = 0, numMismatches = 0;
+	RayPacket packet;
+	for(int p = 0; p < 200; p++)
+	{
+		// A square of rays around a random direction, like the primary rays through a tile of pixels, fanned out more or less
+		bool flat = (p % 5 == 0); // parallel to the triangles, from one of their planes
+		vec3 origin = randomVector(random, -80, 80), axis = randomVector(random, -40, 40) - origin; // toward the primitives
+		if(flat)
+		{
+			origin.z = PLANES[p % 3];
+			axis.z = 0;
+		}
+		vec3 across = glm::normalize(glm::cross(axis, vec3(0, 0, 1))), up = glm::cross(across, glm::normalize(axis));
+		if(flat)
+			up = vec3(0, 0, 0);
+		float spread = randomFloat(random, 0.001f, 0.1f);
+		int side = 1 + random() % 16;
+		bool limited = (p % 2 == 1);
+
+		packet.reset(origin);
+		vector<float> tMax;
+		for(int y = 0; y < side; y++)
+			for(int x = 0; x < side; x++)
+			{
+				tMax.push_back(limited ? randomFloat(random, 1, 150) : numeric_limits<float>::infinity());
+				packet.add(axis + spread * ((x - side / 2.0f) * across + (y - side / 2.0f) * up), tMax.back());
+			}
+
+		bvh.closestHits(packet, [&](int i, const int *rays, int numRays) {
+			for(int j = 0; j < numRays; j++)
+			{
+				double t = primitives[i].intersect(packet.getRay(rays[j]));
+				if(t >= 0)
+					packet.recordHit(rays[j], t, i);
+			}
+		});
+
+		for(int i = 0; i < packet.size; i++)
+		{
+			Ray ray = packet.getRay(i, tMax[i]);
+			double t = -1;
+			int hit = bvh.closestHit(ray, t, [&](int j) {return (double)primitives[j].intersect(packet.getRay(i));});
+
+			int closest = -1;
+			double tClosest = tMax[i];
+			for(size_t j = 0; j < primitives.size(); j++)
+			{
+				double tPrimitive = primitives[j].intersect(packet.getRay(i));
+				if(tPrimitive >= 0 && tPrimitive < tClosest)
+				{
+					tClosest = tPrimitive;
+					closest = (int)j;
+				}
+			}
+
+			numRays++;
+			numHits += (hit >= 0) ? 1 : 0;
+			if(packet.hit[i] != hit || (hit >= 0) != (closest >= 0) || (hit >= 0 && (packet.t[i] != t || t != tClosest)))
+				numMismatches++;
+		}
+	}
+	reportTest("Packets hit what single rays do", numMismatches == 0 && numHits > numRays / 10 && numHits < numRays * 9 / 10);
+}
+
+// Builds a scene graph with a node whose mesh has no triangles (a degenerate extrusion) among a row of boxes, and traces a ray at
+// each box: the empty mesh's bounds mustn't end up in the top-level BVH, where they'd be infinite (and its centroid not a number).
+static void runSceneGraphTests()
+{
+	writeFile("emptyExtrusion.dat", "extrusion\n1\n5\n0 0\n0 0\n0 0\n0 0\n0 0\n");
+	SceneLoader loader;
+	loader.initialize(AttribLocations());
+	Mesh emptyMesh;
+	loader.parseGeometryDescription(emptyMesh, "emptyExtrusion.dat");
+	Box box;
+
+	const int NUM_BOXES = 16;
+	SceneGraph scene;
+	vector<SceneGraph::Node*> boxNodes;
+	for(int i = 0; i < NUM_BOXES; i++)
+	{
+		if(i == NUM_BOXES / 2)
+			scene.addChildToHead(new SceneGraph::Node(&emptyMesh, vec3(0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(2.0f)));
+		boxNodes.push_back(new SceneGraph::Node(&box, vec3(0.0f), vec3(2.0f * i, 0.0f, 5.0f), vec3(1.0f)));
+		scene.addChildToHead(boxNodes.back());
+	}
+	scene.buildBVH();
+
+	bool result = (emptyMesh.getNumFaces() == 0);
+	for(int i = 0; i < NUM_BOXES; i++)
+	{
+		double t = -1;
+		SceneGraph::Node *hit = scene.intersect(Ray(vec3(2.0f * i, 0.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f)), t);
+		result = result && hit == boxNodes[i] && fabs(t - 4.5) < 1e-5;
+	}
+	double t = -1;
+	result = result && scene.intersect(Ray(vec3(0.0f), vec3(0.0f, 0.0f, -1.0f)), t) == 0;
+	reportTest("Meshes with no triangles are left out", result);
+}
+
+// Reads tokens on either side of where TextScanner::readFloat() stops converting them itself and leaves them to strtod() - 15 and 16
+// digits, powers of ten up to 22 and past it - and checks that it gives exactly what strtod() does. Then checks the messages for a
+// token that isn't what was asked for, straight from the scanner and through the scene loader, file, line, column and all.
+static void runTextScannerTests()
+{
+	const char *NUMBERS[] = {"123456789012345", "1234567890123456", "0.123456789012345", "-1.234567890123456", "1.5e22", "1.5e-22",
+		"1e23", "1e-23", "12345e-22", "12345e-23", "-0", ".5", "-.5", "5.", "0.1", "+2.5E+3", "3.4028234e38", "1e-40"};
+	const int NUM_NUMBERS = sizeof(NUMBERS) / sizeof(NUMBERS[0]);
+	string numbers;
+	for(int i = 0; i < NUM_NUMBERS; i++)
+		numbers += string(NUMBERS[i]) + ((i % 4 == 3) ? "\n" : " ");
+	writeFile("numbers.txt", numbers);
+
+	TextScanner scanner;
+	bool result = scanner.open("numbers.txt");
+	for(int i = 0; i < NUM_NUMBERS && result; i++)
+	{
+		float value = scanner.readFloat("a number");
+		float expected = (float)strtod(NUMBERS[i], 0);
+		result = memcmp(&value, &expected, sizeof(float)) == 0; // (bit for bit, so -0 has to come out as -0)
+	}
+	result = result && scanner.atEnd();
+	scanner.close();
+	reportTest("Reading numbers matches strtod()", result);
+
+	writeFile("badNumber.txt", "1 2\n  3 x4\n");
+	string message;
+	try
+	{
+		scanner.open("badNumber.txt");
+		scanner.readInt("the number of points", 0);
+		scanner.readFloat("a point's x coordinate");
+		scanner.readFloat("a point's z coordinate");
+		scanner.readFloat("a point's y coordinate");
+	}
+	catch(ParseException &ex)
+	{
+		message = ex.reason;
+	}
+	scanner.close();
+	reportTest("Bad numbers are reported where they are", message == "badNumber.txt:2:5: expected a point's y coordinate, found \"x4\"");
+
+	writeFile("badProcedure.dat", "\n  cylinder 1\n");
+	message.clear();
+	try
+	{
+		SceneLoader loader;
+		loader.initialize(AttribLocations());
+		Mesh mesh;
+		loader.parseGeometryDescription(mesh, "badProcedure.dat");
+	}
+	catch(MeshException &ex)
+	{
+		message = ex.reason;
+	}
+	reportTest("Bad procedures are reported where they are",
+		message == "Mesh: badProcedure.dat:2:3: expected \"extrusion\" or \"surfrev\", found \"cylinder\"");
+}
+
+// Builds mesh out of polygons, each a list of indices into positions going counterclockwise seen from outside, with the half-edges
+// along every edge two polygons share sym'd together
+static void buildPolygonMesh(Mesh &mesh, const vector<vec3> &positions, const vector<vector<int>> &polygons)
+{
+	mesh.clear();
+	for(size_t i = 0; i < positions.size(); i++)
+		mesh.addVertex(Mesh::NONE, positions[i]);
+
+	map<pair<int, int>, Mesh::Index> halfEdgeFrom; // by the vertices it goes from and to
+	for(size_t f = 0; f < polygons.size(); f++)
+	{
+		const vector<int> &polygon = polygons[f];
+		Mesh::Index first = mesh.getNumHalfEdges();
+		vec3 normal = glm::normalize(glm::cross(positions[polygon[1]] - positions[polygon[0]], positions[polygon[2]] - positions[polygon[0]]));
+		Mesh::Index face = mesh.addFace(first, normal);
+		for(size_t c = 0; c < polygon.size(); c++)
+		{
+			int to = polygon[(c + 1) % polygon.size()];
+			Mesh::Index he = mesh.addHalfEdge(to, first + (c + 1) % polygon.size(), Mesh::NONE, face);
+			mesh.getVertex(to).halfEdge = he;
+			halfEdgeFrom[make_pair(polygon[c], to)] = he;
+		}
+	}
+	for(map<pair<int, int>, Mesh::Index>::iterator he = halfEdgeFrom.begin(); he != halfEdgeFrom.end(); ++he)
+	{
+		map<pair<int, int>, Mesh::Index>::iterator sym = halfEdgeFrom.find(make_pair(he->first.second, he->first.first));
+		if(sym != halfEdgeFrom.end())
+			mesh.getHalfEdge(he->second).sym = sym->second;
+	}
+}
+
+// The cube from -1 to 1 as quads, or just its four sides if open (like an extrusion of a square without its endcaps). Vertex i is
+// at (i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1).
+static void buildCube(Mesh &mesh, bool open)
+{
+	vector<vec3> positions;
+	for(int i = 0; i < 8; i++)
+		positions.push_back(vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f));
+	const int QUADS[6][4] = {{1, 3, 7, 5}, {0, 4, 6, 2}, {4, 5, 7, 6}, {0, 2, 3, 1}, {2, 6, 7, 3}, {0, 1, 5, 4}}; // sides, then y caps
+	vector<vector<int>> polygons;
+	for(int f = 0; f < (open ? 4 : 6); f++)
+		polygons.push_back(vector<int>(QUADS[f], QUADS[f] + 4));
+	buildPolygonMesh(mesh, positions, polygons);
+}
+
+// V - E + F for a mesh, counting a pair of sym'd half-edges as one edge
+static int eulerCharacteristic(Mesh &mesh)
+{
+	size_t numHalfEdgesOnEdges = 0; // half-edges with a sym, which count for half an edge each
+	for(Mesh::Index h = 0; h < mesh.getNumHalfEdges(); h++)
+		numHalfEdgesOnEdges += (mesh.getHalfEdge(h).sym != Mesh::NONE) ? 1 : 0;
+	size_t numEdges = numHalfEdgesOnEdges / 2 + (mesh.getNumHalfEdges() - numHalfEdgesOnEdges);
+	return (int)mesh.getNumVertices() - (int)numEdges + (int)mesh.getNumFaces();
+}
+
+// Checks that every face of mesh is a quad whose half-edges all belong to it, and that every half-edge's sym is its sym in turn,
+// running between the same two vertices the other way
+static bool isConsistentQuadMesh(Mesh &mesh)
+{
+	for(Mesh::Index h = 0; h < mesh.getNumHalfEdges(); h++)
+	{
+		const Mesh::HalfEdge &he = mesh.getHalfEdge(h);
+		Mesh::Index next = he.next, afterNext = mesh.getHalfEdge(next).next, previous = mesh.getHalfEdge(afterNext).next;
+		if(mesh.getHalfEdge(previous).next != h || mesh.getHalfEdge(next).face != he.face || mesh.getHalfEdge(previous).face != he.face)
+			return false;
+		if(he.sym != Mesh::NONE && (mesh.getHalfEdge(he.sym).sym != h || mesh.getHalfEdge(he.sym).vertex != mesh.getHalfEdge(previous).vertex))
+			return false;
+	}
+	return true;
+}
+
+// Subdivides mesh a level at a time, checking what each level has to have in terms of the one before: a quad for each old
+// half-edge, a vertex for each old vertex, face, and edge, consistent half-edges, and the same Euler characteristic
+static bool subdivideChecked(Mesh &mesh, int levels)
+{
+	bool result = true;
+	int euler = eulerCharacteristic(mesh);
+	for(int level = 0; level < levels; level++)
+	{
+		size_t numVertices = mesh.getNumVertices(), numFaces = mesh.getNumFaces(), numHalfEdges = mesh.getNumHalfEdges();
+		size_t numEdges = numVertices + numFaces - euler;
+		mesh.subDivide(1);
+		result = result && mesh.getNumFaces() == numHalfEdges && mesh.getNumHalfEdges() == 4 * numHalfEdges
+			&& mesh.getNumVertices() == numVertices + numFaces + numEdges && eulerCharacteristic(mesh) == euler
+			&& isConsistentQuadMesh(mesh);
+	}
+	return result;
+}
+
+// Catmull-Clark subdivision of closed meshes and an open one (whose boundary has rules of its own), 1 to 3 levels deep. Old vertices
+// keep their indices, so the cube's corner (1, 1, 1) is still vertex 7 afterwards.
+static void runSubdivisionTests()
+{
+	writeFile("pentagon.dat", "extrusion\n3.0\n6\n0.0 0.0\n1.0 1.0\n0.5 1.5\n-0.5 1.5\n-1.0 1.0\n0.0 0.0\n");
+	SceneLoader loader;
+	loader.initialize(AttribLocations());
+
+	for(int levels = 1; levels <= 3; levels++)
+	{
+		// A corner of the cube has three faces and three edges around it: the face points average to 1/3 and the edge midpoints to
+		// 2/3 of the way out, so its vertex point is (1/3 + 2 * 2/3) / 3 = 5/9 of the way out. After that, it stays on the diagonal.
+		Mesh cube;
+		buildCube(cube, false);
+		bool result = subdivideChecked(cube, levels);
+		vec3 corner = cube.getVertex(7).pos;
+		if(levels == 1)
+			result = result && glm::length(corner - vec3(5.0f / 9.0f)) < 1e-6f;
+		else
+			result = result && fabs(corner.x - corner.y) < 1e-6f && fabs(corner.y - corner.z) < 1e-6f && corner.x > 0 && corner.x < 5.0f / 9.0f;
+		ostringstream name;
+		name << "Subdividing a cube (" << levels << ((levels == 1) ? " level)" : " levels)");
+		reportTest(name.str(), result);
+
+		// The top of the open cube is a boundary, so its corner only moves along it: to 3/4 of itself plus 1/8 of each of its
+		// neighbors along the boundary, (1, 1, -1) and (-1, 1, 1) - and it stays at the top and on the diagonal in x and z
+		Mesh tube;
+		buildCube(tube, true);
+		result = subdivideChecked(tube, levels);
+		corner = tube.getVertex(7).pos;
+		if(levels == 1)
+			result = result && glm::length(corner - vec3(0.75f, 1.0f, 0.75f)) < 1e-6f;
+		else
+			result = result && corner.y == 1.0f && fabs(corner.x - corner.z) < 1e-6f && corner.x > 0 && corner.x < 0.75f;
+		name.str("");
+		name << "Subdividing an open cube (" << levels << ((levels == 1) ? " level)" : " levels)");
+		reportTest(name.str(), result);
+
+		// An extrusion, which starts out as indexed triangles with vertices of their own along its creases (see buildHalfEdges())
+		Mesh extrusion;
+		loader.parseGeometryDescription(extrusion, "pentagon.dat");
+		extrusion.buildHalfEdges();
+		name.str("");
+		name << "Subdividing an extrusion (" << levels << ((levels == 1) ? " level)" : " levels)");
+		reportTest(name.str(), eulerCharacteristic(extrusion) == 2 && subdivideChecked(extrusion, levels));
+	}
+}
+
+// The cube from -1 to 1 with each side cut into an n by n grid of quads, all the same size
+static void buildGridCube(Mesh &mesh, int n)
+{
+	vector<vec3> positions;
+	map<long long, int> vertexAt; // by position in units of 1/n, each offset by n to make it from 0 to 2n
+	vector<vector<int>> polygons;
+	for(int axis = 0; axis < 3; axis++)
+	{
+		for(int sign = -1; sign <= 1; sign += 2)
+		{
+			// Going around each quad along u, then v, goes counterclockwise seen from the side of the cube that faces +axis
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			for(int i = 0; i < n; i++)
+			{
+				for(int j = 0; j < n; j++)
+				{
+					const int CORNERS[4][2] = {{i, j}, {i + 1, j}, {i + 1, j + 1}, {i, j + 1}};
+					vector<int> quad;
+					for(int c = 0; c < 4; c++)
+					{
+						int coordinates[3];
+						coordinates[axis] = sign * n;
+						coordinates[u] = 2 * CORNERS[c][0] - n;
+						coordinates[v] = 2 * CORNERS[c][1] - n;
+						long long key = ((long long)(coordinates[0] + n) * (2 * n + 1) + (coordinates[1] + n)) * (2 * n + 1) + (coordinates[2] + n);
+						map<long long, int>::iterator found = vertexAt.find(key);
+						if(found == vertexAt.end())
+						{
+							found = vertexAt.insert(make_pair(key, (int)positions.size())).first;
+							positions.push_back(vec3((float)coordinates[0], (float)coordinates[1], (float)coordinates[2]) / (float)n);
+						}
+						quad.push_back(found->second);
+					}
+					if(sign < 0)
+						reverse(quad.begin(), quad.end());
+					polygons.push_back(quad);
+				}
+			}
+		}
+	}
+	buildPolygonMesh(mesh, positions, polygons);
+}
+
+// Computes all the vertex normals of a cube made of equal quads at once - where weighting the faces around each vertex by their
+// areas changes nothing, so they should match walking around each vertex - on one thread and on several, which should give exactly
+// the same normals
+static void runVertexNormalTests()
+{
+	Mesh cube;
+	buildGridCube(cube, 70); // enough vertices and faces to split across 7 threads
+	vector<vec3> normals, normalsOneThread;
+	parallelThreadsOverride() = 7;
+	cube.computeVertexNormals(normals);
+	bool split = numParallelThreads(cube.getNumFaces()) == 7 && numParallelThreads(cube.getNumVertices()) == 7;
+	parallelThreadsOverride() = 1;
+	cube.computeVertexNormals(normalsOneThread);
+	parallelThreadsOverride() = 0;
+
+	bool result = normals.size() == cube.getNumVertices();
+	for(Mesh::Index v = 0; v < cube.getNumVertices() && result; v++)
+		result = glm::length(normals[v] - cube.getVertexNormal(v)) < 1e-5f;
+	reportTest("Vertex normals match walking around vertices", result);
+	reportTest("Vertex normals are the same on one thread", split && normals.size() == normalsOneThread.size()
+		&& memcmp(&normals[0], &normalsOneThread[0], normals.size() * sizeof(vec3)) == 0);
+}
+
+int main()
+{
+	runTriangulateTests();
+	runBVHPacketTests();
+	runSubdivisionTests();
+	runVertexNormalTests();
+	runSceneGraphTests();
+	runTextScannerTests();
+
+	cout << numSuccessful << " of " << numTests << " tests successful. ";
+	if(numTests == numSuccessful)
+		cout << "A winner is you!";
+	cout << endl;
+	return (numTests == numSuccessful) ? 0 : 1;
+}